@@ -1,7 +1,20 @@
 #!/usr/bin/env python3
-"""Simple flood fill bot for Hadak Micromouse Studio."""
+"""Simple flood fill bot for Hadak Micromouse Studio.
+
+Run with --serve PATH to stay resident as a bot server on a Unix socket:
+enter it in the simulator as unix:PATH and every run reuses this process.
+
+With --server-plan the flood fill runs in the simulator (nextMoveKnown),
+over the walls this bot has declared with setWall and clearWall, instead
+of in Python after every cell.
+
+With --push the simulator answers each move with the walls at the new cell
+(pushSense), so no sense request follows it.
+"""
 
 from collections import deque
+import os
+import socket
 import sys
 
 DIRS = ["N", "E", "S", "W"]
@@ -9,70 +22,72 @@ DX = [0, 1, 0, -1]
 DY = [1, 0, -1, 0]
 INF = 10**9
 
+# Ask the simulator for each move instead of flooding in Python.
+server_plan = False
+# Take the walls from each move's answer instead of asking for them.
+push_sense = False
 
-def log(msg):
-    print(msg, file=sys.stderr, flush=True)
-
-
-def send(cmd, expect_reply=True):
-    sys.stdout.write(cmd + "\n")
-    sys.stdout.flush()
-    if not expect_reply:
-        return ""
-    line = sys.stdin.readline()
-    if not line:
-        sys.exit(0)
-    return line.strip()
-
-
-def maze_width():
-    return int(send("mazeWidth"))
+SENSE_FRONT = 1 << 0
+SENSE_LEFT = 1 << 1
+SENSE_RIGHT = 1 << 2
+SENSE_BACK = 1 << 3
+SENSE_GOAL = 1 << 8
+SENSE_RESET = 1 << 9
 
 
-def maze_height():
-    return int(send("mazeHeight"))
+# Where commands go and answers come from: stdio, or the current
+# connection when serving.
+bot_in = sys.stdin
+bot_out = sys.stdout
 
 
-def wall_front():
-    return send("wallFront") == "true"
+class RunEnded(Exception):
+    """The simulator closed the run."""
 
 
-def wall_left():
-    return send("wallLeft") == "true"
+def log(msg):
+    print(msg, file=sys.stderr, flush=True)
 
 
-def wall_right():
-    return send("wallRight") == "true"
+def read_reply():
+    line = bot_in.readline()
+    if not line:
+        raise RunEnded()
+    return line.strip()
 
 
-def wall_back():
-    return send("wallBack") == "true"
+def send(cmd, expect_reply=True):
+    bot_out.write(cmd + "\n")
+    bot_out.flush()
+    if not expect_reply:
+        return ""
+    return read_reply()
 
 
-def move_forward():
-    return send("moveForward") != "crash"
+def send_batch(cmds):
+    """Send every command, then read one answer each: one round trip in all."""
+    bot_out.write("".join(cmd + "\n" for cmd in cmds))
+    bot_out.flush()
+    return [read_reply() for _ in cmds]
 
 
-def turn_left():
-    send("turnLeft")
+def maze_width():
+    return int(send("mazeWidth"))
 
 
-def turn_right():
-    send("turnRight")
+def maze_height():
+    return int(send("mazeHeight"))
 
 
-def was_reset():
-    return send("wasReset") == "true"
+def sense():
+    """Walls around the mouse plus the goal and reset flags, in one round trip."""
+    return int(send("sense"))
 
 
 def ack_reset():
     send("ackReset")
 
 
-def is_goal():
-    return send("isGoal") == "true"
-
-
 def set_wall(x, y, direction):
     send(f"setWall {x} {y} {direction}", expect_reply=False)
 
@@ -97,8 +112,8 @@ def goal_cells(width, height):
     except ValueError:
         return center_cells(width, height)
     goals = set()
-    for i in range(count):
-        parts = send(f"goalCell {i}").split()
+    for reply in send_batch([f"goalCell {i}" for i in range(count)]):
+        parts = reply.split()
         if len(parts) != 2:
             continue
         try:
@@ -134,10 +149,29 @@ def compute_distances(width, height, walls, goals):
     return dist
 
 
+def next_move(x, y, direction, width, height, walls, goals):
+    dist = compute_distances(width, height, walls, goals)
+    preferences = [direction, (direction + 3) % 4, (direction + 1) % 4, (direction + 2) % 4]
+    best_dir = None
+    best_dist = INF
+    for d in preferences:
+        if walls[x][y][d] is True:
+            continue
+        nx, ny = x + DX[d], y + DY[d]
+        if not in_bounds(nx, ny, width, height):
+            continue
+        if dist[nx][ny] < best_dist:
+            best_dist = dist[nx][ny]
+            best_dir = d
+    return best_dir
+
+
 def main():
     width = maze_width()
     height = maze_height()
     goals = goal_cells(width, height)
+    if push_sense:
+        send("pushSense 1")
 
     walls = [[[None for _ in range(4)] for _ in range(height)] for _ in range(width)]
 
@@ -154,24 +188,26 @@ def main():
 
     x, y = 0, 0
     direction = 0
+    walls_here = sense()
 
     while True:
-        if was_reset():
+        if walls_here & SENSE_RESET:
             ack_reset()
             x, y = 0, 0
             direction = 0
             goals = goal_cells(width, height)
+            walls_here = sense()
             continue
 
-        if is_goal():
+        if walls_here & SENSE_GOAL:
             log("Goal reached")
             return
 
         sensed = {
-            (direction + 0) % 4: wall_front(),
-            (direction + 3) % 4: wall_left(),
-            (direction + 1) % 4: wall_right(),
-            (direction + 2) % 4: wall_back(),
+            (direction + 0) % 4: bool(walls_here & SENSE_FRONT),
+            (direction + 3) % 4: bool(walls_here & SENSE_LEFT),
+            (direction + 1) % 4: bool(walls_here & SENSE_RIGHT),
+            (direction + 2) % 4: bool(walls_here & SENSE_BACK),
         }
         for d, is_wall in sensed.items():
             if walls[x][y][d] is None:
@@ -184,45 +220,81 @@ def main():
             if in_bounds(nx, ny, width, height):
                 walls[nx][ny][(d + 2) % 4] = is_wall
 
-        dist = compute_distances(width, height, walls, goals)
-        preferences = [direction, (direction + 3) % 4, (direction + 1) % 4, (direction + 2) % 4]
-        best_dir = None
-        best_dist = INF
-        for d in preferences:
-            if walls[x][y][d] is True:
-                continue
-            nx, ny = x + DX[d], y + DY[d]
-            if not in_bounds(nx, ny, width, height):
-                continue
-            if dist[nx][ny] < best_dist:
-                best_dist = dist[nx][ny]
-                best_dir = d
+        if server_plan:
+            answer = send("nextMoveKnown")
+            best_dir = None if answer == "none" else DIRS.index(answer.upper())
+        else:
+            best_dir = next_move(x, y, direction, width, height, walls, goals)
 
         if best_dir is None:
             log("No moves left")
             return
 
+        # Turn, move and sense the next cell in a single pipelined burst.
         diff = (best_dir - direction) % 4
-        if diff == 1:
-            turn_right()
-        elif diff == 3:
-            turn_left()
-        elif diff == 2:
-            turn_right()
-            turn_right()
+        turns = {0: [], 1: ["turnRight"], 2: ["turnRight", "turnRight"], 3: ["turnLeft"]}
+        if push_sense:
+            # "ack <sense> <x> <y> <heading>"
+            moved = send_batch(turns[diff] + ["moveForward"])[-1].split()
+            replies = [moved[0], moved[1]]
+        else:
+            replies = send_batch(turns[diff] + ["moveForward", "sense"])
         direction = best_dir
 
-        if not move_forward():
+        if replies[-2] == "crash":
             log("Crash")
             return
+        walls_here = int(replies[-1])
 
         x += DX[direction]
         y += DY[direction]
 
 
+def serve(path):
+    """Play one run per connection; the simulator opens with newRun."""
+    global bot_in, bot_out
+    if os.path.exists(path):
+        os.unlink(path)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(path)
+    server.listen(16)
+    log(f"Serving runs on {path}")
+    while True:
+        conn, _ = server.accept()
+        bot_in = conn.makefile("r", encoding="utf-8", newline="\n")
+        bot_out = conn.makefile("w", encoding="utf-8", newline="\n")
+        try:
+            if read_reply() == "newRun":
+                send("ready", expect_reply=False)
+                main()
+        except (RunEnded, OSError):
+            pass
+        except Exception as exc:
+            log(f"Run failed: {exc}")
+        finally:
+            for stream in (bot_in, bot_out):
+                try:
+                    stream.close()
+                except OSError:
+                    pass
+            conn.close()
+
+
 if __name__ == "__main__":
+    args = sys.argv[1:]
+    if "--server-plan" in args:
+        args.remove("--server-plan")
+        server_plan = True
+    if "--push" in args:
+        args.remove("--push")
+        push_sense = True
     try:
-        main()
+        if len(args) == 2 and args[0] == "--serve":
+            serve(args[1])
+        else:
+            main()
+    except RunEnded:
+        pass
     except Exception as exc:
         log(f"Fatal error: {exc}")
         raise
@@ -3,6 +3,13 @@
 
 import sys
 
+SENSE_FRONT = 1 << 0
+SENSE_LEFT = 1 << 1
+SENSE_RIGHT = 1 << 2
+SENSE_BACK = 1 << 3
+SENSE_GOAL = 1 << 8
+SENSE_RESET = 1 << 9
+
 
 def log(msg):
     print(msg, file=sys.stderr, flush=True)
@@ -19,16 +26,8 @@ def send(cmd, expect_reply=True):
     return line.strip()
 
 
-def wall_front():
-    return send("wallFront") == "true"
-
-
-def wall_left():
-    return send("wallLeft") == "true"
-
-
-def wall_right():
-    return send("wallRight") == "true"
+def sense():
+    return int(send("sense"))
 
 
 def move_forward():
@@ -43,38 +42,31 @@ def turn_right():
     send("turnRight")
 
 
-def was_reset():
-    return send("wasReset") == "true"
-
-
 def ack_reset():
     send("ackReset")
 
 
-def is_goal():
-    return send("isGoal") == "true"
-
-
 def main():
     while True:
-        if was_reset():
+        walls = sense()
+        if walls & SENSE_RESET:
             ack_reset()
             continue
 
-        if is_goal():
+        if walls & SENSE_GOAL:
             log("Goal reached")
             return
 
-        if not wall_left():
+        if not walls & SENSE_LEFT:
             turn_left()
             if not move_forward():
                 log("Crash after left turn")
                 return
-        elif not wall_front():
+        elif not walls & SENSE_FRONT:
             if not move_forward():
                 log("Crash moving forward")
                 return
-        elif not wall_right():
+        elif not walls & SENSE_RIGHT:
             turn_right()
             if not move_forward():
                 log("Crash after right turn")
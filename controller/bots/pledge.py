@@ -6,6 +6,13 @@ import sys
 DX = [0, 1, 0, -1]
 DY = [1, 0, -1, 0]
 
+SENSE_FRONT = 1 << 0
+SENSE_LEFT = 1 << 1
+SENSE_RIGHT = 1 << 2
+SENSE_BACK = 1 << 3
+SENSE_GOAL = 1 << 8
+SENSE_RESET = 1 << 9
+
 
 def log(msg):
     print(msg, file=sys.stderr, flush=True)
@@ -30,16 +37,8 @@ def maze_height():
     return int(send("mazeHeight"))
 
 
-def wall_front():
-    return send("wallFront") == "true"
-
-
-def wall_left():
-    return send("wallLeft") == "true"
-
-
-def wall_right():
-    return send("wallRight") == "true"
+def sense():
+    return int(send("sense"))
 
 
 def move_forward():
@@ -54,18 +53,10 @@ def turn_right():
     send("turnRight")
 
 
-def was_reset():
-    return send("wasReset") == "true"
-
-
 def ack_reset():
     send("ackReset")
 
 
-def is_goal():
-    return send("isGoal") == "true"
-
-
 def turn_to(direction, target):
     diff = (target - direction) % 4
     if diff == 1:
@@ -107,7 +98,8 @@ def main():
         return False
 
     while True:
-        if was_reset():
+        walls = sense()
+        if walls & SENSE_RESET:
             ack_reset()
             direction = 0
             mode = "forward"
@@ -117,16 +109,17 @@ def main():
             steps = 0
             continue
 
-        if is_goal():
+        if walls & SENSE_GOAL:
             log("Goal reached")
             return
 
         if mode == "forward":
-            # Face preferred direction when possible
+            # Face preferred direction when possible, then sense again
             if direction != preferred_dir:
                 direction = turn_to(direction, preferred_dir)
+                continue
 
-            if wall_front():
+            if walls & SENSE_FRONT:
                 mode = "wall_follow"
                 turn_sum = 0
                 continue
@@ -139,11 +132,11 @@ def main():
             continue
 
         # Wall-following mode (right-hand rule)
-        if turn_sum == 0 and direction == preferred_dir and not wall_front():
+        if turn_sum == 0 and direction == preferred_dir and not walls & SENSE_FRONT:
             mode = "forward"
             continue
 
-        if not wall_right():
+        if not walls & SENSE_RIGHT:
             turn_right()
             direction = (direction + 1) % 4
             turn_sum -= 1
@@ -152,13 +145,13 @@ def main():
                 return
             if advance_position():
                 return
-        elif not wall_front():
+        elif not walls & SENSE_FRONT:
             if not move_forward():
                 log("Crash moving forward")
                 return
             if advance_position():
                 return
-        elif not wall_left():
+        elif not walls & SENSE_LEFT:
             turn_left()
             direction = (direction + 3) % 4
             turn_sum += 1
@@ -4,6 +4,13 @@
 import random
 import sys
 
+SENSE_FRONT = 1 << 0
+SENSE_LEFT = 1 << 1
+SENSE_RIGHT = 1 << 2
+SENSE_BACK = 1 << 3
+SENSE_GOAL = 1 << 8
+SENSE_RESET = 1 << 9
+
 
 def log(msg):
     print(msg, file=sys.stderr, flush=True)
@@ -20,16 +27,8 @@ def send(cmd, expect_reply=True):
     return line.strip()
 
 
-def wall_front():
-    return send("wallFront") == "true"
-
-
-def wall_left():
-    return send("wallLeft") == "true"
-
-
-def wall_right():
-    return send("wallRight") == "true"
+def sense():
+    return int(send("sense"))
 
 
 def move_forward():
@@ -44,34 +43,27 @@ def turn_right():
     send("turnRight")
 
 
-def was_reset():
-    return send("wasReset") == "true"
-
-
 def ack_reset():
     send("ackReset")
 
 
-def is_goal():
-    return send("isGoal") == "true"
-
-
 def main():
     while True:
-        if was_reset():
+        walls = sense()
+        if walls & SENSE_RESET:
             ack_reset()
             continue
 
-        if is_goal():
+        if walls & SENSE_GOAL:
             log("Goal reached")
             return
 
         options = []
-        if not wall_front():
+        if not walls & SENSE_FRONT:
             options.extend(["forward"] * 3)
-        if not wall_left():
+        if not walls & SENSE_LEFT:
             options.append("left")
-        if not wall_right():
+        if not walls & SENSE_RIGHT:
             options.append("right")
         if not options:
             options.append("back")
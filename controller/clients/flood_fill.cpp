@@ -0,0 +1,216 @@
+/* Flood-fill bot on the C++ client; the same walk as
+ * controller/bots/flood_fill.py, kept lean as the throughput baseline for
+ * out-of-process bots. Build it with
+ *   c++ -O2 -std=c++17 -Icontroller/sdk \
+ *       -o controller/bots/flood_fill_cpp controller/clients/flood_fill.cpp
+ * and run it as the bot command. --text keeps the text protocol. */
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "hadak_client.hpp"
+
+namespace {
+
+const int kDx[] = {0, 1, 0, -1};
+const int kDy[] = {1, 0, -1, 0};
+const char kDirs[] = "nesw";
+const int kFar = 1 << 30;
+
+enum Wall : signed char { Unknown = -1, Open = 0, Closed = 1 };
+
+struct Maze {
+  int width = 0;
+  int height = 0;
+  // walls[(x * height + y) * 4 + direction]
+  std::vector<signed char> walls;
+  std::vector<std::pair<int, int>> goals;
+  std::vector<int> distance;
+  std::vector<int> queue;
+
+  bool inBounds(int x, int y) const {
+    return x >= 0 && y >= 0 && x < width && y < height;
+  }
+  signed char &wall(int x, int y, int d) {
+    return walls[(x * height + y) * 4 + d];
+  }
+
+  // Breadth-first from the goals with unknown walls taken as open.
+  void flood() {
+    distance.assign(width * height, kFar);
+    queue.clear();
+    for (const auto &goal : goals) {
+      distance[goal.first * height + goal.second] = 0;
+      queue.push_back(goal.first * height + goal.second);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+      int cell = queue[head];
+      int x = cell / height;
+      int y = cell % height;
+      for (int d = 0; d < 4; ++d) {
+        int nx = x + kDx[d];
+        int ny = y + kDy[d];
+        if (walls[cell * 4 + d] == Closed || !inBounds(nx, ny)) {
+          continue;
+        }
+        int next = nx * height + ny;
+        if (distance[next] > distance[cell] + 1) {
+          distance[next] = distance[cell] + 1;
+          queue.push_back(next);
+        }
+      }
+    }
+  }
+
+  // Straight on, then left, right and back among the lowest neighbours.
+  int nextMove(int x, int y, int heading) {
+    flood();
+    const int order[] = {heading, (heading + 3) % 4, (heading + 1) % 4,
+                         (heading + 2) % 4};
+    int best = -1;
+    int bestDistance = kFar;
+    for (int d : order) {
+      int nx = x + kDx[d];
+      int ny = y + kDy[d];
+      if (wall(x, y, d) == Closed || !inBounds(nx, ny)) {
+        continue;
+      }
+      if (distance[nx * height + ny] < bestDistance) {
+        bestDistance = distance[nx * height + ny];
+        best = d;
+      }
+    }
+    return best;
+  }
+};
+
+std::vector<std::pair<int, int>> centerCells(int width, int height) {
+  std::vector<std::pair<int, int>> cells;
+  for (int x = (width - 1) / 2; x <= width / 2; ++x) {
+    for (int y = (height - 1) / 2; y <= height / 2; ++y) {
+      cells.emplace_back(x, y);
+    }
+  }
+  return cells;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool binary = !(argc > 1 && std::strcmp(argv[1], "--text") == 0);
+  hadak::BotClient mouse(binary);
+  hadak::BotBatch batch(mouse);
+
+  int width = batch.mazeWidth();
+  int height = batch.mazeHeight();
+  int goalCount = batch.goalCount();
+  int pushed = batch.pushSense(true);
+  int sensed = batch.sense();
+  if (!batch.run()) {
+    return 1;
+  }
+  Maze maze;
+  maze.width = batch[width].value;
+  maze.height = batch[height].value;
+  maze.walls.assign(maze.width * maze.height * 4, Unknown);
+  bool push = batch[pushed].value != 0;
+  int walls = batch[sensed].value;
+
+  std::vector<int> goalCells;
+  for (int i = 0; i < batch[goalCount].value; ++i) {
+    goalCells.push_back(batch.goalCell(i));
+  }
+  batch.run();
+  for (int index : goalCells) {
+    if (batch[index].ok()) {
+      maze.goals.emplace_back(batch[index].value, batch[index].extra);
+    }
+  }
+  if (maze.goals.empty()) {
+    maze.goals = centerCells(maze.width, maze.height);
+  }
+
+  for (int x = 0; x < maze.width; ++x) {
+    maze.wall(x, 0, 2) = Closed;
+    maze.wall(x, maze.height - 1, 0) = Closed;
+    mouse.setWall(x, 0, 's');
+    mouse.setWall(x, maze.height - 1, 'n');
+  }
+  for (int y = 0; y < maze.height; ++y) {
+    maze.wall(0, y, 3) = Closed;
+    maze.wall(maze.width - 1, y, 1) = Closed;
+    mouse.setWall(0, y, 'w');
+    mouse.setWall(maze.width - 1, y, 'e');
+  }
+
+  int x = 0;
+  int y = 0;
+  int heading = 0;
+  while (true) {
+    if (walls & HADAK_SENSE_RESET) {
+      mouse.ackReset();
+      x = 0;
+      y = 0;
+      heading = 0;
+      walls = mouse.sense().value;
+      continue;
+    }
+    if (walls & HADAK_SENSE_GOAL) {
+      std::fprintf(stderr, "Goal reached\n");
+      return 0;
+    }
+
+    const int bits[] = {HADAK_SENSE_FRONT, HADAK_SENSE_RIGHT,
+                        HADAK_SENSE_BACK, HADAK_SENSE_LEFT};
+    for (int turn = 0; turn < 4; ++turn) {
+      int d = (heading + turn) % 4;
+      signed char state = (walls & bits[turn]) ? Closed : Open;
+      if (maze.wall(x, y, d) == Unknown) {
+        if (state == Closed) {
+          mouse.setWall(x, y, kDirs[d]);
+        } else {
+          mouse.clearWall(x, y, kDirs[d]);
+        }
+      }
+      maze.wall(x, y, d) = state;
+      int nx = x + kDx[d];
+      int ny = y + kDy[d];
+      if (maze.inBounds(nx, ny)) {
+        maze.wall(nx, ny, (d + 2) % 4) = state;
+      }
+    }
+
+    int next = maze.nextMove(x, y, heading);
+    if (next < 0) {
+      std::fprintf(stderr, "No moves left\n");
+      return 0;
+    }
+
+    // The turns, the move and (without push mode) the sense go out
+    // together and cost one round trip.
+    batch.clear();
+    int turn = (next - heading + 4) % 4;
+    if (turn == 1) {
+      batch.turnRight();
+    } else if (turn == 2) {
+      batch.turnRight();
+      batch.turnRight();
+    } else if (turn == 3) {
+      batch.turnLeft();
+    }
+    int moved = batch.moveForward();
+    int probe = push ? moved : batch.sense();
+    if (!batch.run()) {
+      return 1;
+    }
+    heading = next;
+    if (batch[moved].crashed()) {
+      std::fprintf(stderr, "Crash\n");
+      return 0;
+    }
+    walls = batch[probe].value & ((1 << HADAK_PUSH_HEADING_SHIFT) - 1);
+    x += kDx[heading];
+    y += kDy[heading];
+  }
+}
@@ -0,0 +1,72 @@
+/* Left-hand wall follower as an in-process plugin; the same walk as
+ * controller/bots/left_wall.py. Build it into the bot list with
+ *   cc -O2 -shared -fPIC -Icontroller/sdk \
+ *      -o controller/bots/left_wall_plugin.so controller/plugins/left_wall.c
+ */
+#include <stdlib.h>
+
+#include "hadak_plugin.h"
+
+/* Each step starts one movement, so a decision becomes a short plan of
+ * turns and a final move that the following steps play out. */
+struct left_wall {
+  uint16_t plan[3];
+  int count;
+  int next;
+};
+
+uint32_t hadak_bot_abi(void) { return HADAK_PLUGIN_ABI; }
+
+void *hadak_bot_create(const struct hadak_api *api) {
+  (void)api;
+  return calloc(1, sizeof(struct left_wall));
+}
+
+void hadak_bot_destroy(void *ctx) { free(ctx); }
+
+static void plan(struct left_wall *bot, uint16_t turn, int turns) {
+  bot->count = 0;
+  bot->next = 0;
+  while (turns-- > 0) {
+    bot->plan[bot->count++] = turn;
+  }
+  bot->plan[bot->count++] = HADAK_MOVE_FORWARD;
+}
+
+int hadak_bot_step(void *ctx, const struct hadak_api *api) {
+  struct left_wall *bot = ctx;
+  int32_t walls = 0;
+
+  if (bot->next > 0 && bot->plan[bot->next - 1] == HADAK_MOVE_FORWARD &&
+      api->last_move(api->sim) == HADAK_CRASH) {
+    api->log(api->sim, "Crash moving forward");
+    return HADAK_DONE;
+  }
+  if (bot->next < bot->count) {
+    api->call(api->sim, bot->plan[bot->next++], 0, 1, 0, NULL, NULL);
+    return HADAK_CONTINUE;
+  }
+
+  api->call(api->sim, HADAK_SENSE, 0, 1, 0, &walls, NULL);
+  if (walls & HADAK_SENSE_RESET) {
+    bot->count = bot->next = 0;
+    api->call(api->sim, HADAK_ACK_RESET, 0, 0, 0, NULL, NULL);
+    return HADAK_CONTINUE;
+  }
+  if (walls & HADAK_SENSE_GOAL) {
+    api->log(api->sim, "Goal reached");
+    return HADAK_DONE;
+  }
+
+  if (!(walls & HADAK_SENSE_LEFT)) {
+    plan(bot, HADAK_TURN_LEFT, 1);
+  } else if (!(walls & HADAK_SENSE_FRONT)) {
+    plan(bot, HADAK_TURN_RIGHT, 0);
+  } else if (!(walls & HADAK_SENSE_RIGHT)) {
+    plan(bot, HADAK_TURN_RIGHT, 1);
+  } else {
+    plan(bot, HADAK_TURN_RIGHT, 2);
+  }
+  api->call(api->sim, bot->plan[bot->next++], 0, 1, 0, NULL, NULL);
+  return HADAK_CONTINUE;
+}
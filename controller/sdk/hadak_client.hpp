@@ -0,0 +1,581 @@
+// C++ client for Hadak Micromouse Studio bots: every command of the
+// protocol, buffered writes, pipelined batches and the fastest transport
+// the simulator offers, in one header (C++17).
+//
+//   hadak::BotClient mouse;
+//   int width = mouse.mazeWidth().value;
+//   if (!mouse.wallFront().value) mouse.moveForward();
+//
+//   hadak::BotBatch batch(mouse);
+//   batch.turnRight();
+//   int moved = batch.moveForward();
+//   int walls = batch.sense();
+//   batch.run();
+//   if (batch[moved].crashed()) ...
+//
+// The client asks for binary frames and falls back to text when the
+// simulator declines; under either, the shared-memory rings of hadak_shm.h
+// replace stdin/stdout whenever HADAK_SHM offers them. Answers look the
+// same whatever the transport: they are decoded as binary responses are
+// (see hadak_protocol.h), so getStat is the float's bit pattern and a
+// push-mode pose is packed into value and extra. The one gap is text
+// nextMoveKnown, which has no distance to put in extra.
+//
+// Requests that do not answer (setWall, setColor, ...) stay in the output
+// buffer until a request that does answer, a batch's run() or flush(). The
+// simulator stops reading past about a thousand queued commands, so keep
+// a batch well below that. Do not write to stdout yourself.
+#ifndef HADAK_CLIENT_HPP
+#define HADAK_CLIENT_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "hadak_protocol.h"
+
+namespace hadak {
+
+struct BotAnswer {
+  // HADAK_OK, HADAK_CRASH or HADAK_IO_ERROR.
+  int status = HADAK_OK;
+  int32_t value = 0;
+  int32_t extra = 0;
+
+  bool ok() const { return status == HADAK_OK; }
+  bool crashed() const { return status == HADAK_CRASH; }
+  // getStat's answer; -1 when the stat has no value yet.
+  float stat() const {
+    float number;
+    std::memcpy(&number, &value, sizeof(number));
+    return number;
+  }
+};
+
+namespace detail {
+
+inline const char *commandName(uint16_t opcode) {
+  static const char *const kNames[] = {
+      "", "mazeWidth", "mazeHeight", "goalCount", "goalCell", "isGoal",
+      "wallFront", "wallRight", "wallLeft", "wallBack", "wallFrontRight",
+      "wallFrontLeft", "wallBackRight", "wallBackLeft", "moveForward",
+      "moveForwardHalf", "turnRight", "turnLeft", "turnRight45", "turnLeft45",
+      "setWall", "clearWall", "setColor", "clearColor", "clearAllColor",
+      "setText", "clearText", "clearAllText", "wasReset", "ackReset", "getStat",
+      "sense", "setColorGrid", "setTextGrid", "setColorRect", "runPath",
+      "floodKnown", "nextMoveKnown", "pushSense"};
+  return opcode < sizeof(kNames) / sizeof(kNames[0]) ? kNames[opcode] : "";
+}
+
+// In StatId order, which is getStat's aux.
+inline const char *statName(uint16_t stat) {
+  static const char *const kNames[] = {
+      "total-distance", "total-turns", "best-run-distance", "best-run-turns",
+      "current-run-distance", "current-run-turns", "total-effective-distance",
+      "best-run-effective-distance", "current-run-effective-distance",
+      "total-time", "best-run-time", "current-run-time", "score"};
+  return stat < sizeof(kNames) / sizeof(kNames[0]) ? kNames[stat] : "score";
+}
+
+inline bool answers(uint16_t opcode) {
+  switch (opcode) {
+    case HADAK_SET_WALL:
+    case HADAK_CLEAR_WALL:
+    case HADAK_SET_COLOR:
+    case HADAK_CLEAR_COLOR:
+    case HADAK_CLEAR_ALL_COLOR:
+    case HADAK_SET_TEXT:
+    case HADAK_CLEAR_TEXT:
+    case HADAK_CLEAR_ALL_TEXT:
+    case HADAK_SET_COLOR_GRID:
+    case HADAK_SET_TEXT_GRID:
+    case HADAK_SET_COLOR_RECT:
+      return false;
+    default:
+      return true;
+  }
+}
+
+inline int32_t packCell(int32_t x, int32_t y) {
+  return static_cast<int32_t>((static_cast<uint32_t>(y) << 16) |
+                              (static_cast<uint32_t>(x) & 0xffff));
+}
+
+inline void appendInt(std::string *out, int32_t value) {
+  char digits[16];
+  auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  out->push_back(' ');
+  out->append(digits, end);
+}
+
+// The text form of a binary request.
+inline void appendLine(std::string *out, uint16_t opcode, uint16_t aux,
+                       int32_t a, int32_t b, std::string_view payload) {
+  out->append(commandName(opcode));
+  switch (opcode) {
+    case HADAK_GOAL_CELL:
+    case HADAK_PUSH_SENSE:
+      appendInt(out, a);
+      break;
+    case HADAK_WALL_FRONT:
+    case HADAK_WALL_RIGHT:
+    case HADAK_WALL_LEFT:
+    case HADAK_WALL_BACK:
+    case HADAK_WALL_FRONT_RIGHT:
+    case HADAK_WALL_FRONT_LEFT:
+    case HADAK_WALL_BACK_RIGHT:
+    case HADAK_WALL_BACK_LEFT:
+    case HADAK_MOVE_FORWARD:
+    case HADAK_MOVE_FORWARD_HALF:
+    case HADAK_SENSE:
+      if (a != 1) {
+        appendInt(out, a);
+      }
+      break;
+    case HADAK_CLEAR_COLOR:
+    case HADAK_CLEAR_TEXT:
+    case HADAK_FLOOD_KNOWN:
+      appendInt(out, a);
+      appendInt(out, b);
+      break;
+    case HADAK_SET_WALL:
+    case HADAK_CLEAR_WALL:
+    case HADAK_SET_COLOR:
+      appendInt(out, a);
+      appendInt(out, b);
+      out->push_back(' ');
+      out->push_back(static_cast<char>(aux));
+      break;
+    case HADAK_SET_COLOR_RECT:
+      appendInt(out, static_cast<int16_t>(a & 0xffff));
+      appendInt(out, static_cast<int16_t>(a >> 16));
+      appendInt(out, static_cast<int16_t>(b & 0xffff));
+      appendInt(out, static_cast<int16_t>(b >> 16));
+      out->push_back(' ');
+      out->push_back(static_cast<char>(aux));
+      break;
+    case HADAK_SET_TEXT:
+      appendInt(out, a);
+      appendInt(out, b);
+      out->push_back(' ');
+      out->append(payload);
+      break;
+    case HADAK_SET_COLOR_GRID:
+    case HADAK_SET_TEXT_GRID:
+    case HADAK_RUN_PATH:
+      out->push_back(' ');
+      out->append(payload);
+      break;
+    case HADAK_GET_STAT:
+      out->push_back(' ');
+      out->append(statName(aux));
+      break;
+    default:
+      break;
+  }
+  out->push_back('\n');
+}
+
+inline int32_t parseInt(std::string_view token) {
+  int32_t value = 0;
+  std::from_chars(token.data(), token.data() + token.size(), value);
+  return value;
+}
+
+inline int headingIndex(std::string_view name) {
+  static const char *const kHeadings[] = {"e", "ne", "n", "nw",
+                                          "w", "sw", "s", "se"};
+  for (int i = 0; i < 8; ++i) {
+    if (name == kHeadings[i]) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+// Decodes a text answer the way the binary response would read.
+inline BotAnswer parseLine(uint16_t opcode, std::string_view line) {
+  std::string_view tokens[6];
+  int count = 0;
+  size_t at = 0;
+  while (count < 6 && at < line.size()) {
+    size_t end = line.find(' ', at);
+    if (end == std::string_view::npos) {
+      end = line.size();
+    }
+    if (end > at) {
+      tokens[count++] = line.substr(at, end - at);
+    }
+    at = end + 1;
+  }
+  BotAnswer answer;
+  if (count == 0) {
+    answer.status = HADAK_IO_ERROR;
+    return answer;
+  }
+  switch (opcode) {
+    case HADAK_MAZE_WIDTH:
+    case HADAK_MAZE_HEIGHT:
+    case HADAK_GOAL_COUNT:
+    case HADAK_SENSE:
+    case HADAK_FLOOD_KNOWN:
+      answer.value = parseInt(tokens[0]);
+      break;
+    case HADAK_GOAL_CELL:
+      answer.value = parseInt(tokens[0]);
+      answer.extra = count > 1 ? parseInt(tokens[1]) : 0;
+      break;
+    case HADAK_GET_STAT: {
+      float number = std::strtof(std::string(tokens[0]).c_str(), nullptr);
+      std::memcpy(&answer.value, &number, sizeof(number));
+      break;
+    }
+    case HADAK_NEXT_MOVE_KNOWN: {
+      const char *found = std::strchr("nesw", tokens[0][0]);
+      answer.value = tokens[0] == "none" || !found
+                         ? -1
+                         : static_cast<int32_t>(found - "nesw");
+      break;
+    }
+    case HADAK_MOVE_FORWARD:
+    case HADAK_MOVE_FORWARD_HALF:
+    case HADAK_TURN_RIGHT:
+    case HADAK_TURN_LEFT:
+    case HADAK_TURN_RIGHT_45:
+    case HADAK_TURN_LEFT_45:
+    case HADAK_ACK_RESET:
+    case HADAK_RUN_PATH: {
+      answer.status = tokens[0] == "crash" ? HADAK_CRASH : HADAK_OK;
+      int next = 1;
+      int32_t step = 0;
+      if (opcode == HADAK_RUN_PATH && answer.crashed() && count > 1) {
+        step = parseInt(tokens[next++]);
+      }
+      answer.value = step;
+      if (count - next >= 4) {
+        answer.value = parseInt(tokens[next]) |
+                       headingIndex(tokens[next + 3])
+                           << HADAK_PUSH_HEADING_SHIFT |
+                       step << HADAK_PUSH_STEP_SHIFT;
+        answer.extra =
+            packCell(parseInt(tokens[next + 1]), parseInt(tokens[next + 2]));
+      }
+      break;
+    }
+    default:
+      answer.value = tokens[0] == "true" ? 1 : 0;
+      break;
+  }
+  return answer;
+}
+
+}  // namespace detail
+
+// The commands, written once for BotClient (which answers each at once)
+// and BotBatch (which hands out the index of the answer to come).
+template <typename Self, typename Result>
+class BotCommands {
+ public:
+  Result mazeWidth() { return ask(HADAK_MAZE_WIDTH); }
+  Result mazeHeight() { return ask(HADAK_MAZE_HEIGHT); }
+  Result goalCount() { return ask(HADAK_GOAL_COUNT); }
+  // value = x, extra = y.
+  Result goalCell(int index) { return ask(HADAK_GOAL_CELL, 0, index); }
+  Result isGoal() { return ask(HADAK_IS_GOAL); }
+
+  Result wallFront(int n = 1) { return ask(HADAK_WALL_FRONT, 0, n); }
+  Result wallRight(int n = 1) { return ask(HADAK_WALL_RIGHT, 0, n); }
+  Result wallLeft(int n = 1) { return ask(HADAK_WALL_LEFT, 0, n); }
+  Result wallBack(int n = 1) { return ask(HADAK_WALL_BACK, 0, n); }
+  Result wallFrontRight(int n = 1) {
+    return ask(HADAK_WALL_FRONT_RIGHT, 0, n);
+  }
+  Result wallFrontLeft(int n = 1) { return ask(HADAK_WALL_FRONT_LEFT, 0, n); }
+  Result wallBackRight(int n = 1) { return ask(HADAK_WALL_BACK_RIGHT, 0, n); }
+  Result wallBackLeft(int n = 1) { return ask(HADAK_WALL_BACK_LEFT, 0, n); }
+  // The hadak_sense_bit mask.
+  Result sense(int n = 1) { return ask(HADAK_SENSE, 0, n); }
+
+  Result moveForward(int n = 1) { return ask(HADAK_MOVE_FORWARD, 0, n); }
+  Result moveForwardHalf(int n = 1) {
+    return ask(HADAK_MOVE_FORWARD_HALF, 0, n);
+  }
+  Result turnRight() { return ask(HADAK_TURN_RIGHT); }
+  Result turnLeft() { return ask(HADAK_TURN_LEFT); }
+  Result turnRight45() { return ask(HADAK_TURN_RIGHT_45); }
+  Result turnLeft45() { return ask(HADAK_TURN_LEFT_45); }
+  // "F3 R F2 L45 D4"; a crash has the failing step in value.
+  Result runPath(std::string_view program) {
+    return ask(HADAK_RUN_PATH, 0, 0, 0, program);
+  }
+
+  // direction is 'n', 'e', 's' or 'w'.
+  Result setWall(int x, int y, char direction) {
+    return ask(HADAK_SET_WALL, static_cast<uint8_t>(direction), x, y);
+  }
+  Result clearWall(int x, int y, char direction) {
+    return ask(HADAK_CLEAR_WALL, static_cast<uint8_t>(direction), x, y);
+  }
+  Result setColor(int x, int y, char color) {
+    return ask(HADAK_SET_COLOR, static_cast<uint8_t>(color), x, y);
+  }
+  Result clearColor(int x, int y) { return ask(HADAK_CLEAR_COLOR, 0, x, y); }
+  Result clearAllColor() { return ask(HADAK_CLEAR_ALL_COLOR); }
+  Result setText(int x, int y, std::string_view text) {
+    return ask(HADAK_SET_TEXT, 0, x, y, text);
+  }
+  Result clearText(int x, int y) { return ask(HADAK_CLEAR_TEXT, 0, x, y); }
+  Result clearAllText() { return ask(HADAK_CLEAR_ALL_TEXT); }
+  Result setColorRect(int x0, int y0, int x1, int y1, char color) {
+    return ask(HADAK_SET_COLOR_RECT, static_cast<uint8_t>(color),
+               detail::packCell(x0, y0), detail::packCell(x1, y1));
+  }
+  Result setColorGrid(std::string_view grid) {
+    return ask(HADAK_SET_COLOR_GRID, 0, 0, 0, grid);
+  }
+  Result setTextGrid(std::string_view grid) {
+    return ask(HADAK_SET_TEXT_GRID, 0, 0, 0, grid);
+  }
+
+  Result wasReset() { return ask(HADAK_WAS_RESET); }
+  Result ackReset() { return ask(HADAK_ACK_RESET); }
+  // stat is a StatId (src/engine/Stats.h); read the answer with stat().
+  Result getStat(uint16_t stat) { return ask(HADAK_GET_STAT, stat); }
+
+  // Distance to the goal over the walls declared so far, -1 if none.
+  Result floodKnown(int x, int y) { return ask(HADAK_FLOOD_KNOWN, 0, x, y); }
+  // value = a direction, 0 north to 3 west, or -1.
+  Result nextMoveKnown() { return ask(HADAK_NEXT_MOVE_KNOWN); }
+  // From here on movements answer with the sense mask and pose.
+  Result pushSense(bool enabled) {
+    return ask(HADAK_PUSH_SENSE, 0, enabled ? 1 : 0);
+  }
+
+ private:
+  Result ask(uint16_t opcode, uint16_t aux = 0, int32_t a = 0, int32_t b = 0,
+             std::string_view payload = {}) {
+    return static_cast<Self *>(this)->issue(opcode, aux, a, b, payload);
+  }
+};
+
+class BotClient : public BotCommands<BotClient, BotAnswer> {
+ public:
+  // Speaks binary frames when the simulator agrees, unless binary is
+  // false. Nothing else may have been written to the simulator yet.
+  explicit BotClient(bool binary = true) {
+    if (!binary) {
+      return;
+    }
+    m_out.append(kBinaryRequest);
+    std::string_view reply;
+    m_binary = flush() && readLine(&reply) && reply == kBinaryAccepted;
+  }
+  ~BotClient() { flush(); }
+
+  BotClient(const BotClient &) = delete;
+  BotClient &operator=(const BotClient &) = delete;
+
+  bool isBinary() const { return m_binary; }
+  bool isSharedMemory() const { return hadak_shm_get() != nullptr; }
+
+  // Buffers a request; one that answers is owed an answer() later.
+  void post(uint16_t opcode, uint16_t aux, int32_t a, int32_t b,
+            std::string_view payload = {}) {
+    if (m_binary) {
+      size_t size = payload.size() < 0xffff ? payload.size() : 0xffff;
+      bool carries = opcode == HADAK_SET_TEXT ||
+                     opcode == HADAK_SET_COLOR_GRID ||
+                     opcode == HADAK_SET_TEXT_GRID ||
+                     opcode == HADAK_RUN_PATH;
+      unsigned char frame[HADAK_FRAME_SIZE];
+      hadak_put16(frame, opcode);
+      hadak_put16(frame + 2, carries ? static_cast<uint16_t>(size) : aux);
+      hadak_put32(frame + 4, a);
+      hadak_put32(frame + 8, b);
+      m_out.append(reinterpret_cast<const char *>(frame), sizeof(frame));
+      if (carries) {
+        m_out.append(payload.data(), size);
+      }
+    } else {
+      detail::appendLine(&m_out, opcode, aux, a, b, payload);
+    }
+    if (detail::answers(opcode)) {
+      m_owed.push_back(opcode);
+    }
+    if (m_out.size() >= kFlushBytes) {
+      flush();
+    }
+  }
+
+  // Writes out everything buffered.
+  bool flush() {
+    if (m_out.empty()) {
+      return m_good;
+    }
+    m_good = m_good && hadak_write_all(m_out.data(), m_out.size());
+    m_out.clear();
+    return m_good;
+  }
+
+  size_t owed() const { return m_owed.size(); }
+
+  // The answer to the oldest request still owed one, flushing first.
+  BotAnswer answer() {
+    BotAnswer answer;
+    answer.status = HADAK_IO_ERROR;
+    if (m_owed.empty() || !flush()) {
+      return answer;
+    }
+    uint16_t opcode = m_owed.front();
+    m_owed.pop_front();
+    if (m_binary) {
+      if (!fill(HADAK_FRAME_SIZE)) {
+        return answer;
+      }
+      auto *frame = reinterpret_cast<const unsigned char *>(m_in.data()) +
+                    m_begin;
+      m_begin += HADAK_FRAME_SIZE;
+      answer.status = hadak_get16(frame + 2) == 0 ? HADAK_OK : HADAK_CRASH;
+      answer.value = hadak_get32(frame + 4);
+      answer.extra = hadak_get32(frame + 8);
+      return answer;
+    }
+    std::string_view line;
+    if (!readLine(&line)) {
+      return answer;
+    }
+    return detail::parseLine(opcode, line);
+  }
+
+  // BotCommands: answered at once, or buffered when there is no answer.
+  BotAnswer issue(uint16_t opcode, uint16_t aux, int32_t a, int32_t b,
+                  std::string_view payload) {
+    // Answers still owed to a batch that was never run are dropped.
+    while (!m_owed.empty() && m_good) {
+      answer();
+    }
+    post(opcode, aux, a, b, payload);
+    return m_owed.empty() ? BotAnswer() : answer();
+  }
+
+ private:
+  static constexpr const char *kBinaryRequest = "protocol binary 1\n";
+  static constexpr std::string_view kBinaryAccepted = "ok binary 1";
+  static const size_t kFlushBytes = 1 << 16;
+  static const size_t kReadBytes = 1 << 16;
+
+  bool m_binary = false;
+  bool m_good = true;
+  std::string m_out;
+  std::deque<uint16_t> m_owed;
+  std::vector<char> m_in = std::vector<char>(kReadBytes);
+  size_t m_begin = 0;
+  size_t m_end = 0;
+
+  // Reads until at least size bytes are buffered.
+  bool fill(size_t size) {
+    while (m_end - m_begin < size) {
+      if (!readMore()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool readMore() {
+    if (m_begin > 0) {
+      std::memmove(m_in.data(), m_in.data() + m_begin, m_end - m_begin);
+      m_end -= m_begin;
+      m_begin = 0;
+    }
+    if (m_end == m_in.size()) {
+      m_in.resize(m_in.size() * 2);
+    }
+    char *at = m_in.data() + m_end;
+    size_t room = m_in.size() - m_end;
+    ssize_t got = hadak_shm_get()
+                      ? static_cast<ssize_t>(hadak_shm_read_some(at, room, -1))
+                      : read(STDIN_FILENO, at, room);
+    if (got <= 0) {
+      m_good = false;
+      return false;
+    }
+    m_end += static_cast<size_t>(got);
+    return true;
+  }
+
+  // The next line without its newline, valid until the next read.
+  bool readLine(std::string_view *line) {
+    // Bytes after m_begin already known to hold no newline.
+    size_t checked = 0;
+    while (true) {
+      const char *start = m_in.data() + m_begin;
+      const void *newline =
+          std::memchr(start + checked, '\n', m_end - m_begin - checked);
+      if (newline) {
+        size_t length = static_cast<const char *>(newline) - start;
+        *line = std::string_view(start, length);
+        if (!line->empty() && line->back() == '\r') {
+          line->remove_suffix(1);
+        }
+        m_begin += length + 1;
+        return true;
+      }
+      checked = m_end - m_begin;
+      if (!readMore()) {
+        return false;
+      }
+    }
+  }
+};
+
+// Requests sent together in one write; run() sends them and reads every
+// answer, so a burst costs one round trip. Each command returns the index
+// of its answer, or -1 for a command that does not answer.
+class BotBatch : public BotCommands<BotBatch, int> {
+ public:
+  explicit BotBatch(BotClient &client) : m_client(client) {}
+
+  bool run() {
+    bool good = true;
+    for (size_t i = m_answers.size(); i < m_asked; ++i) {
+      m_answers.push_back(m_client.answer());
+      good = good && m_answers.back().status != HADAK_IO_ERROR;
+    }
+    if (m_asked == 0) {
+      good = m_client.flush();
+    }
+    return good;
+  }
+  // Forgets the answers so the batch can be filled again.
+  void clear() {
+    m_answers.clear();
+    m_asked = 0;
+  }
+
+  const BotAnswer &operator[](int index) const { return m_answers[index]; }
+  size_t size() const { return m_answers.size(); }
+
+  // BotCommands.
+  int issue(uint16_t opcode, uint16_t aux, int32_t a, int32_t b,
+            std::string_view payload) {
+    m_client.post(opcode, aux, a, b, payload);
+    return detail::answers(opcode) ? static_cast<int>(m_asked++) : -1;
+  }
+
+ private:
+  BotClient &m_client;
+  std::vector<BotAnswer> m_answers;
+  size_t m_asked = 0;
+};
+
+}  // namespace hadak
+
+#endif  // HADAK_CLIENT_HPP
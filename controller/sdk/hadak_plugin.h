@@ -0,0 +1,82 @@
+/* In-process bot plugins for Hadak Micromouse Studio.
+ *
+ * A plugin is a shared library (.so) exporting the four hadak_bot_*
+ * functions below with C linkage. The simulator loads it, creates one
+ * context per run and calls hadak_bot_step whenever the mouse is idle.
+ * A step may ask any number of questions and start at most one movement,
+ * then returns; the next step runs once that movement has finished.
+ *
+ *   int hadak_bot_step(void *ctx, const struct hadak_api *api) {
+ *     int32_t walls;
+ *     api->call(api->sim, HADAK_SENSE, 0, 1, 0, &walls, NULL);
+ *     if (walls & HADAK_SENSE_GOAL) return HADAK_DONE;
+ *     if (!(walls & HADAK_SENSE_FRONT))
+ *       api->call(api->sim, HADAK_MOVE_FORWARD, 0, 1, 0, NULL, NULL);
+ *     else
+ *       api->call(api->sim, HADAK_TURN_RIGHT, 0, 0, 0, NULL, NULL);
+ *     return HADAK_CONTINUE;
+ *   }
+ *
+ * call() takes the fields of a binary request and answers like a binary
+ * response (see hadak_protocol.h), but nothing is serialised: it runs the
+ * command against the simulation directly. Requests that carry a payload
+ * (text, color and text grids, runPath programs) go through call_payload
+ * instead, which is also the cheapest way to draw a whole overlay:
+ *
+ *   static const char grid[] = "16R 224. 16G";
+ *   api->call_payload(api->sim, HADAK_SET_COLOR_GRID, 0, 0, grid,
+ *                     sizeof(grid) - 1, NULL, NULL);
+ *
+ * Build with
+ *   cc -shared -fPIC -Icontroller/sdk -o controller/bots/my_bot.so my_bot.c
+ * and the bot appears in the GUI's bot list next to the Python scripts. */
+#ifndef HADAK_PLUGIN_H
+#define HADAK_PLUGIN_H
+
+#include <stdint.h>
+
+#include "hadak_protocol.h"
+
+#define HADAK_PLUGIN_ABI 2u
+
+/* Extra call() results on top of HADAK_OK and HADAK_CRASH. */
+enum hadak_plugin_status {
+  HADAK_PENDING = 2, /* a movement started; return from the step */
+  HADAK_BUSY = 3,    /* a movement was already started in this step */
+  HADAK_INVALID = 4  /* unknown opcode or bad arguments */
+};
+
+enum hadak_step_result { HADAK_CONTINUE = 0, HADAK_DONE = 1 };
+
+struct hadak_api {
+  uint32_t abi;
+  void *sim;
+  int (*call)(void *sim, uint16_t opcode, uint16_t aux, int32_t a,
+              int32_t b, int32_t *value, int32_t *extra);
+  int (*set_text)(void *sim, int32_t x, int32_t y, const char *text);
+  /* HADAK_OK or HADAK_CRASH for the movement the previous step started. */
+  int (*last_move)(void *sim);
+  void (*log)(void *sim, const char *message);
+  /* Since ABI 2. For the opcodes whose binary request is followed by a
+   * payload: size bytes at payload take the place of the payload and its
+   * length in aux. call() answers HADAK_INVALID for these opcodes. */
+  int (*call_payload)(void *sim, uint16_t opcode, int32_t a, int32_t b,
+                      const char *payload, uint16_t size, int32_t *value,
+                      int32_t *extra);
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns HADAK_PLUGIN_ABI; the simulator refuses other versions. */
+uint32_t hadak_bot_abi(void);
+void *hadak_bot_create(const struct hadak_api *api);
+int hadak_bot_step(void *ctx, const struct hadak_api *api);
+void hadak_bot_destroy(void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HADAK_PLUGIN_H */
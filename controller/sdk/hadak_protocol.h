@@ -0,0 +1,248 @@
+/* Binary protocol client for Hadak Micromouse Studio bots written in C,
+ * C++ or anything that can include a C header.
+ *
+ *   if (!hadak_binary_begin()) { ...stay on the text protocol... }
+ *   int32_t wall;
+ *   hadak_call(HADAK_WALL_FRONT, 0, 1, 0, &wall, NULL);
+ *
+ * Frames are 12 bytes, little-endian: u16 opcode, u16 aux, i32 a, i32 b for
+ * requests and u16 opcode, u16 status, i32 value, i32 extra for responses.
+ * See src/controller/BinaryProtocol.h for what aux, a and b carry. Commands
+ * that have no text response (setWall, setColor, setText, ...) have no
+ * binary response either: use hadak_send for them.
+ *
+ * When the simulator offers the shared-memory transport (see hadak_shm.h)
+ * every call here goes over it instead of stdin/stdout. */
+#ifndef HADAK_PROTOCOL_H
+#define HADAK_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hadak_shm.h"
+
+enum hadak_opcode {
+  HADAK_MAZE_WIDTH = 1,
+  HADAK_MAZE_HEIGHT = 2,
+  HADAK_GOAL_COUNT = 3,
+  HADAK_GOAL_CELL = 4,
+  HADAK_IS_GOAL = 5,
+  HADAK_WALL_FRONT = 6,
+  HADAK_WALL_RIGHT = 7,
+  HADAK_WALL_LEFT = 8,
+  HADAK_WALL_BACK = 9,
+  HADAK_WALL_FRONT_RIGHT = 10,
+  HADAK_WALL_FRONT_LEFT = 11,
+  HADAK_WALL_BACK_RIGHT = 12,
+  HADAK_WALL_BACK_LEFT = 13,
+  HADAK_MOVE_FORWARD = 14,
+  HADAK_MOVE_FORWARD_HALF = 15,
+  HADAK_TURN_RIGHT = 16,
+  HADAK_TURN_LEFT = 17,
+  HADAK_TURN_RIGHT_45 = 18,
+  HADAK_TURN_LEFT_45 = 19,
+  HADAK_SET_WALL = 20,
+  HADAK_CLEAR_WALL = 21,
+  HADAK_SET_COLOR = 22,
+  HADAK_CLEAR_COLOR = 23,
+  HADAK_CLEAR_ALL_COLOR = 24,
+  HADAK_SET_TEXT = 25,
+  HADAK_CLEAR_TEXT = 26,
+  HADAK_CLEAR_ALL_TEXT = 27,
+  HADAK_WAS_RESET = 28,
+  HADAK_ACK_RESET = 29,
+  HADAK_GET_STAT = 30,
+  HADAK_SENSE = 31,
+  HADAK_SET_COLOR_GRID = 32,
+  HADAK_SET_TEXT_GRID = 33,
+  HADAK_SET_COLOR_RECT = 34,
+  HADAK_RUN_PATH = 35,
+  HADAK_FLOOD_KNOWN = 36,
+  HADAK_NEXT_MOVE_KNOWN = 37,
+  HADAK_PUSH_SENSE = 38
+};
+
+/* Bits of the HADAK_SENSE answer. */
+enum hadak_sense_bit {
+  HADAK_SENSE_FRONT = 1 << 0,
+  HADAK_SENSE_LEFT = 1 << 1,
+  HADAK_SENSE_RIGHT = 1 << 2,
+  HADAK_SENSE_BACK = 1 << 3,
+  HADAK_SENSE_FRONT_LEFT = 1 << 4,
+  HADAK_SENSE_FRONT_RIGHT = 1 << 5,
+  HADAK_SENSE_BACK_LEFT = 1 << 6,
+  HADAK_SENSE_BACK_RIGHT = 1 << 7,
+  HADAK_SENSE_GOAL = 1 << 8,
+  HADAK_SENSE_RESET = 1 << 9
+};
+
+/* After HADAK_PUSH_SENSE with a = 1, a move's value is the sense mask with
+ * the heading (0 east, counting 45 degree steps anticlockwise) and a
+ * crashed HADAK_RUN_PATH step shifted in, and extra is x | y << 16. */
+#define HADAK_PUSH_HEADING_SHIFT 12
+#define HADAK_PUSH_STEP_SHIFT 16
+
+enum hadak_status { HADAK_OK = 0, HADAK_CRASH = 1, HADAK_IO_ERROR = -1 };
+
+#define HADAK_FRAME_SIZE 12
+
+static inline void hadak_put16(unsigned char *out, uint16_t value) {
+  out[0] = (unsigned char)(value & 0xff);
+  out[1] = (unsigned char)(value >> 8);
+}
+
+static inline void hadak_put32(unsigned char *out, int32_t value) {
+  uint32_t bits = (uint32_t)value;
+  out[0] = (unsigned char)(bits & 0xff);
+  out[1] = (unsigned char)((bits >> 8) & 0xff);
+  out[2] = (unsigned char)((bits >> 16) & 0xff);
+  out[3] = (unsigned char)(bits >> 24);
+}
+
+static inline uint16_t hadak_get16(const unsigned char *in) {
+  return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static inline int32_t hadak_get32(const unsigned char *in) {
+  return (int32_t)((uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+                   ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24));
+}
+
+static inline int hadak_write_all(const void *data, size_t size) {
+  if (hadak_shm_get()) {
+    return hadak_shm_write(data, size);
+  }
+  const char *cursor = (const char *)data;
+  while (size > 0) {
+    ssize_t written = write(STDOUT_FILENO, cursor, size);
+    if (written <= 0) {
+      return 0;
+    }
+    cursor += written;
+    size -= (size_t)written;
+  }
+  return 1;
+}
+
+static inline int hadak_read_all(void *data, size_t size) {
+  if (hadak_shm_get()) {
+    return hadak_shm_read(data, size);
+  }
+  char *cursor = (char *)data;
+  while (size > 0) {
+    ssize_t got = read(STDIN_FILENO, cursor, size);
+    if (got <= 0) {
+      return 0;
+    }
+    cursor += got;
+    size -= (size_t)got;
+  }
+  return 1;
+}
+
+/* Sends the handshake line and reads the reply. Returns 1 once both sides
+ * speak frames, 0 if the simulator kept the text protocol. Call it before
+ * any other output and do not mix in stdio writes to stdout afterwards. */
+static inline int hadak_binary_begin(void) {
+  static const char handshake[] = "protocol binary 1\n";
+  static const char accepted[] = "ok binary 1\n";
+  char reply[32];
+  size_t used = 0;
+  if (!hadak_write_all(handshake, sizeof(handshake) - 1)) {
+    return 0;
+  }
+  while (used + 1 < sizeof(reply)) {
+    if (!hadak_read_all(reply + used, 1)) {
+      return 0;
+    }
+    if (reply[used++] == '\n') {
+      break;
+    }
+  }
+  return used == sizeof(accepted) - 1 &&
+         memcmp(reply, accepted, used) == 0;
+}
+
+static inline int hadak_send(uint16_t opcode, uint16_t aux, int32_t a,
+                             int32_t b) {
+  unsigned char frame[HADAK_FRAME_SIZE];
+  hadak_put16(frame, opcode);
+  hadak_put16(frame + 2, aux);
+  hadak_put32(frame + 4, a);
+  hadak_put32(frame + 8, b);
+  return hadak_write_all(frame, sizeof(frame));
+}
+
+/* setText, setColorGrid and setTextGrid carry their UTF-8 text or grid
+ * payload after the frame. */
+static inline int hadak_send_payload(uint16_t opcode, int32_t a, int32_t b,
+                                     const char *payload) {
+  size_t size = strlen(payload);
+  if (size > 0xffff) {
+    size = 0xffff;
+  }
+  return hadak_send(opcode, (uint16_t)size, a, b) &&
+         hadak_write_all(payload, size);
+}
+
+static inline int hadak_send_text(int32_t x, int32_t y, const char *text) {
+  return hadak_send_payload(HADAK_SET_TEXT, x, y, text);
+}
+
+/* Fills the cells between two opposite corners with one color. */
+static inline int hadak_send_rect(int32_t x0, int32_t y0, int32_t x1,
+                                  int32_t y1, char color) {
+  return hadak_send(HADAK_SET_COLOR_RECT, (uint16_t)(unsigned char)color,
+                    (int32_t)(((uint32_t)y0 << 16) | ((uint32_t)x0 & 0xffff)),
+                    (int32_t)(((uint32_t)y1 << 16) | ((uint32_t)x1 & 0xffff)));
+}
+
+/* Sends one request and waits for its response. Returns HADAK_OK,
+ * HADAK_CRASH or HADAK_IO_ERROR; value and extra may be NULL. */
+static inline int hadak_call(uint16_t opcode, uint16_t aux, int32_t a,
+                             int32_t b, int32_t *value, int32_t *extra) {
+  unsigned char frame[HADAK_FRAME_SIZE];
+  if (!hadak_send(opcode, aux, a, b) ||
+      !hadak_read_all(frame, sizeof(frame))) {
+    return HADAK_IO_ERROR;
+  }
+  if (value) {
+    *value = hadak_get32(frame + 4);
+  }
+  if (extra) {
+    *extra = hadak_get32(frame + 8);
+  }
+  return hadak_get16(frame + 2) == 0 ? HADAK_OK : HADAK_CRASH;
+}
+
+/* Runs a whole motion program such as "F3 R F2 L45 D4" and waits for it
+ * to finish. Returns HADAK_CRASH with the failing step's index in *step,
+ * HADAK_OK, or HADAK_IO_ERROR; step may be NULL. Pass push_sense nonzero
+ * while HADAK_PUSH_SENSE is on, as the step then sits above the mask. */
+static inline int hadak_run_path(const char *path, int push_sense,
+                                 int32_t *step) {
+  unsigned char frame[HADAK_FRAME_SIZE];
+  if (!hadak_send_payload(HADAK_RUN_PATH, 0, 0, path) ||
+      !hadak_read_all(frame, sizeof(frame))) {
+    return HADAK_IO_ERROR;
+  }
+  if (step) {
+    uint32_t value = (uint32_t)hadak_get32(frame + 4);
+    *step = (int32_t)(push_sense ? value >> HADAK_PUSH_STEP_SHIFT : value);
+  }
+  return hadak_get16(frame + 2) == 0 ? HADAK_OK : HADAK_CRASH;
+}
+
+/* getStat answers with the float's bit pattern; -1 means "no value". */
+static inline float hadak_stat(uint16_t stat) {
+  int32_t bits = 0;
+  float value = -1.0f;
+  if (hadak_call(HADAK_GET_STAT, stat, 0, 0, &bits, NULL) == HADAK_OK) {
+    memcpy(&value, &bits, sizeof(value));
+  }
+  return value;
+}
+
+#endif /* HADAK_PROTOCOL_H */
@@ -0,0 +1,283 @@
+/* Shared-memory transport for Hadak Micromouse Studio bots.
+ *
+ * When the simulator offers it, the HADAK_SHM environment variable names a
+ * POSIX shared-memory region holding two single-producer single-consumer
+ * byte rings, one each way. They carry exactly the bytes stdin/stdout would
+ * (text lines or binary frames), so only the transport changes:
+ *
+ *   if (hadak_shm_get()) {
+ *     char reply[64];
+ *     hadak_shm_write("mazeWidth\n", 10);
+ *     hadak_shm_read_line(reply, sizeof(reply));
+ *   }
+ *
+ * hadak_protocol.h switches to the rings by itself. The simulator answers
+ * on whichever transport the bot spoke first, so a bot that ignores
+ * HADAK_SHM keeps working on its pipes; just do not mix the two.
+ *
+ * Both sides spin briefly before sleeping. The bot sleeps on a futex on the
+ * ring counters; the simulator sleeps in its event loop and is woken
+ * through the eventfd whose number is in the region header. Linux only:
+ * elsewhere hadak_shm_get() always returns NULL. */
+#ifndef HADAK_SHM_H
+#define HADAK_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* libc's syscall() under a name of our own: <unistd.h> only declares it for
+ * the GNU and BSD dialects, which strict ISO modes such as -std=c99 turn
+ * off, and a header cannot turn them back on once stdio.h is in. */
+long hadak_shm_syscall(long number, ...) __asm__("syscall");
+#endif
+
+#define HADAK_SHM_ENV "HADAK_SHM"
+#define HADAK_SHM_MAGIC 0x4b534448u /* "HDSK" */
+#define HADAK_SHM_VERSION 1u
+#define HADAK_SHM_RING_SIZE 65536u
+#define HADAK_SHM_SPIN 4096
+
+/* head and tail count bytes ever written and read; they wrap freely and
+ * head - tail is the fill level. Each cache line is written by one side
+ * only: the producer owns head and producer_sleeping, the consumer owns
+ * tail and consumer_sleeping. A set sleeping flag asks the other side for
+ * a wakeup after it next moves its counter. */
+struct hadak_shm_ring {
+  uint32_t head;
+  uint32_t producer_sleeping;
+  uint8_t producer_pad[56];
+  uint32_t tail;
+  uint32_t consumer_sleeping;
+  uint8_t consumer_pad[56];
+  uint8_t data[HADAK_SHM_RING_SIZE];
+};
+
+struct hadak_shm_region {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t ring_size;
+  int32_t sim_eventfd;
+  uint8_t pad[48];
+  struct hadak_shm_ring to_sim;
+  struct hadak_shm_ring to_bot;
+};
+
+#ifdef __linux__
+
+static inline uint32_t hadak_shm_load(const uint32_t *word) {
+  return __atomic_load_n(word, __ATOMIC_ACQUIRE);
+}
+
+static inline void hadak_shm_store(uint32_t *word, uint32_t value) {
+  __atomic_store_n(word, value, __ATOMIC_RELEASE);
+}
+
+/* Maps the region named by HADAK_SHM on first use; NULL when there is
+ * none. The mapping lives until the process exits. */
+static inline struct hadak_shm_region *hadak_shm_get(void) {
+  static int tried = 0;
+  static struct hadak_shm_region *region = NULL;
+  if (tried) {
+    return region;
+  }
+  tried = 1;
+  const char *name = getenv(HADAK_SHM_ENV);
+  if (!name || !*name) {
+    return NULL;
+  }
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  void *mapped = mmap(NULL, sizeof(struct hadak_shm_region),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return NULL;
+  }
+  region = (struct hadak_shm_region *)mapped;
+  if (region->magic != HADAK_SHM_MAGIC ||
+      region->version != HADAK_SHM_VERSION ||
+      region->ring_size != HADAK_SHM_RING_SIZE) {
+    munmap(mapped, sizeof(struct hadak_shm_region));
+    region = NULL;
+  }
+  return region;
+}
+
+static inline void hadak_shm_wake_sim(struct hadak_shm_region *region) {
+  uint64_t one = 1;
+  if (write(region->sim_eventfd, &one, sizeof(one)) < 0) {
+    /* A full counter still wakes the simulator. */
+  }
+}
+
+/* Waits until *word moves away from seen: spin first, then park on the
+ * futex once the sleeping flag is published. */
+static inline void hadak_shm_wait(uint32_t *word, uint32_t seen,
+                                  uint32_t *sleeping) {
+  /* Spinning only pays off when the simulator has a core of its own. */
+  static long spin = -1;
+  if (spin < 0) {
+    spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? HADAK_SHM_SPIN : 0;
+  }
+  for (long i = 0; i < spin; ++i) {
+    if (hadak_shm_load(word) != seen) {
+      return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+  __atomic_store_n(sleeping, 1u, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n(word, __ATOMIC_SEQ_CST) == seen) {
+    hadak_shm_syscall(SYS_futex, word, FUTEX_WAIT, seen, NULL, NULL, 0);
+  }
+  __atomic_store_n(sleeping, 0u, __ATOMIC_RELAXED);
+}
+
+static inline int hadak_shm_write(const void *data, size_t size) {
+  struct hadak_shm_region *region = hadak_shm_get();
+  if (!region) {
+    return 0;
+  }
+  struct hadak_shm_ring *ring = &region->to_sim;
+  const uint8_t *cursor = (const uint8_t *)data;
+  while (size > 0) {
+    uint32_t head = ring->head;
+    uint32_t tail = hadak_shm_load(&ring->tail);
+    uint32_t space = HADAK_SHM_RING_SIZE - (head - tail);
+    if (space == 0) {
+      hadak_shm_wait(&ring->tail, tail, &ring->producer_sleeping);
+      continue;
+    }
+    uint32_t chunk = size < space ? (uint32_t)size : space;
+    uint32_t offset = head & (HADAK_SHM_RING_SIZE - 1);
+    uint32_t first = HADAK_SHM_RING_SIZE - offset;
+    if (first > chunk) {
+      first = chunk;
+    }
+    memcpy(ring->data + offset, cursor, first);
+    memcpy(ring->data, cursor + first, chunk - first);
+    hadak_shm_store(&ring->head, head + chunk);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->consumer_sleeping, __ATOMIC_RELAXED)) {
+      hadak_shm_wake_sim(region);
+    }
+    cursor += chunk;
+    size -= chunk;
+  }
+  return 1;
+}
+
+/* Copies out up to size bytes, stopping after the first stop byte when
+ * stop is not -1, and waits only while nothing at all is available. */
+static inline size_t hadak_shm_read_some(void *data, size_t size, int stop) {
+  struct hadak_shm_region *region = hadak_shm_get();
+  if (!region || size == 0) {
+    return 0;
+  }
+  struct hadak_shm_ring *ring = &region->to_bot;
+  uint32_t tail = ring->tail;
+  uint32_t head = hadak_shm_load(&ring->head);
+  while (head == tail) {
+    hadak_shm_wait(&ring->head, head, &ring->consumer_sleeping);
+    head = hadak_shm_load(&ring->head);
+  }
+  uint32_t available = head - tail;
+  uint32_t chunk = size < available ? (uint32_t)size : available;
+  uint8_t *out = (uint8_t *)data;
+  uint32_t copied = 0;
+  while (copied < chunk) {
+    uint8_t byte = ring->data[(tail + copied) & (HADAK_SHM_RING_SIZE - 1)];
+    out[copied++] = byte;
+    if (stop >= 0 && byte == (uint8_t)stop) {
+      break;
+    }
+  }
+  hadak_shm_store(&ring->tail, tail + copied);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ring->producer_sleeping, __ATOMIC_RELAXED)) {
+    hadak_shm_wake_sim(region);
+  }
+  return copied;
+}
+
+static inline int hadak_shm_read(void *data, size_t size) {
+  uint8_t *cursor = (uint8_t *)data;
+  while (size > 0) {
+    size_t got = hadak_shm_read_some(cursor, size, -1);
+    if (got == 0) {
+      return 0;
+    }
+    cursor += got;
+    size -= got;
+  }
+  return 1;
+}
+
+/* Reads one line without its newline into a NUL-terminated buffer. A line
+ * longer than the buffer is cut short and the rest is dropped. */
+static inline int hadak_shm_read_line(char *line, size_t size) {
+  size_t used = 0;
+  char skip[64];
+  if (size == 0) {
+    return 0;
+  }
+  while (1) {
+    char *target = used + 1 < size ? line + used : skip;
+    size_t room = used + 1 < size ? size - 1 - used : sizeof(skip);
+    size_t got = hadak_shm_read_some(target, room, '\n');
+    if (got == 0) {
+      return 0;
+    }
+    if (target == line + used) {
+      used += got;
+      if (line[used - 1] == '\n') {
+        line[used - 1] = '\0';
+        return 1;
+      }
+    } else if (skip[got - 1] == '\n') {
+      line[used] = '\0';
+      return 1;
+    }
+  }
+}
+
+#else
+
+static inline struct hadak_shm_region *hadak_shm_get(void) { return NULL; }
+static inline int hadak_shm_write(const void *data, size_t size) {
+  (void)data;
+  (void)size;
+  return 0;
+}
+static inline size_t hadak_shm_read_some(void *data, size_t size, int stop) {
+  (void)data;
+  (void)size;
+  (void)stop;
+  return 0;
+}
+static inline int hadak_shm_read(void *data, size_t size) {
+  (void)data;
+  (void)size;
+  return 0;
+}
+static inline int hadak_shm_read_line(char *line, size_t size) {
+  (void)line;
+  (void)size;
+  return 0;
+}
+
+#endif /* __linux__ */
+
+#endif /* HADAK_SHM_H */
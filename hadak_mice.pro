@@ -1,7 +1,13 @@
 TEMPLATE = subdirs
 
-SUBDIRS += app tests
+SUBDIRS += app tests replay tournament dispatchbench benchbot protocolbench
 
 app.file = src/hadak_mice.pro
 tests.file = tests/tests.pro
 tests.depends = app
+replay.file = tools/replay/replay.pro
+tournament.file = tools/tournament/tournament.pro
+dispatchbench.file = tools/dispatchbench/dispatchbench.pro
+benchbot.file = tools/protocolbench/benchbot.pro
+protocolbench.file = tools/protocolbench/protocolbench.pro
+protocolbench.depends = benchbot
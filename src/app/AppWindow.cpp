@@ -7,6 +7,7 @@
 #include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFontDatabase>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHBoxLayout>
@@ -25,8 +26,17 @@
 
 namespace hadak {
 
+namespace {
+
+const int kSpareBots = 2;
+const int kProfileRefreshMs = 500;
+
+}  // namespace
+
 AppWindow::AppWindow(QWidget *parent)
     : QMainWindow(parent), m_controller(&m_sim, this) {
+  m_botPool.setSize(kSpareBots);
+  m_bot.setPool(&m_botPool);
   buildUi();
   connectSignals();
   setTimerFromSlider(m_speedSlider->value());
@@ -35,6 +45,19 @@ AppWindow::AppWindow(QWidget *parent)
   QTimer::singleShot(0, this, [this]() { maybeAutoStartBot(); });
 }
 
+// Racer controllers are children of the window and would otherwise be
+// deleted after m_sim, which they hold a pointer to.
+AppWindow::~AppWindow() {
+  for (const Racer &racer : m_racers) {
+    racer.bot->disconnect();
+    racer.bot->stop();
+    racer.controller->attachBot(nullptr);
+    delete racer.controller;
+    delete racer.bot;
+  }
+  m_racers.clear();
+}
+
 void AppWindow::buildUi() {
   QWidget *central = new QWidget(this);
   setCentralWidget(central);
@@ -66,6 +89,18 @@ void AppWindow::buildUi() {
   controlsLayout->addWidget(speedLabel);
   controlsLayout->addWidget(m_speedSlider);
 
+  m_kinematic = new QCheckBox("Kinematic timing");
+  m_kinematic->setToolTip(
+      "Time segments with acceleration, top speed and turn durations "
+      "instead of counting ticks (resets the run)");
+  controlsLayout->addWidget(m_kinematic);
+
+  m_timelineLabel = new QLabel("Timeline");
+  m_timelineSlider = new QSlider(Qt::Horizontal);
+  m_timelineSlider->setRange(0, 0);
+  controlsLayout->addWidget(m_timelineLabel);
+  controlsLayout->addWidget(m_timelineSlider);
+
   QGroupBox *mazeBox = new QGroupBox("Maze");
   QVBoxLayout *mazeLayout = new QVBoxLayout(mazeBox);
   QPushButton *loadButton = new QPushButton("Load Maze");
@@ -135,13 +170,23 @@ void AppWindow::buildUi() {
   m_botDir->setPlaceholderText("Working directory");
   m_botStart = new QPushButton("Start Bot");
   m_botStop = new QPushButton("Stop Bot");
+  m_recordTrace = new QCheckBox("Record trace");
   QHBoxLayout *botButtons = new QHBoxLayout();
   botButtons->addWidget(m_botStart);
   botButtons->addWidget(m_botStop);
   botLayout->addWidget(m_botCommand);
   botLayout->addWidget(m_botDir);
+  botLayout->addWidget(m_recordTrace);
   botLayout->addLayout(botButtons);
 
+  m_addRacer = new QPushButton("Add Racer");
+  m_addRacer->setToolTip("Race the selected bot as another mouse in this maze");
+  m_focusSelector = new QComboBox();
+  QHBoxLayout *racerRow = new QHBoxLayout();
+  racerRow->addWidget(m_addRacer);
+  racerRow->addWidget(m_focusSelector);
+  botLayout->addLayout(racerRow);
+
   leftLayout->addWidget(controlsBox);
   leftLayout->addWidget(mazeBox);
   leftLayout->addWidget(overlayBox);
@@ -157,6 +202,11 @@ void AppWindow::buildUi() {
   m_stepsLabel = new QLabel("0");
   m_collisionsLabel = new QLabel("0");
   m_goalLabel = new QLabel("No");
+  m_timeLabel = new QLabel("0");
+  m_queueLabel = new QLabel("0");
+  m_queueLabel->setToolTip(
+      "Bot requests waiting behind a movement or a pause. Past a limit the "
+      "bot is throttled: it blocks on its output until the queue drains.");
   debugLayout->addWidget(new QLabel("Position"), 0, 0);
   debugLayout->addWidget(m_posLabel, 0, 1);
   debugLayout->addWidget(new QLabel("Heading"), 1, 0);
@@ -167,12 +217,32 @@ void AppWindow::buildUi() {
   debugLayout->addWidget(m_collisionsLabel, 3, 1);
   debugLayout->addWidget(new QLabel("Goal"), 4, 0);
   debugLayout->addWidget(m_goalLabel, 4, 1);
+  debugLayout->addWidget(new QLabel("Sim time"), 5, 0);
+  debugLayout->addWidget(m_timeLabel, 5, 1);
+  debugLayout->addWidget(new QLabel("Queue"), 6, 0);
+  debugLayout->addWidget(m_queueLabel, 6, 1);
+
+  QGroupBox *latencyBox = new QGroupBox("Command Latency");
+  QVBoxLayout *latencyLayout = new QVBoxLayout(latencyBox);
+  m_profileCommands = new QCheckBox("Profile bot commands");
+  m_profileCommands->setToolTip(
+      "Per command: how long the bot thought before sending it, how long "
+      "it waited to be dispatched and how long the simulator took to "
+      "answer (p50/p99)");
+  m_latencyView = new QPlainTextEdit();
+  m_latencyView->setReadOnly(true);
+  m_latencyView->setLineWrapMode(QPlainTextEdit::NoWrap);
+  m_latencyView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  m_latencyView->setVisible(false);
+  latencyLayout->addWidget(m_profileCommands);
+  latencyLayout->addWidget(m_latencyView);
 
   m_logView = new QPlainTextEdit();
   m_logView->setReadOnly(true);
   m_logView->setMinimumHeight(200);
 
   rightLayout->addWidget(debugBox);
+  rightLayout->addWidget(latencyBox);
   rightLayout->addWidget(new QLabel("Event Log"));
   rightLayout->addWidget(m_logView);
 
@@ -212,6 +282,10 @@ void AppWindow::connectSignals() {
   connect(m_resetButton, &QPushButton::clicked, this, &AppWindow::onReset);
   connect(m_speedSlider, &QSlider::valueChanged, this,
           &AppWindow::onSpeedChanged);
+  connect(m_timelineSlider, &QSlider::valueChanged, this,
+          &AppWindow::onTimelineSeek);
+  connect(m_kinematic, &QCheckBox::toggled, this,
+          &AppWindow::onKinematicToggled);
 
   connect(m_botStart, &QPushButton::clicked, this, &AppWindow::onStartBot);
   connect(m_botStop, &QPushButton::clicked, this, &AppWindow::onStopBot);
@@ -219,15 +293,27 @@ void AppWindow::connectSignals() {
           &AppWindow::onRefreshBots);
   connect(m_botSelector, QOverload<int>::of(&QComboBox::currentIndexChanged),
           this, &AppWindow::onBotSelectionChanged);
+  connect(m_addRacer, &QPushButton::clicked, this, &AppWindow::onAddRacer);
+  connect(m_focusSelector,
+          QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+          &AppWindow::onFocusChanged);
 
   connect(&m_sim, &Simulation::stateChanged, this,
           &AppWindow::onSimulationUpdated);
   connect(&m_sim, &Simulation::eventLogged, this, &AppWindow::onLogMessage);
   connect(&m_controller, &SimController::logMessage, this,
           &AppWindow::onLogMessage);
+  connect(&m_controller, &SimController::throttledChanged, this,
+          &AppWindow::updateDebugPanel);
   connect(&m_bot, &BotProcess::logReceived, this, &AppWindow::onBotLog);
   connect(&m_bot, &BotProcess::commandReceived, &m_controller,
-          &SimController::enqueueCommand);
+          &SimController::enqueueLine);
+  connect(&m_bot, &BotProcess::frameReceived, &m_controller,
+          &SimController::enqueueFrame);
+  m_plugin.attach(&m_sim, &m_controller);
+  connect(&m_plugin, &PluginBot::logReceived, this, &AppWindow::onBotLog);
+  connect(&m_plugin, &PluginBot::finished, this,
+          [this]() { writeLog("Plugin bot finished"); });
 
   connect(m_showVisited, &QCheckBox::toggled, m_mazeWidget,
           &MazeWidget::setShowVisited);
@@ -245,9 +331,11 @@ void AppWindow::connectSignals() {
   connect(m_mazeWidget, &MazeWidget::logMessage, this,
           &AppWindow::onLogMessage);
 
-  connect(&m_timer, &QTimer::timeout, this, [this]() {
-    m_sim.advanceOneTick();
-  });
+  connect(&m_timer, &QTimer::timeout, this, [this]() { tickSimulation(); });
+  connect(m_profileCommands, &QCheckBox::toggled, this,
+          &AppWindow::setProfiling);
+  connect(&m_profileTimer, &QTimer::timeout, this,
+          [this]() { m_latencyView->setPlainText(m_profiler.report()); });
 
   new QShortcut(QKeySequence(Qt::Key_Space), this, SLOT(onTogglePlayback()));
   new QShortcut(QKeySequence(Qt::Key_S), this, SLOT(onStep()));
@@ -292,6 +380,12 @@ void AppWindow::refreshBotList() {
     QString name = QFileInfo(file).baseName();
     m_botSelector->addItem(name, file);
   }
+  QStringList plugins = botsDir.entryList(QStringList() << "*.so",
+                                          QDir::Files, QDir::Name);
+  for (const QString &file : plugins) {
+    QString name = QFileInfo(file).baseName();
+    m_botSelector->addItem(QString("%1 (plugin)").arg(name), file);
+  }
   if (m_botSelector->count() == 0) {
     m_botSelector->addItem("none", QString());
   }
@@ -321,9 +415,10 @@ void AppWindow::setDefaultBot() {
 }
 
 bool AppWindow::startBot(bool quiet) {
-  if (m_bot.isRunning()) {
+  if (isBotRunning()) {
     return true;
   }
+  returnToLive();
   m_controller.resetState();
   QString cmd = m_botCommand->text().trimmed();
   QString dir = m_botDir->text().trimmed();
@@ -340,6 +435,21 @@ bool AppWindow::startBot(bool quiet) {
     writeLog(QString("Bot start failed: missing directory %1").arg(dir));
     return false;
   }
+  if (PluginBot::isPluginCommand(cmd)) {
+    QString error;
+    if (!m_plugin.load(QDir(dir).absoluteFilePath(cmd), &error)) {
+      if (!quiet) {
+        QMessageBox::warning(this, "Bot", error);
+      }
+      writeLog(QString("Plugin load failed: %1").arg(error));
+      return false;
+    }
+    m_controller.attachBot(nullptr);
+    writeLog("Plugin bot started");
+    beginTrace();
+    m_plugin.start();
+    return true;
+  }
   if (!m_bot.start(cmd, dir)) {
     if (!quiet) {
       QMessageBox::warning(this, "Bot", "Failed to start bot process");
@@ -348,9 +458,52 @@ bool AppWindow::startBot(bool quiet) {
   }
   m_controller.attachBot(&m_bot);
   writeLog("Bot started");
+  beginTrace();
   return true;
 }
 
+bool AppWindow::isBotRunning() const {
+  return m_bot.isRunning() || m_plugin.isRunning();
+}
+
+void AppWindow::stopBot() {
+  m_bot.stop();
+  m_plugin.stop();
+}
+
+void AppWindow::beginTrace() {
+  if (!m_recordTrace->isChecked()) {
+    return;
+  }
+  QDir dir(QDir(repoRoot()).filePath("traces"));
+  if (!dir.mkpath(".")) {
+    writeLog("Trace recording failed: cannot create traces directory");
+    return;
+  }
+  QString path = dir.filePath(
+      QString("session-%1.htrace")
+          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+  // Traces always start from a fresh run so replay can rebuild the state
+  // from the maze alone.
+  m_sim.reset();
+  restartTimeline();
+  QString error;
+  if (!m_trace.begin(path, m_sim, &error)) {
+    writeLog(QString("Trace recording failed: %1").arg(error));
+    return;
+  }
+  m_controller.setRecorder(&m_trace);
+  writeLog(QString("Recording trace: %1").arg(path));
+}
+
+void AppWindow::endTrace() {
+  if (!m_trace.isRecording()) {
+    return;
+  }
+  m_trace.end(m_sim);
+  writeLog(QString("Trace saved: %1").arg(m_trace.path()));
+}
+
 void AppWindow::maybeAutoStartBot() {
   if (startBot(true)) {
     writeLog("Auto-started bot");
@@ -363,11 +516,14 @@ void AppWindow::maybeAutoStartBot() {
 void AppWindow::loadInitialMaze() {
   std::unique_ptr<Maze> maze(MazeGenerator::generate(16, 16, 1));
   m_sim.setMaze(std::move(maze));
+  restartTimeline();
+  refreshFocusList();
   onSimulationUpdated();
 }
 
 void AppWindow::onPlay() {
-  m_controller.setPaused(false);
+  returnToLive();
+  setControllersPaused(false);
   m_timer.start();
   writeLog("Simulation running");
 }
@@ -381,25 +537,83 @@ void AppWindow::onTogglePlayback() {
 }
 
 void AppWindow::onPause() {
-  m_controller.setPaused(true);
+  setControllersPaused(true);
   m_timer.stop();
   writeLog("Simulation paused");
 }
 
 void AppWindow::onStep() {
-  m_controller.setPaused(false);
+  returnToLive();
+  setControllersPaused(false);
+  tickSimulation();
+  setControllersPaused(true);
+}
+
+void AppWindow::tickSimulation() {
+  bool moving = m_sim.isMoving();
   m_sim.advanceOneTick();
-  m_controller.setPaused(true);
+  if (moving) {
+    m_trace.recordTick(m_sim);
+  }
+  if (m_timeline.record(m_sim)) {
+    updateTimeline();
+  }
+}
+
+void AppWindow::restartTimeline() {
+  m_reviewing = false;
+  m_timeline.clear();
+  m_timeline.record(m_sim);
+  updateTimeline();
+}
+
+void AppWindow::returnToLive() {
+  if (!m_reviewing) {
+    return;
+  }
+  m_timeline.seek(m_timeline.lastFrame(), &m_sim);
+  m_reviewing = false;
+  updateTimeline();
+}
+
+void AppWindow::onTimelineSeek(int frame) {
+  if (m_timer.isActive()) {
+    onPause();
+  }
+  // Goal handling is skipped while reviewing, so set the flag before the
+  // restore emits stateChanged.
+  m_reviewing = true;
+  m_timeline.seek(frame, &m_sim);
+  m_reviewing = frame != m_timeline.lastFrame();
+  updateTimeline();
+}
+
+void AppWindow::updateTimeline() {
+  int last = m_timeline.lastFrame();
+  m_timelineSlider->blockSignals(true);
+  m_timelineSlider->setRange(m_timeline.firstFrame(), last);
+  if (!m_reviewing) {
+    m_timelineSlider->setValue(last);
+  }
+  m_timelineSlider->blockSignals(false);
+  m_timelineLabel->setText(
+      QString("Timeline: frame %1 / %2 (checkpoint every %3)")
+          .arg(m_timelineSlider->value())
+          .arg(last)
+          .arg(m_timeline.checkpointInterval()));
 }
 
 void AppWindow::onReset() {
+  endTrace();
+  clearRacers();
   bool wasPlaying = m_timer.isActive();
-  bool wasBotRunning = m_bot.isRunning();
+  bool wasBotRunning = isBotRunning();
   m_timer.stop();
-  m_controller.setPaused(true);
+  setControllersPaused(true);
   m_controller.resetState();
-  m_bot.stop();
+  stopBot();
   m_sim.reset();
+  restartTimeline();
   writeLog("Reset simulation");
   if (wasBotRunning) {
     startBot(true);
@@ -409,6 +623,11 @@ void AppWindow::onReset() {
   }
 }
 
+void AppWindow::onKinematicToggled(bool enabled) {
+  m_sim.setKinematicEnabled(enabled);
+  onReset();
+}
+
 void AppWindow::onLoadMaze() {
   QString path = QFileDialog::getOpenFileName(
       this, "Open Maze", QString(), "Maze files (*.map *.num)");
@@ -421,13 +640,16 @@ void AppWindow::onLoadMaze() {
     QMessageBox::warning(this, "Maze Load Failed", error);
     return;
   }
+  endTrace();
+  clearRacers();
   bool wasPlaying = m_timer.isActive();
-  bool wasBotRunning = m_bot.isRunning();
+  bool wasBotRunning = isBotRunning();
   m_timer.stop();
-  m_controller.setPaused(true);
+  setControllersPaused(true);
   m_controller.resetState();
-  m_bot.stop();
+  stopBot();
   m_sim.setMaze(std::move(maze));
+  restartTimeline();
   writeLog(QString("Loaded maze: %1").arg(path));
   if (wasBotRunning) {
     startBot(true);
@@ -471,13 +693,16 @@ void AppWindow::onGenerateMaze() {
     QMessageBox::warning(this, "Generate Failed", "Unable to generate maze");
     return;
   }
+  endTrace();
+  clearRacers();
   bool wasPlaying = m_timer.isActive();
-  bool wasBotRunning = m_bot.isRunning();
+  bool wasBotRunning = isBotRunning();
   m_timer.stop();
-  m_controller.setPaused(true);
+  setControllersPaused(true);
   m_controller.resetState();
-  m_bot.stop();
+  stopBot();
   m_sim.setMaze(std::move(maze));
+  restartTimeline();
   writeLog(QString("Generated maze %1x%2 (seed %3)")
                .arg(width)
                .arg(height)
@@ -493,7 +718,9 @@ void AppWindow::onGenerateMaze() {
 void AppWindow::onStartBot() { startBot(false); }
 
 void AppWindow::onStopBot() {
-  m_bot.stop();
+  endTrace();
+  clearRacers();
+  stopBot();
   m_controller.resetState();
   writeLog("Bot stopped");
 }
@@ -508,32 +735,197 @@ void AppWindow::setTimerFromSlider(int value) {
 }
 
 void AppWindow::onSimulationUpdated() {
-  bool goalReached = m_sim.goalReached();
-  if (goalReached && !m_goalReachedLast) {
-    QPair<int, int> cell = m_sim.mouse().position().toCell();
-    writeLog(QString("Success: goal reached at %1,%2").arg(cell.first).arg(cell.second));
-    m_timer.stop();
-    m_controller.setPaused(true);
-    if (m_bot.isRunning()) {
-      m_bot.stop();
+  if (m_reviewing) {
+    updateDebugPanel();
+    return;
+  }
+  m_goalReachedLast.resize(m_sim.agentCount());
+  bool arrived = false;
+  for (int agent = 0; agent < m_sim.agentCount(); ++agent) {
+    bool goalReached = m_sim.goalReached(agent);
+    if (goalReached && !m_goalReachedLast[agent]) {
+      QPair<int, int> cell = m_sim.position(agent).toCell();
+      if (m_sim.agentCount() > 1) {
+        writeLog(QString("Success: mouse %1 reached the goal at %2,%3 in %4 "
+                         "steps")
+                     .arg(agent + 1)
+                     .arg(cell.first)
+                     .arg(cell.second)
+                     .arg(m_sim.stepCount(agent)));
+      } else {
+        writeLog(QString("Success: goal reached at %1,%2").arg(cell.first).arg(cell.second));
+      }
+      arrived = true;
+    }
+    m_goalReachedLast[agent] = goalReached;
+  }
+  if (arrived) {
+    // Let the current tick finish (and reach the trace) before stopping.
+    QTimer::singleShot(0, this, [this]() { stopAtGoal(); });
+  }
+  updateDebugPanel();
+}
+
+void AppWindow::stopAtGoal() {
+  // Mice that made it drop out of the race; the clock only stops once
+  // every mouse is home.
+  if (m_sim.goalReached(0)) {
+    endTrace();
+    if (isBotRunning()) {
+      stopBot();
       m_controller.resetState();
     }
   }
-  m_goalReachedLast = goalReached;
+  for (int i = 0; i < m_racers.size(); ++i) {
+    if (m_sim.goalReached(i + 1) && m_racers[i].bot->isRunning()) {
+      m_racers[i].bot->stop();
+      m_racers[i].controller->resetState();
+    }
+  }
+  if (m_sim.allGoalsReached()) {
+    m_timer.stop();
+    setControllersPaused(true);
+  }
+}
+
+void AppWindow::setControllersPaused(bool paused) {
+  m_controller.setPaused(paused);
+  for (const Racer &racer : m_racers) {
+    racer.controller->setPaused(paused);
+  }
+}
+
+void AppWindow::onAddRacer() {
+  QString cmd = m_botCommand->text().trimmed();
+  QString dir = m_botDir->text().trimmed();
+  if (cmd.isEmpty() || dir.isEmpty() || !QDir(dir).exists()) {
+    QMessageBox::warning(this, "Bot",
+                         "Command and an existing directory are required");
+    return;
+  }
+  if (PluginBot::isPluginCommand(cmd)) {
+    QMessageBox::warning(this, "Bot", "Plugins can only drive the main mouse");
+    return;
+  }
+  returnToLive();
+
+  Racer racer;
+  racer.bot = new BotProcess(this);
+  racer.controller = new SimController(&m_sim, this);
+  racer.name = m_botSelector->currentText();
+  int agent = m_sim.addAgent();
+  racer.controller->setAgent(agent);
+  racer.controller->setPaused(!m_timer.isActive());
+  connect(racer.controller, &SimController::logMessage, this,
+          &AppWindow::onLogMessage);
+  connect(racer.bot, &BotProcess::logReceived, this,
+          [this, agent](const QString &message) {
+            writeLog(QString("[bot %1] %2").arg(agent + 1).arg(message));
+          });
+  connect(racer.bot, &BotProcess::commandReceived, racer.controller,
+          &SimController::enqueueLine);
+  connect(racer.bot, &BotProcess::frameReceived, racer.controller,
+          &SimController::enqueueFrame);
+  connect(racer.controller, &SimController::throttledChanged, this,
+          &AppWindow::updateDebugPanel);
+  if (!racer.bot->start(cmd, dir)) {
+    QMessageBox::warning(this, "Bot", "Failed to start bot process");
+    delete racer.controller;
+    delete racer.bot;
+    m_sim.setAgentCount(agent);
+    return;
+  }
+  racer.controller->attachBot(racer.bot);
+  m_racers.append(racer);
+  restartTimeline();
+  refreshFocusList();
+  writeLog(QString("Racer %1 started: %2").arg(agent + 1).arg(racer.name));
+}
+
+void AppWindow::clearRacers() {
+  if (m_racers.isEmpty()) {
+    return;
+  }
+  for (const Racer &racer : m_racers) {
+    racer.bot->disconnect();
+    racer.bot->stop();
+    racer.controller->attachBot(nullptr);
+    racer.controller->resetState();
+    racer.bot->deleteLater();
+    racer.controller->deleteLater();
+  }
+  m_racers.clear();
+  m_sim.setAgentCount(1);
+  m_goalReachedLast.resize(1);
+  restartTimeline();
+  refreshFocusList();
+  writeLog("Racers removed");
+}
+
+void AppWindow::refreshFocusList() {
+  int current = m_focusSelector->currentIndex();
+  m_focusSelector->blockSignals(true);
+  m_focusSelector->clear();
+  m_focusSelector->addItem("Mouse 1");
+  for (int i = 0; i < m_racers.size(); ++i) {
+    m_focusSelector->addItem(
+        QString("Mouse %1 (%2)").arg(i + 2).arg(m_racers[i].name));
+  }
+  if (current < 0 || current >= m_focusSelector->count()) {
+    current = 0;
+  }
+  m_focusSelector->setCurrentIndex(current);
+  m_focusSelector->setEnabled(m_focusSelector->count() > 1);
+  m_focusSelector->blockSignals(false);
+  onFocusChanged(current);
+}
+
+void AppWindow::onFocusChanged(int index) {
+  m_mazeWidget->setFocusAgent(qMax(0, index));
   updateDebugPanel();
 }
 
 void AppWindow::updateDebugPanel() {
-  SemiPosition pos = m_sim.mouse().position();
+  int agent = m_mazeWidget->focusAgent();
+  SemiPosition pos = m_sim.position(agent);
   m_posLabel->setText(QString("(%1,%2)").arg(pos.toCell().first).arg(
       pos.toCell().second));
-  m_headingLabel->setText(headingToString(m_sim.mouse().heading()));
-  m_stepsLabel->setText(QString::number(m_sim.stepCount()));
-  m_collisionsLabel->setText(QString::number(m_sim.collisionCount()));
-  m_goalLabel->setText(m_sim.goalReached() ? "Yes" : "No");
+  m_headingLabel->setText(headingToString(m_sim.heading(agent)));
+  m_stepsLabel->setText(QString::number(m_sim.stepCount(agent)));
+  m_collisionsLabel->setText(QString::number(m_sim.collisionCount(agent)));
+  m_goalLabel->setText(m_sim.goalReached(agent) ? "Yes" : "No");
+  if (m_sim.kinematicEnabled()) {
+    m_timeLabel->setText(
+        QString("%1 s").arg(m_sim.simTime(agent), 0, 'f', 2));
+  } else {
+    m_timeLabel->setText(
+        QString("%1 ticks").arg(static_cast<int>(m_sim.simTime(agent))));
+  }
+  const SimController *controller =
+      agent > 0 && agent <= m_racers.size() ? m_racers[agent - 1].controller
+                                            : &m_controller;
+  if (controller->isThrottled()) {
+    m_queueLabel->setText(
+        QString("%1 (throttled)").arg(controller->queueDepth()));
+  } else {
+    m_queueLabel->setText(QString::number(controller->queueDepth()));
+  }
   m_mazeWidget->update();
 }
 
+void AppWindow::setProfiling(bool enabled) {
+  // Only the main bot is profiled.
+  m_profiler.clear();
+  m_controller.setProfiler(enabled ? &m_profiler : nullptr);
+  m_latencyView->setVisible(enabled);
+  m_latencyView->setPlainText(m_profiler.report());
+  if (enabled) {
+    m_profileTimer.start(kProfileRefreshMs);
+  } else {
+    m_profileTimer.stop();
+  }
+}
+
 QString AppWindow::headingToString(SemiDirection dir) const {
   switch (dir) {
     case SemiDirection::North:
@@ -588,7 +980,11 @@ void AppWindow::onBotSelectionChanged(int index) {
   if (file.isEmpty()) {
     return;
   }
-  m_botCommand->setText(QString("python3 -u controller/bots/%1").arg(file));
+  if (file.endsWith(".so")) {
+    m_botCommand->setText(QString("controller/bots/%1").arg(file));
+  } else {
+    m_botCommand->setText(QString("python3 -u controller/bots/%1").arg(file));
+  }
   m_botDir->setText(repoRoot());
 }
 
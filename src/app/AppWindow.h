@@ -4,9 +4,14 @@
 #include <QPlainTextEdit>
 #include <QTimer>
 
+#include "controller/BotPool.h"
 #include "controller/BotProcess.h"
+#include "controller/LatencyProfiler.h"
+#include "controller/PluginBot.h"
+#include "controller/SessionTrace.h"
 #include "controller/SimController.h"
 #include "engine/Simulation.h"
+#include "engine/Timeline.h"
 #include "ui/MazeWidget.h"
 
 class QLabel;
@@ -24,6 +29,7 @@ class AppWindow : public QMainWindow {
 
  public:
   explicit AppWindow(QWidget *parent = nullptr);
+  ~AppWindow() override;
 
  private slots:
   void onPlay();
@@ -43,11 +49,33 @@ class AppWindow : public QMainWindow {
   void onEditActionChanged(int index);
   void onRefreshBots();
   void onBotSelectionChanged(int index);
+  void onTimelineSeek(int frame);
+  void onAddRacer();
+  void onFocusChanged(int index);
+  void onKinematicToggled(bool enabled);
 
  private:
+  // Extra mice racing in the same maze, one bot each. The main bot always
+  // drives mouse 0; racer i drives mouse i + 1.
+  struct Racer {
+    BotProcess *bot = nullptr;
+    SimController *controller = nullptr;
+    QString name;
+  };
+
   Simulation m_sim;
+  // Spare processes of the main bot, so a reset or a new maze does not
+  // wait for the bot to start.
+  BotPool m_botPool;
   BotProcess m_bot;
   SimController m_controller;
+  // Drives mouse 0 instead of m_bot when the command names a plugin.
+  PluginBot m_plugin;
+  QVector<Racer> m_racers;
+  TraceRecorder m_trace;
+  LatencyProfiler m_profiler;
+  QTimer m_profileTimer;
+  SimTimeline m_timeline;
   QTimer m_timer;
 
   MazeWidget *m_mazeWidget = nullptr;
@@ -58,6 +86,9 @@ class AppWindow : public QMainWindow {
   QPushButton *m_stepButton = nullptr;
   QPushButton *m_resetButton = nullptr;
   QSlider *m_speedSlider = nullptr;
+  QSlider *m_timelineSlider = nullptr;
+  QLabel *m_timelineLabel = nullptr;
+  QCheckBox *m_kinematic = nullptr;
 
   QComboBox *m_botSelector = nullptr;
   QPushButton *m_refreshBotsButton = nullptr;
@@ -65,6 +96,9 @@ class AppWindow : public QMainWindow {
   QLineEdit *m_botDir = nullptr;
   QPushButton *m_botStart = nullptr;
   QPushButton *m_botStop = nullptr;
+  QCheckBox *m_recordTrace = nullptr;
+  QPushButton *m_addRacer = nullptr;
+  QComboBox *m_focusSelector = nullptr;
 
   QSpinBox *m_mazeWidth = nullptr;
   QSpinBox *m_mazeHeight = nullptr;
@@ -82,23 +116,41 @@ class AppWindow : public QMainWindow {
   QLabel *m_stepsLabel = nullptr;
   QLabel *m_collisionsLabel = nullptr;
   QLabel *m_goalLabel = nullptr;
+  QLabel *m_timeLabel = nullptr;
+  QLabel *m_queueLabel = nullptr;
+  QCheckBox *m_profileCommands = nullptr;
+  QPlainTextEdit *m_latencyView = nullptr;
 
-  bool m_goalReachedLast = false;
+  QVector<bool> m_goalReachedLast;
+  bool m_reviewing = false;
 
   void buildUi();
   void connectSignals();
   void setTimerFromSlider(int value);
   void updateDebugPanel();
+  void setProfiling(bool enabled);
   QString headingToString(SemiDirection dir) const;
 
   void loadInitialMaze();
   void writeLog(const QString &message);
+  void tickSimulation();
+  void stopAtGoal();
+  void restartTimeline();
+  void setControllersPaused(bool paused);
+  void clearRacers();
+  void refreshFocusList();
+  void returnToLive();
+  void updateTimeline();
 
   QString repoRoot() const;
   void setDefaultBot();
   void maybeAutoStartBot();
   bool startBot(bool quiet);
+  bool isBotRunning() const;
+  void stopBot();
   void refreshBotList();
+  void beginTrace();
+  void endTrace();
 };
 
 }  // namespace hadak
@@ -0,0 +1,149 @@
+#include "controller/BinaryProtocol.h"
+
+#include <QtEndian>
+
+namespace hadak {
+
+namespace {
+
+QByteArray encodeFrame(quint16 opcode, quint16 second, qint32 a, qint32 b) {
+  QByteArray frame(kBinaryFrameSize, '\0');
+  char *data = frame.data();
+  qToLittleEndian<quint16>(opcode, data);
+  qToLittleEndian<quint16>(second, data + 2);
+  qToLittleEndian<qint32>(a, data + 4);
+  qToLittleEndian<qint32>(b, data + 8);
+  return frame;
+}
+
+}  // namespace
+
+bool binaryHasPayload(CommandId id) {
+  return id == CommandId::SetText || id == CommandId::SetColorGrid ||
+         id == CommandId::SetTextGrid || id == CommandId::RunPath;
+}
+
+int binaryRequestSize(const char *data, int size) {
+  if (size < kBinaryFrameSize) {
+    return 0;
+  }
+  CommandId id = static_cast<CommandId>(qFromLittleEndian<quint16>(data));
+  if (binaryHasPayload(id)) {
+    return kBinaryFrameSize + qFromLittleEndian<quint16>(data + 2);
+  }
+  return kBinaryFrameSize;
+}
+
+bool decodeBinaryRequest(const char *data, int size, Command *command) {
+  if (size < kBinaryFrameSize) {
+    return false;
+  }
+  quint16 opcode = qFromLittleEndian<quint16>(data);
+  quint16 aux = qFromLittleEndian<quint16>(data + 2);
+  if (binaryHasPayload(static_cast<CommandId>(opcode)) &&
+      size < kBinaryFrameSize + aux) {
+    return false;
+  }
+  return buildBinaryCommand(opcode, aux, qFromLittleEndian<qint32>(data + 4),
+                            qFromLittleEndian<qint32>(data + 8),
+                            data + kBinaryFrameSize, command);
+}
+
+bool buildBinaryCommand(quint16 opcode, quint16 aux, qint32 a, qint32 b,
+                        const char *text, Command *command) {
+  *command = Command();
+  command->args[0] = a;
+  command->args[1] = b;
+  command->id = static_cast<CommandId>(opcode);
+
+  switch (command->id) {
+    case CommandId::MazeWidth:
+    case CommandId::MazeHeight:
+    case CommandId::GoalCount:
+    case CommandId::IsGoal:
+    case CommandId::TurnRight:
+    case CommandId::TurnLeft:
+    case CommandId::TurnRight45:
+    case CommandId::TurnLeft45:
+    case CommandId::ClearAllColor:
+    case CommandId::ClearAllText:
+    case CommandId::WasReset:
+    case CommandId::AckReset:
+    case CommandId::NextMoveKnown:
+      return true;
+    case CommandId::WallFront:
+    case CommandId::WallRight:
+    case CommandId::WallLeft:
+    case CommandId::WallBack:
+    case CommandId::WallFrontRight:
+    case CommandId::WallFrontLeft:
+    case CommandId::WallBackRight:
+    case CommandId::WallBackLeft:
+    case CommandId::MoveForward:
+    case CommandId::MoveForwardHalf:
+    case CommandId::GoalCell:
+    case CommandId::Sense:
+    case CommandId::PushSense:
+      command->argCount = 1;
+      return true;
+    case CommandId::ClearColor:
+    case CommandId::ClearText:
+    case CommandId::FloodKnown:
+      command->argCount = 2;
+      return true;
+    case CommandId::SetWall:
+    case CommandId::ClearWall:
+    case CommandId::SetColor:
+      command->argCount = 2;
+      command->symbol = QChar(aux);
+      return aux != 0;
+    case CommandId::SetText:
+      command->argCount = 2;
+      command->text = text;
+      command->textSize = aux;
+      return true;
+    case CommandId::SetColorGrid:
+    case CommandId::SetTextGrid:
+    case CommandId::RunPath:
+      command->args[0] = 0;
+      command->args[1] = 0;
+      command->text = text;
+      command->textSize = aux;
+      return true;
+    case CommandId::SetColorRect:
+      command->argCount = 4;
+      command->args[0] = static_cast<qint16>(a & 0xffff);
+      command->args[1] = static_cast<qint16>(static_cast<quint32>(a) >> 16);
+      command->args[2] = static_cast<qint16>(b & 0xffff);
+      command->args[3] = static_cast<qint16>(static_cast<quint32>(b) >> 16);
+      command->symbol = QChar(aux);
+      return aux != 0;
+    case CommandId::GetStat:
+      if (aux >= kStatCount) {
+        return false;
+      }
+      command->stat = static_cast<StatId>(aux);
+      return true;
+    case CommandId::Unknown:
+      break;
+  }
+  return false;
+}
+
+QByteArray encodeBinaryRequest(CommandId id, quint16 aux, qint32 a,
+                               qint32 b) {
+  return encodeFrame(static_cast<quint16>(id), aux, a, b);
+}
+
+qint32 packBinaryCell(int x, int y) {
+  return static_cast<qint32>((static_cast<quint32>(y) << 16) |
+                             (static_cast<quint32>(x) & 0xffff));
+}
+
+QByteArray encodeBinaryResponse(CommandId id, BinaryStatus status,
+                                qint32 value, qint32 extra) {
+  return encodeFrame(static_cast<quint16>(id), static_cast<quint16>(status),
+                     value, extra);
+}
+
+}  // namespace hadak
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+
+#include "controller/CommandParser.h"
+
+namespace hadak {
+
+// Opt-in binary framing. A bot sends kBinaryHandshake as an ordinary text
+// line and waits for kBinaryHandshakeReply; after that both directions
+// carry fixed-size little-endian frames instead of lines.
+//
+// Request, 12 bytes: u16 opcode (a CommandId), u16 aux, i32 a, i32 b.
+//   a is the distance of sensor and move commands, the index of goalCell
+//   and x of cell commands; b is y. aux is the ASCII color or wall
+//   direction, the StatId of getStat, or the byte length of setText's
+//   UTF-8 text, a grid's payload or runPath's program, which follows the
+//   frame. setColorRect packs its corners as i16 pairs: a = x0 | y0 << 16,
+//   b = x1 | y1 << 16.
+// Response, 12 bytes: u16 opcode, u16 status, i32 value, i32 extra.
+//   Only commands that answer in the text protocol answer here. Booleans
+//   are 0/1, goalCell is value = x and extra = y, getStat is the float's
+//   bit pattern, and a move that hits a wall has status Crash. A runPath
+//   that crashes has status Crash and the step's index as value.
+//   nextMoveKnown is value = a Direction or -1 and extra = the distance.
+//   After pushSense 1, a movement's answer is value = the sense mask |
+//   SemiDirection << 12 | a crashed runPath step << 16 and extra = the
+//   cell packed as for setColorRect.
+const char kBinaryHandshake[] = "protocol binary 1";
+const char kBinaryHandshakeReply[] = "ok binary 1";
+const int kBinaryFrameSize = 12;
+
+enum class BinaryStatus : quint16 { Ok = 0, Crash = 1 };
+
+// Whether requests with this opcode are followed by aux bytes of payload.
+bool binaryHasPayload(CommandId id);
+// Bytes the request at the front of data occupies, or 0 while even its
+// header is incomplete.
+int binaryRequestSize(const char *data, int size);
+bool decodeBinaryRequest(const char *data, int size, Command *command);
+// The same decoding from fields already in hand; text holds aux bytes of
+// setText's text or a grid's payload. In-process plugins use it to skip the
+// frame entirely.
+bool buildBinaryCommand(quint16 opcode, quint16 aux, qint32 a, qint32 b,
+                        const char *text, Command *command);
+QByteArray encodeBinaryRequest(CommandId id, quint16 aux, qint32 a,
+                               qint32 b = 0);
+// setColorRect's corners as a and b.
+qint32 packBinaryCell(int x, int y);
+QByteArray encodeBinaryResponse(CommandId id, BinaryStatus status,
+                                qint32 value = 0, qint32 extra = 0);
+
+}  // namespace hadak
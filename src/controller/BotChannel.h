@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace hadak {
+
+// Where SimController sends its response lines. BotProcess is the normal
+// implementation; replay and tests plug in in-memory ones.
+class BotChannel {
+ public:
+  virtual ~BotChannel() = default;
+
+  virtual void sendLine(const QString &line) = 0;
+
+  // Binary protocol support. A channel that cannot carry frames returns
+  // false and the bot's handshake is refused, keeping it on text.
+  virtual bool setBinaryMode(bool enabled) { return !enabled; }
+  virtual void sendFrame(const QByteArray &frame) { Q_UNUSED(frame); }
+
+  // When the request being delivered was read from the bot, on
+  // LatencyProfiler's clock, or 0 if the channel does not know.
+  virtual qint64 receivedAt() const { return 0; }
+
+  // Flow control: while paused the channel delivers no more requests, and
+  // where it can it stops reading, so the bot blocks on a full pipe.
+  virtual void setReadPaused(bool paused) { Q_UNUSED(paused); }
+};
+
+}  // namespace hadak
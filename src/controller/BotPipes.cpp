@@ -0,0 +1,482 @@
+#include "controller/BotPipes.h"
+
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QThread>
+#include <cerrno>
+#include <cstring>
+
+#include "controller/BinaryProtocol.h"
+#include "controller/LatencyProfiler.h"
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace hadak {
+
+namespace {
+
+const int kIncomingCapacity = 4096;
+const int kReadChunk = 65536;
+// How often flush() delivers what has come in while it waits.
+const int kFlushSliceMs = 10;
+
+}  // namespace
+
+BotPipes::BotPipes(QObject *parent)
+    : QObject(parent), m_incoming(kIncomingCapacity) {}
+
+BotPipes::~BotPipes() { close(); }
+
+bool BotPipes::isOpen() const { return m_wakeFd >= 0; }
+
+void BotPipes::setBinaryMode(bool enabled) {
+  m_binary.store(enabled, std::memory_order_seq_cst);
+}
+
+qint64 BotPipes::readTime() const { return m_deliveringAt; }
+
+void BotPipes::setPaused(bool paused) {
+  if (m_paused == paused) {
+    return;
+  }
+  m_paused = paused;
+  m_stdoutPaused.store(paused, std::memory_order_seq_cst);
+  wake();
+  if (!m_paused) {
+    // Not in place: the caller may be inside one of our signals.
+    QMetaObject::invokeMethod(this, [this]() { drain(); },
+                              Qt::QueuedConnection);
+  }
+}
+
+void BotPipes::drain() {
+  m_notified.store(false, std::memory_order_seq_cst);
+  Message message;
+  // A handler may close the pipes, whatever is left is dropped, or pause
+  // them, and the rest waits in the queue.
+  while (isOpen() && !m_paused && m_incoming.tryPop(&message)) {
+    m_deliveringAt = message.readAt;
+    if (message.kind == Message::Frame) {
+      emit frameReceived(message.bytes);
+      continue;
+    }
+    QByteArrayView block(message.bytes);
+    QByteArrayView line;
+    while (isOpen() && LineBuffer::splitLine(&block, &line)) {
+      if (message.kind == Message::Lines) {
+        emit lineReceived(line);
+      } else {
+        emit logReceived(line);
+      }
+    }
+  }
+  // The I/O thread stopped reading when the queue filled up.
+  if (isOpen() && !m_paused &&
+      m_incomingFull.load(std::memory_order_seq_cst)) {
+    wake();
+  }
+}
+
+#ifdef Q_OS_LINUX
+
+namespace {
+
+void closeFd(int *fd) {
+  if (*fd >= 0) {
+    ::close(*fd);
+    *fd = -1;
+  }
+}
+
+void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void watchFd(int epoll, int op, int fd, quint32 events) {
+  epoll_event event = {};
+  event.events = events;
+  event.data.fd = fd;
+  epoll_ctl(epoll, op, fd, &event);
+}
+
+}  // namespace
+
+bool BotPipes::open(QString *error) {
+  close();
+  // A bot that exits with replies still queued must not take us down with
+  // SIGPIPE. QProcess does the same, but only once it starts a process.
+  struct sigaction action = {};
+  if (sigaction(SIGPIPE, nullptr, &action) == 0 &&
+      action.sa_handler == SIG_DFL) {
+    signal(SIGPIPE, SIG_IGN);
+  }
+  if (pipe2(m_stdin, O_CLOEXEC) != 0 || pipe2(m_stdout, O_CLOEXEC) != 0 ||
+      pipe2(m_stderr, O_CLOEXEC) != 0 ||
+      (m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    if (error) {
+      *error = QString("Unable to create bot pipes: %1").arg(strerror(errno));
+    }
+    close();
+    return false;
+  }
+  // Only our ends are non-blocking; the bot keeps ordinary blocking stdio.
+  setNonBlocking(m_stdin[1]);
+  setNonBlocking(m_stdout[0]);
+  setNonBlocking(m_stderr[0]);
+  return true;
+}
+
+void BotPipes::redirectInChild() const {
+  dup2(m_stdin[0], STDIN_FILENO);
+  dup2(m_stdout[1], STDOUT_FILENO);
+  dup2(m_stderr[1], STDERR_FILENO);
+}
+
+void BotPipes::start() {
+  closeFd(&m_stdin[0]);
+  closeFd(&m_stdout[1]);
+  closeFd(&m_stderr[1]);
+  m_stopping.store(false);
+  m_thread = QThread::create([this]() { run(); });
+  m_thread->start();
+}
+
+void BotPipes::close() {
+  if (m_thread) {
+    m_stopping.store(true);
+    wake();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+  }
+  for (int *fd : {&m_stdin[0], &m_stdin[1], &m_stdout[0], &m_stdout[1],
+                  &m_stderr[0], &m_stderr[1], &m_wakeFd}) {
+    closeFd(fd);
+  }
+  Message message;
+  while (m_incoming.tryPop(&message)) {
+  }
+  m_outgoing.clear();
+  m_queuedBytes.store(0);
+  m_overflow.clear();
+  m_incomingFull.store(false);
+  m_stdoutPaused.store(false);
+  m_binary.store(false);
+  m_notified.store(false);
+  m_paused = false;
+  m_stdoutClosed.tryAcquire(m_stdoutClosed.available());
+}
+
+void BotPipes::write(const QByteArray &bytes) {
+  if (m_stdin[1] < 0) {
+    return;
+  }
+  int offset = 0;
+  if (m_queuedBytes.load(std::memory_order_acquire) == 0) {
+    while (offset < bytes.size()) {
+      ssize_t written = ::write(m_stdin[1], bytes.constData() + offset,
+                                bytes.size() - offset);
+      if (written > 0) {
+        offset += static_cast<int>(written);
+      } else if (written < 0 && errno == EINTR) {
+        continue;
+      } else if (written < 0 && errno != EAGAIN) {
+        return;  // The bot closed its stdin.
+      } else {
+        break;
+      }
+    }
+    if (offset == bytes.size()) {
+      return;
+    }
+  }
+  {
+    QMutexLocker locker(&m_outgoingLock);
+    m_outgoing.append(bytes.constData() + offset, bytes.size() - offset);
+    m_queuedBytes.fetch_add(bytes.size() - offset, std::memory_order_acq_rel);
+  }
+  wake();
+}
+
+void BotPipes::flush(int timeoutMs) {
+  if (m_thread) {
+    // Delivering while waiting lets a bot that wrote more than the queue
+    // holds get it all out.
+    QElapsedTimer clock;
+    clock.start();
+    while (!m_stdoutClosed.tryAcquire(1, kFlushSliceMs) &&
+           !clock.hasExpired(timeoutMs)) {
+      drain();
+    }
+  }
+  drain();
+}
+
+void BotPipes::wake() {
+  quint64 one = 1;
+  if (m_wakeFd >= 0) {
+    ::write(m_wakeFd, &one, sizeof(one));
+  }
+}
+
+void BotPipes::run() {
+  int epoll = epoll_create1(EPOLL_CLOEXEC);
+  watchFd(epoll, EPOLL_CTL_ADD, m_wakeFd, EPOLLIN);
+  watchFd(epoll, EPOLL_CTL_ADD, m_stdout[0], EPOLLIN);
+  watchFd(epoll, EPOLL_CTL_ADD, m_stderr[0], EPOLLIN);
+
+  LineBuffer outLines;
+  LineBuffer errLines;
+  QByteArray frames;
+  QByteArray pending;
+  qint64 pendingBytes = 0;
+  bool watchingStdin = false;
+  bool stdoutOpen = true;
+  bool stderrOpen = true;
+  bool readingStdout = true;
+  bool readingStderr = true;
+  bool closedReported = false;
+
+  auto writePending = [&]() {
+    while (!pending.isEmpty()) {
+      ssize_t written = ::write(m_stdin[1], pending.constData(),
+                                pending.size());
+      if (written > 0) {
+        pending.remove(0, static_cast<int>(written));
+      } else if (written < 0 && errno == EINTR) {
+        continue;
+      } else if (written < 0 && errno == EAGAIN) {
+        break;
+      } else {
+        pending.clear();  // The bot closed its stdin.
+      }
+    }
+    if (pending.isEmpty() && pendingBytes > 0) {
+      m_queuedBytes.fetch_sub(pendingBytes, std::memory_order_release);
+      pendingBytes = 0;
+    }
+    bool full = !pending.isEmpty();
+    if (full != watchingStdin) {
+      watchFd(epoll, full ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, m_stdin[1],
+              EPOLLOUT);
+      watchingStdin = full;
+    }
+  };
+
+  // The bot's output is only read while the owner keeps up with it and,
+  // for stdout, wants more; otherwise the bot blocks on its full pipes.
+  auto watch = [&](int fd, bool open, bool wanted, bool *watching) {
+    if (open && wanted != *watching) {
+      watchFd(epoll, wanted ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, EPOLLIN);
+    }
+    *watching = wanted;
+  };
+  auto watchOutput = [&]() {
+    bool keepingUp = m_overflow.isEmpty();
+    watch(m_stdout[0], stdoutOpen,
+          keepingUp && !m_stdoutPaused.load(std::memory_order_seq_cst),
+          &readingStdout);
+    watch(m_stderr[0], stderrOpen, keepingUp, &readingStderr);
+    if (!stdoutOpen && m_overflow.isEmpty() && !closedReported) {
+      m_stdoutClosed.release();
+      closedReported = true;
+    }
+  };
+
+  epoll_event events[4];
+  while (!m_stopping.load()) {
+    int count = epoll_wait(epoll, events, 4, -1);
+    if (count < 0 && errno != EINTR) {
+      break;
+    }
+    for (int i = 0; i < count; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == m_wakeFd) {
+        quint64 value = 0;
+        ::read(m_wakeFd, &value, sizeof(value));
+        {
+          QMutexLocker locker(&m_outgoingLock);
+          pendingBytes += m_outgoing.size();
+          pending.append(m_outgoing);
+          m_outgoing.clear();
+        }
+        writePending();
+        if (!m_overflow.isEmpty() && pushOverflow()) {
+          notify();
+        }
+      } else if (fd == m_stdin[1]) {
+        writePending();
+      } else if (!m_overflow.isEmpty() ||
+                 (fd == m_stdout[0] && m_stdoutPaused.load())) {
+        continue;  // Unwatched below; this read waits for the owner.
+      } else if (fd == m_stdout[0]) {
+        if (!readOutput(&outLines, &frames)) {
+          watchFd(epoll, EPOLL_CTL_DEL, fd, 0);
+          stdoutOpen = false;
+        }
+      } else if (!readLog(&errLines)) {
+        watchFd(epoll, EPOLL_CTL_DEL, fd, 0);
+        stderrOpen = false;
+      }
+    }
+    watchOutput();
+  }
+  ::close(epoll);
+}
+
+bool BotPipes::readOutput(LineBuffer *lines, QByteArray *frames) {
+  char chunk[kReadChunk];
+  ssize_t size = ::read(m_stdout[0], chunk, sizeof(chunk));
+  if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return true;
+  }
+  if (size > 0) {
+    qint64 readAt = LatencyProfiler::now();
+    // The mode only changes between reads: the bot waits for the
+    // handshake reply, which is sent after setBinaryMode().
+    if (m_binary.load(std::memory_order_seq_cst)) {
+      if (!lines->isEmpty()) {
+        frames->append(lines->takeAll());
+      }
+      frames->append(chunk, static_cast<int>(size));
+      pushFrames(frames, readAt);
+    } else {
+      lines->append(chunk, static_cast<int>(size));
+      Message message;
+      message.kind = Message::Lines;
+      message.bytes = lines->takeLines();
+      message.readAt = readAt;
+      if (!message.bytes.isEmpty()) {
+        push(message);
+      }
+    }
+  }
+  notify();
+  return size > 0;
+}
+
+bool BotPipes::readLog(LineBuffer *lines) {
+  char chunk[kReadChunk];
+  ssize_t size = ::read(m_stderr[0], chunk, sizeof(chunk));
+  if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return true;
+  }
+  if (size > 0) {
+    lines->append(chunk, static_cast<int>(size));
+  } else if (!lines->isEmpty()) {
+    // A last line without a newline still reaches the log.
+    lines->append("\n", 1);
+  }
+  Message message;
+  message.kind = Message::Log;
+  message.bytes = lines->takeLines();
+  if (!message.bytes.isEmpty()) {
+    push(message);
+  }
+  notify();
+  return size > 0;
+}
+
+void BotPipes::pushFrames(QByteArray *frames, qint64 readAt) {
+  int offset = 0;
+  while (!m_stopping.load()) {
+    int size = binaryRequestSize(frames->constData() + offset,
+                                 frames->size() - offset);
+    if (size == 0 || frames->size() - offset < size) {
+      break;
+    }
+    Message message;
+    message.kind = Message::Frame;
+    message.bytes = frames->mid(offset, size);
+    message.readAt = readAt;
+    offset += size;
+    push(message);
+  }
+  frames->remove(0, offset);
+}
+
+void BotPipes::push(Message &message) {
+  // The owner is behind by a whole queue: hold on to the message and stop
+  // reading until it catches up.
+  if (!m_overflow.isEmpty() || !m_incoming.tryPush(message)) {
+    m_overflow.append(std::move(message));
+    m_incomingFull.store(true, std::memory_order_seq_cst);
+  }
+}
+
+bool BotPipes::pushOverflow() {
+  while (!m_overflow.isEmpty() && m_incoming.tryPush(m_overflow.first())) {
+    m_overflow.removeFirst();
+  }
+  if (!m_overflow.isEmpty()) {
+    return false;
+  }
+  m_incomingFull.store(false, std::memory_order_seq_cst);
+  return true;
+}
+
+void BotPipes::notify() {
+  // A paused owner delivers nothing; resuming drains the queue anyway.
+  if (m_stdoutPaused.load(std::memory_order_seq_cst)) {
+    return;
+  }
+  if (!m_notified.exchange(true, std::memory_order_seq_cst)) {
+    QMetaObject::invokeMethod(this, [this]() { drain(); },
+                              Qt::QueuedConnection);
+  }
+}
+
+#else
+
+bool BotPipes::open(QString *error) {
+  if (error) {
+    *error = "Threaded bot pipes need Linux";
+  }
+  return false;
+}
+
+void BotPipes::redirectInChild() const {}
+
+void BotPipes::start() {}
+
+void BotPipes::close() {}
+
+void BotPipes::write(const QByteArray &bytes) { Q_UNUSED(bytes); }
+
+void BotPipes::flush(int timeoutMs) { Q_UNUSED(timeoutMs); }
+
+void BotPipes::wake() {}
+
+void BotPipes::run() {}
+
+bool BotPipes::readOutput(LineBuffer *lines, QByteArray *frames) {
+  Q_UNUSED(lines);
+  Q_UNUSED(frames);
+  return false;
+}
+
+bool BotPipes::readLog(LineBuffer *lines) {
+  Q_UNUSED(lines);
+  return false;
+}
+
+void BotPipes::pushFrames(QByteArray *frames, qint64 readAt) {
+  Q_UNUSED(frames);
+  Q_UNUSED(readAt);
+}
+
+void BotPipes::push(Message &message) { Q_UNUSED(message); }
+
+bool BotPipes::pushOverflow() { return true; }
+
+void BotPipes::notify() {}
+
+#endif
+
+}  // namespace hadak
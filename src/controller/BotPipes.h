@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+#include <atomic>
+
+#include "controller/LineBuffer.h"
+#include "controller/SpscQueue.h"
+
+class QThread;
+
+namespace hadak {
+
+// The pipes to a bot process's stdin, stdout and stderr, serviced by an
+// epoll thread of their own. Output is cut at line (or binary frame)
+// boundaries on that thread and handed to the owner's thread through a
+// lock-free queue, so a busy GUI thread never leaves the bot blocked on a
+// full pipe. Each read crosses over as one block of whole lines, which the
+// owner's thread walks with views. Neither thread ever waits on the other:
+// when that queue is full the I/O thread stops reading until the owner
+// catches up, and writes the pipe has no room for are kept without bound.
+// Linux only; open() fails elsewhere and BotProcess keeps QProcess's own
+// pipes.
+class BotPipes : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit BotPipes(QObject *parent = nullptr);
+  ~BotPipes() override;
+
+  bool open(QString *error);
+  // For QProcess's child process modifier: puts the pipes on the child's
+  // stdin, stdout and stderr. Only async-signal-safe calls.
+  void redirectInChild() const;
+  // Starts the I/O thread once the child is running.
+  void start();
+  void close();
+  bool isOpen() const;
+
+  // How stdout is framed from the next message on.
+  void setBinaryMode(bool enabled);
+  // Writes straight to the pipe when it has room and nothing is queued
+  // ahead; the I/O thread finishes whatever does not fit. Never blocks.
+  void write(const QByteArray &bytes);
+  // Waits up to timeoutMs for the bot's stdout to close, then delivers
+  // everything read so far. For use once the process has exited.
+  void flush(int timeoutMs);
+  // When the message being delivered was read, on LatencyProfiler's
+  // clock. Only meaningful during the signals.
+  qint64 readTime() const;
+  // While paused nothing more is delivered (the block being walked is
+  // finished) and the I/O thread stops reading stdout, so the bot blocks
+  // on it once the pipe is full.
+  void setPaused(bool paused);
+
+ signals:
+  // Lines are views into the block being delivered, valid only during
+  // the signal.
+  void lineReceived(QByteArrayView line);
+  void frameReceived(const QByteArray &frame);
+  void logReceived(QByteArrayView line);
+
+ private:
+  struct Message {
+    enum Kind { Lines, Frame, Log };
+    Kind kind = Lines;
+    QByteArray bytes;
+    qint64 readAt = 0;
+  };
+
+  int m_stdin[2] = {-1, -1};
+  int m_stdout[2] = {-1, -1};
+  int m_stderr[2] = {-1, -1};
+  int m_wakeFd = -1;
+  QThread *m_thread = nullptr;
+  SpscQueue<Message> m_incoming;
+  // What the pipe had no room for, waiting for the I/O thread.
+  QMutex m_outgoingLock;
+  QByteArray m_outgoing;
+  // Bytes handed to the I/O thread and not yet written.
+  std::atomic<qint64> m_queuedBytes{0};
+  // I/O thread only: messages m_incoming had no room for. Nothing more is
+  // read until they are through.
+  QList<Message> m_overflow;
+  // Set while m_overflow is waiting; the owner wakes the I/O thread once
+  // it has made room.
+  std::atomic<bool> m_incomingFull{false};
+  // m_paused, for the I/O thread.
+  std::atomic<bool> m_stdoutPaused{false};
+  std::atomic<bool> m_binary{false};
+  std::atomic<bool> m_stopping{false};
+  std::atomic<bool> m_notified{false};
+  QSemaphore m_stdoutClosed;
+  qint64 m_deliveringAt = 0;
+  bool m_paused = false;
+
+  // I/O thread.
+  void run();
+  bool readOutput(LineBuffer *lines, QByteArray *frames);
+  bool readLog(LineBuffer *lines);
+  void pushFrames(QByteArray *frames, qint64 readAt);
+  void push(Message &message);
+  bool pushOverflow();
+  void notify();
+
+  void wake();
+  void drain();
+};
+
+}  // namespace hadak
@@ -0,0 +1,227 @@
+#include "controller/BotPool.h"
+
+#include <QProcess>
+#include <QStringList>
+#include <QTimer>
+
+#include "controller/BotPipes.h"
+#include "controller/SharedMemoryChannel.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace hadak {
+
+bool BotLimits::operator==(const BotLimits &other) const {
+  return cpuSeconds == other.cpuSeconds && memoryBytes == other.memoryBytes &&
+         responseTimeoutMs == other.responseTimeoutMs;
+}
+
+bool BotLaunch::operator==(const BotLaunch &other) const {
+  return command == other.command && workingDir == other.workingDir &&
+         sharedMemory == other.sharedMemory && limits == other.limits;
+}
+
+BotPool::BotPool(QObject *parent) : QObject(parent) {}
+
+// Idle processes are children of the pool; QProcess kills them as they go.
+BotPool::~BotPool() = default;
+
+void BotPool::setSize(int size) {
+  m_size = qMax(0, size);
+  while (m_idle.size() > m_size) {
+    BotSpawn spawn = m_idle.takeLast();
+    retire(&spawn);
+  }
+}
+
+int BotPool::size() const { return m_size; }
+
+int BotPool::idleCount() const { return m_idle.size(); }
+
+bool BotPool::take(const BotLaunch &launch, BotSpawn *spawn,
+                   QString *error) {
+  if (!(launch == m_launch)) {
+    clearIdle();
+    m_launch = launch;
+  }
+  if (!adoptIdle(spawn) && !BotPool::spawn(launch, spawn, error)) {
+    return false;
+  }
+  // Refill once the caller is back in the event loop, so starting the
+  // spares does not hold up this run.
+  if (m_size > 0 && !m_refillPending) {
+    m_refillPending = true;
+    QTimer::singleShot(0, this, [this]() {
+      m_refillPending = false;
+      refill();
+    });
+  }
+  return true;
+}
+
+bool BotPool::spawn(const BotLaunch &launch, BotSpawn *spawn,
+                    QString *error) {
+  if (!start(launch, spawn, error)) {
+    return false;
+  }
+  if (!spawn->process->waitForStarted()) {
+    if (error) {
+      *error = spawn->process->errorString();
+    }
+    retire(spawn);
+    return false;
+  }
+  return true;
+}
+
+void BotPool::retire(BotSpawn *spawn) {
+  if (QProcess *process = spawn->process) {
+    process->disconnect();
+    process->setParent(nullptr);
+    if (process->state() == QProcess::NotRunning) {
+      process->deleteLater();
+    } else {
+      connect(process,
+              qOverload<int, QProcess::ExitStatus>(&QProcess::finished),
+              process, &QObject::deleteLater);
+      connect(process, &QProcess::errorOccurred, process,
+              &QObject::deleteLater);
+      process->kill();
+    }
+  }
+  // Either may be retired from inside one of its own signals.
+  if (spawn->pipes) {
+    spawn->pipes->close();
+    spawn->pipes->deleteLater();
+  }
+  if (spawn->shm) {
+    spawn->shm->close();
+    spawn->shm->deleteLater();
+  }
+  *spawn = BotSpawn();
+}
+
+void BotPool::refill() {
+  while (m_idle.size() < m_size) {
+    BotSpawn spawn;
+    if (!start(m_launch, &spawn, nullptr)) {
+      return;
+    }
+    spawn.process->setParent(this);
+    if (spawn.pipes) {
+      spawn.pipes->setParent(this);
+    }
+    if (spawn.shm) {
+      SharedMemoryChannel *shm = spawn.shm;
+      shm->setParent(this);
+      connect(shm, &SharedMemoryChannel::received, this,
+              [this, shm](const QByteArray &bytes) {
+                for (BotSpawn &idle : m_idle) {
+                  if (idle.shm == shm) {
+                    idle.early.append(bytes);
+                  }
+                }
+              });
+    }
+    m_idle.append(spawn);
+  }
+}
+
+void BotPool::clearIdle() {
+  for (BotSpawn &spawn : m_idle) {
+    retire(&spawn);
+  }
+  m_idle.clear();
+}
+
+bool BotPool::adoptIdle(BotSpawn *spawn) {
+  while (!m_idle.isEmpty()) {
+    BotSpawn idle = m_idle.takeFirst();
+    if (idle.shm) {
+      disconnect(idle.shm, nullptr, this, nullptr);
+    }
+    if (idle.process->state() == QProcess::Starting) {
+      idle.process->waitForStarted();
+    }
+    if (idle.process->state() == QProcess::Running) {
+      *spawn = idle;
+      return true;
+    }
+    // It died while it waited.
+    retire(&idle);
+  }
+  return false;
+}
+
+bool BotPool::start(const BotLaunch &launch, BotSpawn *spawn,
+                    QString *error) {
+  QStringList args = QProcess::splitCommand(launch.command);
+  if (args.isEmpty()) {
+    if (error) {
+      *error = "Empty bot command";
+    }
+    return false;
+  }
+  QString program = args.takeFirst();
+
+  QProcess *process = new QProcess();
+  process->setWorkingDirectory(launch.workingDir);
+  BotPipes *pipes = new BotPipes();
+  if (pipes->open(nullptr)) {
+    process->setStandardInputFile(QProcess::nullDevice());
+    process->setStandardOutputFile(QProcess::nullDevice());
+    process->setStandardErrorFile(QProcess::nullDevice());
+  } else {
+    delete pipes;
+    pipes = nullptr;
+  }
+
+  SharedMemoryChannel *shm = nullptr;
+  int eventFd = -1;
+  if (launch.sharedMemory) {
+    shm = new SharedMemoryChannel();
+    QString shmError;
+    if (shm->create(&shmError)) {
+      QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+      env.insert(kSharedMemoryEnv, shm->name());
+      process->setProcessEnvironment(env);
+      eventFd = shm->eventFd();
+    } else {
+      spawn->shmError = shmError;
+      delete shm;
+      shm = nullptr;
+    }
+  }
+#ifdef Q_OS_UNIX
+  BotLimits limits = launch.limits;
+  process->setChildProcessModifier([pipes, eventFd, limits]() {
+    if (pipes) {
+      pipes->redirectInChild();
+    }
+    if (eventFd >= 0) {
+      SharedMemoryChannel::inheritInChild(eventFd);
+    }
+    if (limits.cpuSeconds > 0) {
+      // SIGXCPU at the limit, SIGKILL a second later if it is ignored.
+      rlimit cpu = {static_cast<rlim_t>(limits.cpuSeconds),
+                    static_cast<rlim_t>(limits.cpuSeconds + 1)};
+      setrlimit(RLIMIT_CPU, &cpu);
+    }
+    if (limits.memoryBytes > 0) {
+      rlimit memory = {static_cast<rlim_t>(limits.memoryBytes),
+                       static_cast<rlim_t>(limits.memoryBytes)};
+      setrlimit(RLIMIT_AS, &memory);
+    }
+  });
+#endif
+
+  process->start(program, args);
+  spawn->process = process;
+  spawn->pipes = pipes;
+  spawn->shm = shm;
+  return true;
+}
+
+}  // namespace hadak
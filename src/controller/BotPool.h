@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QtGlobal>
+
+class QProcess;
+
+namespace hadak {
+
+class BotPipes;
+class SharedMemoryChannel;
+
+// Limits for unattended runs, applied with setrlimit in the child. 0 leaves
+// a limit off.
+struct BotLimits {
+  // CPU seconds (RLIMIT_CPU); the bot gets SIGXCPU when they run out.
+  int cpuSeconds = 0;
+  // Address space (RLIMIT_AS); allocations beyond it fail.
+  qint64 memoryBytes = 0;
+  // How long the bot may stay silent after being answered; BotProcess
+  // enforces this one itself.
+  int responseTimeoutMs = 0;
+
+  bool operator==(const BotLimits &other) const;
+};
+
+// How to start a bot process.
+struct BotLaunch {
+  QString command;
+  QString workingDir;
+  bool sharedMemory = false;
+  BotLimits limits;
+
+  bool operator==(const BotLaunch &other) const;
+};
+
+// One bot process and what BotProcess talks to it through.
+struct BotSpawn {
+  QProcess *process = nullptr;
+  BotPipes *pipes = nullptr;
+  SharedMemoryChannel *shm = nullptr;
+  // Why shared memory was asked for but not offered, if it was not.
+  QString shmError;
+  // What the bot wrote to shared memory while it sat in a pool.
+  QByteArray early;
+};
+
+// Keeps bot processes started ahead of time for the command last asked
+// for, so a run starts without waiting for the bot's interpreter. An idle
+// bot has been told nothing yet: it is blocked on its first command, whose
+// answer it only gets once a run adopts it. Processes are ended with
+// retire(), which does not wait for them to exit.
+class BotPool : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit BotPool(QObject *parent = nullptr);
+  ~BotPool() override;
+
+  // How many idle processes to keep; 0 (the default) keeps none.
+  void setSize(int size);
+  int size() const;
+  int idleCount() const;
+
+  // Hands out a started process for launch, from the pool when one is
+  // ready, and starts refilling the pool behind it.
+  bool take(const BotLaunch &launch, BotSpawn *spawn, QString *error);
+
+  // Starts a process and waits until it is running, without a pool.
+  static bool spawn(const BotLaunch &launch, BotSpawn *spawn,
+                    QString *error);
+  // Kills the process and lets it be reaped from the event loop. The
+  // pieces are released and *spawn is cleared.
+  static void retire(BotSpawn *spawn);
+
+ private:
+  int m_size = 0;
+  BotLaunch m_launch;
+  QList<BotSpawn> m_idle;
+  bool m_refillPending = false;
+
+  void refill();
+  void clearIdle();
+  bool adoptIdle(BotSpawn *spawn);
+
+  static bool start(const BotLaunch &launch, BotSpawn *spawn,
+                    QString *error);
+};
+
+}  // namespace hadak
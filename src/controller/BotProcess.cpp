@@ -1,84 +1,531 @@
 #include "controller/BotProcess.h"
 
+#include <QFile>
 #include <QProcess>
+#include <QTimer>
+#include <csignal>
+#include <cstring>
+
+#include "controller/BinaryProtocol.h"
+#include "controller/BotPipes.h"
+#include "controller/BotPool.h"
+#include "controller/LatencyProfiler.h"
+#include "controller/SharedMemoryChannel.h"
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
 
 namespace hadak {
 
-BotProcess::BotProcess(QObject *parent) : QObject(parent) {}
+const char kBotSocketPrefix[] = "unix:";
+const char kNewRunLine[] = "newRun";
+const char kReadyLine[] = "ready";
+
+namespace {
+
+// How long a bot server may take to accept a run and reset for it.
+const int kHandshakeTimeoutMs = 10000;
+// How long an exited bot's last output may take to come off its pipe.
+const int kExitFlushMs = 100;
+// How often a limited bot's CPU time and memory are sampled, so a death
+// from a limit can be told from any other.
+const int kUsageSampleMs = 200;
+const qint64 kMegabyte = 1024 * 1024;
+// What a paused bot server's socket may buffer before it leaves the rest
+// to the kernel, and the bot blocks.
+const qint64 kPausedSocketBuffer = 65536;
+
+// What bot runtimes write to stderr when an allocation fails: Python's
+// MemoryError, C++'s std::bad_alloc and the C library's ENOMEM text.
+bool reportsAllocationFailure(QByteArrayView line) {
+  QByteArray text = line.toByteArray().toLower();
+  return text.contains("memoryerror") || text.contains("bad_alloc") ||
+         text.contains("out of memory") || text.contains("cannot allocate");
+}
+
+#ifdef Q_OS_LINUX
+// CPU seconds and address space of a running process, from /proc.
+bool readUsage(qint64 pid, double *cpuSeconds, qint64 *memoryBytes) {
+  QFile stat(QString("/proc/%1/stat").arg(pid));
+  QFile statm(QString("/proc/%1/statm").arg(pid));
+  if (!stat.open(QFile::ReadOnly) || !statm.open(QFile::ReadOnly)) {
+    return false;
+  }
+  // The command name may hold spaces; fields are counted after it.
+  QByteArray line = stat.readAll();
+  QList<QByteArray> fields =
+      line.mid(line.lastIndexOf(')') + 2).split(' ');
+  QList<QByteArray> pages = statm.readAll().split(' ');
+  if (fields.size() < 13 || pages.isEmpty()) {
+    return false;
+  }
+  // utime and stime are fields 14 and 15 of the whole line.
+  *cpuSeconds = (fields.at(11).toLongLong() + fields.at(12).toLongLong()) /
+                static_cast<double>(sysconf(_SC_CLK_TCK));
+  *memoryBytes = pages.at(0).toLongLong() * sysconf(_SC_PAGESIZE);
+  return true;
+}
+#endif
+
+}  // namespace
+
+BotProcess::BotProcess(QObject *parent) : QObject(parent) {
+  m_responseTimer.setSingleShot(true);
+  connect(&m_responseTimer, &QTimer::timeout, this, [this]() {
+    reportLimit("no-response",
+                QString("Sent nothing for %1 ms after being answered")
+                    .arg(m_limits.responseTimeoutMs));
+    if (m_process) {
+      m_process->kill();
+    }
+  });
+  connect(&m_usageTimer, &QTimer::timeout, this, &BotProcess::sampleUsage);
+  m_handshakeTimer.setSingleShot(true);
+  connect(&m_handshakeTimer, &QTimer::timeout, this, [this]() {
+    failHandshake(QString("No ready within %1 ms").arg(kHandshakeTimeoutMs));
+  });
+}
 
 bool BotProcess::start(const QString &command, const QString &workingDir) {
   stop();
+  QString target = command.trimmed();
+  if (target.startsWith(kBotSocketPrefix)) {
+    return connectToServer(target.mid(sizeof(kBotSocketPrefix) - 1));
+  }
 
-  m_process = new QProcess(this);
-  m_process->setWorkingDirectory(workingDir);
-  QStringList args = QProcess::splitCommand(command);
-  if (args.isEmpty()) {
-    delete m_process;
-    m_process = nullptr;
+  BotLaunch launch;
+  launch.command = target;
+  launch.workingDir = workingDir;
+  launch.sharedMemory = m_useSharedMemory;
+  launch.limits = m_limits;
+  BotSpawn spawn;
+  QString error;
+  bool started = m_pool ? m_pool->take(launch, &spawn, &error)
+                        : BotPool::spawn(launch, &spawn, &error);
+  if (!started) {
+    emit logReceived(QString("Bot start failed: %1").arg(error));
     return false;
   }
-  QString program = args.takeFirst();
+  adopt(spawn);
+  return true;
+}
+
+void BotProcess::adopt(const BotSpawn &spawn) {
+  m_process = spawn.process;
+  m_pipes = spawn.pipes;
+  m_shm = spawn.shm;
+  m_process->setParent(this);
+  if (m_pipes) {
+    m_pipes->setParent(this);
+    connect(m_pipes, &BotPipes::lineReceived, this,
+            [this](QByteArrayView line) {
+              noteReceived(m_pipes->readTime());
+              emit commandReceived(line);
+            });
+    connect(m_pipes, &BotPipes::frameReceived, this,
+            [this](const QByteArray &frame) {
+              noteReceived(m_pipes->readTime());
+              emit frameReceived(frame);
+            });
+    connect(m_pipes, &BotPipes::logReceived, this,
+            [this](QByteArrayView line) { noteLog(line); });
+  } else {
+    connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
+      if (!m_readPaused) {
+        readOutput(m_process->readAllStandardOutput());
+      }
+    });
+    connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
+      consumeLines(m_process->readAllStandardError(), &m_stderrLines, true);
+    });
+  }
+  connect(m_process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished),
+          this, [this](int exitCode, QProcess::ExitStatus status) {
+            if (m_pipes) {
+              m_pipes->flush(kExitFlushMs);
+            }
+            checkExit(exitCode, status);
+            emit finished();
+          });
+  if (m_shm) {
+    m_shm->setParent(this);
+    // Answers follow the bot onto the rings the first time it uses them.
+    connect(m_shm, &SharedMemoryChannel::received, this,
+            [this](const QByteArray &bytes) {
+              m_shmActive = true;
+              readOutput(bytes);
+            });
+  }
+  if (!spawn.shmError.isEmpty()) {
+    emit logReceived(
+        QString("Shared memory unavailable: %1").arg(spawn.shmError));
+  }
+  if (m_pipes) {
+    m_pipes->start();
+  }
+  m_limitHit = false;
+  m_cpuSeconds = 0.0;
+  m_peakMemory = 0;
+  m_allocationFailed = false;
+  m_exitReason.clear();
+  if (m_limits.responseTimeoutMs > 0) {
+    // The first request is owed from the start.
+    m_responseTimer.start(m_limits.responseTimeoutMs);
+  }
+  if (m_limits.cpuSeconds > 0 || m_limits.memoryBytes > 0) {
+    m_usageTimer.start(kUsageSampleMs);
+  }
 
-  connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
-    QString output = m_process->readAllStandardOutput();
-    QStringList lines = consumeLines(output, &m_stdoutBuffer);
-    for (const QString &line : lines) {
-      emit commandReceived(line);
+  // A bot from a pool may have spoken before anyone listened. Like any
+  // other output, that is delivered from the event loop.
+  QProcess *process = m_process;
+  QByteArray early = spawn.early;
+  QTimer::singleShot(0, this, [this, process, early]() {
+    if (m_process != process) {
+      return;
+    }
+    if (!early.isEmpty()) {
+      m_shmActive = true;
+      readOutput(early);
+    }
+    if (!m_pipes && m_process && m_process->bytesAvailable() > 0) {
+      readOutput(m_process->readAllStandardOutput());
     }
   });
+}
+
+bool BotProcess::connectToServer(const QString &path) {
+  stop();
+  m_exitReason.clear();
+  m_serverPath = path;
+  m_socket = new QLocalSocket(this);
+  m_handshaking = true;
+  connect(m_socket, &QLocalSocket::connected, this,
+          [this]() { m_socket->write(QByteArray(kNewRunLine) + "\n"); });
+  m_socket->connectToServer(path);
+  // A missing or refusing server fails at once; everything after that,
+  // down to the "ready", arrives from the event loop.
+  if (m_socket->state() == QLocalSocket::UnconnectedState) {
+    emit logReceived(
+        QString("Bot server %1: %2").arg(path).arg(m_socket->errorString()));
+    stop();
+    return false;
+  }
 
-  connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
-    QString output = m_process->readAllStandardError();
-    QStringList lines = consumeLines(output, &m_stderrBuffer);
-    for (const QString &line : lines) {
-      emit logReceived(line);
+  connect(m_socket, &QLocalSocket::readyRead, this, [this]() {
+    if (m_handshaking) {
+      readHandshake();
+    } else if (!m_readPaused) {
+      readOutput(m_socket->readAll());
     }
   });
+  connect(m_socket, &QLocalSocket::errorOccurred, this, [this]() {
+    if (m_handshaking) {
+      failHandshake(m_socket->errorString());
+    }
+  });
+  connect(m_socket, &QLocalSocket::disconnected, this, [this]() {
+    if (m_handshaking) {
+      failHandshake("Closed the connection before answering ready");
+      return;
+    }
+    emit finished();
+  });
+  m_handshakeTimer.start(kHandshakeTimeoutMs);
+  return true;
+}
 
-  connect(m_process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished),
-          this, [this](int, QProcess::ExitStatus) { emit finished(); });
+void BotProcess::readHandshake() {
+  if (!m_socket->canReadLine()) {
+    return;
+  }
+  if (m_socket->readLine().trimmed() != kReadyLine) {
+    failHandshake("Answered newRun with something other than ready");
+    return;
+  }
+  m_handshaking = false;
+  m_handshakeTimer.stop();
+  if (!m_held.isEmpty()) {
+    m_socket->write(m_held);
+    m_held.clear();
+  }
+  // The bot may have started talking right behind "ready".
+  if (!m_readPaused && m_socket->bytesAvailable() > 0) {
+    readOutput(m_socket->readAll());
+  }
+}
 
-  m_process->start(program, args);
-  return m_process->waitForStarted();
+void BotProcess::failHandshake(const QString &reason) {
+  m_exitReason = QString("Bot server %1: %2").arg(m_serverPath).arg(reason);
+  emit logReceived(m_exitReason);
+  stop();
+  emit finished();
 }
 
 void BotProcess::stop() {
+  if (m_socket) {
+    // Closing the connection is what tells the server the run is over.
+    m_socket->disconnect(this);
+    m_socket->abort();
+    m_socket->deleteLater();
+    m_socket = nullptr;
+    m_handshaking = false;
+    m_handshakeTimer.stop();
+    m_held.clear();
+    m_stdoutLines.clear();
+    m_binary = false;
+    m_frameBuffer.clear();
+    m_readPaused = false;
+    return;
+  }
   if (!m_process) {
     return;
   }
-  m_process->kill();
-  m_process->waitForFinished();
-  m_process->deleteLater();
+  m_responseTimer.stop();
+  m_usageTimer.stop();
+  // The process is reaped in the background, so a reset does not wait on
+  // it. stop() may run inside one of the pipes' or channel's own signals.
+  BotSpawn spawn;
+  spawn.process = m_process;
+  spawn.pipes = m_pipes;
+  spawn.shm = m_shm;
+  BotPool::retire(&spawn);
   m_process = nullptr;
-  m_stdoutBuffer.clear();
-  m_stderrBuffer.clear();
+  m_pipes = nullptr;
+  m_shm = nullptr;
+  m_shmActive = false;
+  m_stdoutLines.clear();
+  m_stderrLines.clear();
+  m_binary = false;
+  m_frameBuffer.clear();
+  m_readPaused = false;
 }
 
 bool BotProcess::isRunning() const {
+  if (m_socket) {
+    return m_socket->state() != QLocalSocket::UnconnectedState;
+  }
   return m_process && m_process->state() != QProcess::NotRunning;
 }
 
+void BotProcess::setSharedMemory(bool enabled) { m_useSharedMemory = enabled; }
+
+void BotProcess::setPool(BotPool *pool) { m_pool = pool; }
+
+void BotProcess::setLimits(const BotLimits &limits) { m_limits = limits; }
+
 void BotProcess::sendLine(const QString &line) {
-  if (!m_process) {
+  if (!m_process && !m_socket) {
     return;
   }
   QString msg = line + "\n";
-  m_process->write(msg.toUtf8());
+  transmit(msg.toUtf8());
 }
 
-QStringList BotProcess::consumeLines(QString text, QStringList *buffer) {
-  text.replace("\r", "");
-  QStringList parts = text.split("\n");
-  QStringList lines;
-  if (parts.size() > 1) {
-    lines.append(buffer->join("") + parts.at(0));
-    buffer->clear();
+bool BotProcess::setBinaryMode(bool enabled) {
+  m_binary = enabled;
+  m_frameBuffer.clear();
+  if (m_pipes) {
+    m_pipes->setBinaryMode(enabled);
+    return true;
   }
-  for (int i = 1; i < parts.size() - 1; ++i) {
-    lines.append(parts.at(i));
+  // The bot waits for the handshake reply, so nothing it sent after the
+  // handshake line can be sitting in the text buffer yet.
+  if (m_binary && m_socket && m_socket->bytesAvailable() > 0) {
+    readFrames(m_socket->readAll());
+  } else if (m_binary && m_process && m_process->bytesAvailable() > 0) {
+    readFrames(m_process->readAllStandardOutput());
+  }
+  return true;
+}
+
+void BotProcess::sendFrame(const QByteArray &frame) {
+  if (!m_process && !m_socket) {
+    return;
+  }
+  transmit(frame);
+}
+
+void BotProcess::transmit(const QByteArray &bytes) {
+  if (m_limits.responseTimeoutMs > 0 && m_process) {
+    m_responseTimer.start(m_limits.responseTimeoutMs);
+  }
+  if (m_shmActive) {
+    m_shm->write(bytes);
+  } else if (m_socket && m_handshaking) {
+    // Nothing goes to the server ahead of its "ready".
+    m_held.append(bytes);
+  } else if (m_socket) {
+    m_socket->write(bytes);
+  } else if (m_pipes) {
+    m_pipes->write(bytes);
+  } else {
+    m_process->write(bytes);
+  }
+}
+
+qint64 BotProcess::receivedAt() const { return m_receivedAt; }
+
+void BotProcess::setReadPaused(bool paused) {
+  if (m_readPaused == paused) {
+    return;
+  }
+  m_readPaused = paused;
+  // Each transport stops taking in output, so a paused bot blocks on its
+  // own writes instead of piling up here.
+  if (m_pipes) {
+    m_pipes->setPaused(paused);
+  }
+  if (m_shm) {
+    m_shm->setPaused(paused);
+  }
+  if (m_socket) {
+    m_socket->setReadBufferSize(paused ? kPausedSocketBuffer : 0);
+  }
+  if (m_readPaused) {
+    return;
+  }
+  // What was read before the pause waits in the line or frame buffer, the
+  // rest in the socket or QProcess; it goes out from the event loop like
+  // fresh output.
+  QTimer::singleShot(0, this, [this]() {
+    if (m_readPaused) {
+      return;
+    }
+    if (m_binary) {
+      readFrames(QByteArray());
+    } else {
+      consumeLines(QByteArray(), &m_stdoutLines, false);
+    }
+    QIODevice *device = m_socket ? static_cast<QIODevice *>(m_socket)
+                                 : (m_pipes ? nullptr : m_process);
+    if (!m_readPaused && device && device->bytesAvailable() > 0) {
+      readOutput(device->readAll());
+    }
+  });
+}
+
+void BotProcess::noteReceived(qint64 at) {
+  m_receivedAt = at;
+  if (m_limits.responseTimeoutMs > 0) {
+    m_responseTimer.stop();
+  }
+}
+
+void BotProcess::sampleUsage() {
+#ifdef Q_OS_LINUX
+  double cpuSeconds = 0.0;
+  qint64 memoryBytes = 0;
+  if (m_process && readUsage(m_process->processId(), &cpuSeconds,
+                             &memoryBytes)) {
+    m_cpuSeconds = cpuSeconds;
+    m_peakMemory = qMax(m_peakMemory, memoryBytes);
+  }
+#endif
+}
+
+void BotProcess::checkExit(int exitCode, QProcess::ExitStatus status) {
+  bool crashed = status == QProcess::CrashExit;
+  if (m_limitHit || (!crashed && exitCode == 0)) {
+    return;
+  }
+#ifdef Q_OS_UNIX
+  // For a crash, QProcess on Unix reports the signal as the exit code.
+  if (m_limits.cpuSeconds > 0 && crashed &&
+      (exitCode == SIGXCPU ||
+       (exitCode == SIGKILL && m_cpuSeconds >= m_limits.cpuSeconds - 1))) {
+    reportLimit("cpu-limit", QString("Used up its %1 s of CPU time")
+                                 .arg(m_limits.cpuSeconds));
+    return;
+  }
+  // A failed allocation ends a bot however its runtime handles it, so any
+  // bad exit close to the limit counts. One that fails straight away is
+  // never sampled there, but its runtime usually says so on stderr.
+  bool nearLimit = m_peakMemory >= m_limits.memoryBytes / 10 * 9;
+  if (m_limits.memoryBytes > 0 && (nearLimit || m_allocationFailed)) {
+    qint64 limitMb = m_limits.memoryBytes / kMegabyte;
+    reportLimit("memory-limit",
+                nearLimit ? QString("Died at %1 MB of its %2 MB address space")
+                                .arg(m_peakMemory / kMegabyte)
+                                .arg(limitMb)
+                          : QString("An allocation failed within its %1 MB "
+                                    "address space")
+                                .arg(limitMb));
+    return;
+  }
+  m_exitReason = crashed ? QString("Killed by signal %1 (%2)")
+                               .arg(exitCode)
+                               .arg(QString::fromLocal8Bit(strsignal(exitCode)))
+                         : QString("Exited with code %1").arg(exitCode);
+#else
+  m_exitReason = crashed ? QString("Crashed")
+                         : QString("Exited with code %1").arg(exitCode);
+#endif
+  emit logReceived(QString("Bot stopped: %1").arg(m_exitReason));
+}
+
+QString BotProcess::exitReason() const { return m_exitReason; }
+
+void BotProcess::reportLimit(const QString &status, const QString &reason) {
+  m_limitHit = true;
+  m_responseTimer.stop();
+  m_usageTimer.stop();
+  emit logReceived(QString("Bot stopped: %1").arg(reason));
+  emit limitExceeded(status, reason);
+}
+
+void BotProcess::readOutput(const QByteArray &output) {
+  noteReceived(LatencyProfiler::now());
+  if (m_binary) {
+    readFrames(output);
+    return;
+  }
+  consumeLines(output, &m_stdoutLines, false);
+}
+
+void BotProcess::readFrames(const QByteArray &output) {
+  m_frameBuffer.append(output);
+  int offset = 0;
+  while (!m_readPaused) {
+    int size = binaryRequestSize(m_frameBuffer.constData() + offset,
+                                 m_frameBuffer.size() - offset);
+    if (size == 0 || m_frameBuffer.size() - offset < size) {
+      break;
+    }
+    emit frameReceived(m_frameBuffer.mid(offset, size));
+    offset += size;
+  }
+  m_frameBuffer.remove(0, offset);
+}
+
+void BotProcess::noteLog(QByteArrayView line) {
+  if (m_limits.memoryBytes > 0 && reportsAllocationFailure(line)) {
+    m_allocationFailed = true;
+  }
+  // Only the log needs text; commands stay bytes all the way in.
+  emit logReceived(QString::fromUtf8(line));
+}
+
+void BotProcess::consumeLines(const QByteArray &output, LineBuffer *lines,
+                              bool log) {
+  lines->append(output);
+  QByteArrayView line;
+  while ((log || !m_readPaused) && lines->nextLine(&line)) {
+    if (log) {
+      noteLog(line);
+      continue;
+    }
+    emit commandReceived(line);
+    if (m_binary) {
+      // The line was the handshake: anything behind it is frames.
+      QByteArray rest = lines->takeAll();
+      if (!rest.isEmpty()) {
+        readFrames(rest);
+      }
+      return;
+    }
   }
-  buffer->append(parts.last());
-  return lines;
 }
 
 }  // namespace hadak
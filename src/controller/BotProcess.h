@@ -1,34 +1,114 @@
 #pragma once
 
+#include <QByteArrayView>
+#include <QLocalSocket>
 #include <QObject>
 #include <QProcess>
 #include <QStringList>
+#include <QTimer>
+
+#include "controller/BotChannel.h"
+#include "controller/BotPool.h"
+#include "controller/LineBuffer.h"
 
 namespace hadak {
 
-class BotProcess : public QObject {
+class BotPipes;
+class SharedMemoryChannel;
+
+// A command of the form unix:<path> connects to a bot server that is
+// already running instead of spawning a process. Each connection is one
+// run: we send "newRun", the server resets and answers "ready", and
+// closing the socket ends the run. The handshake does not block: requests
+// wait for the "ready", and a server that never gives one is logged and
+// ends the run with finished().
+extern const char kBotSocketPrefix[];
+extern const char kNewRunLine[];
+extern const char kReadyLine[];
+
+class BotProcess : public QObject, public BotChannel {
   Q_OBJECT
 
  public:
   explicit BotProcess(QObject *parent = nullptr);
 
   bool start(const QString &command, const QString &workingDir);
+  bool connectToServer(const QString &path);
   void stop();
   bool isRunning() const;
+  // Offer the shared-memory transport to bots started from now on. A bot
+  // that never writes to it keeps talking over its pipes.
+  void setSharedMemory(bool enabled);
+  // Take processes from pool, which must outlive this bot, instead of
+  // starting one per run.
+  void setPool(BotPool *pool);
+  // Limits for processes started from now on. A bot that breaks one is
+  // killed and limitExceeded() is emitted ahead of finished().
+  void setLimits(const BotLimits &limits);
+  // Why the last process ended badly: its exit code or the signal that
+  // killed it. Empty after a clean exit or a broken limit.
+  QString exitReason() const;
 
-  void sendLine(const QString &line);
+  void sendLine(const QString &line) override;
+  bool setBinaryMode(bool enabled) override;
+  void sendFrame(const QByteArray &frame) override;
+  qint64 receivedAt() const override;
+  void setReadPaused(bool paused) override;
 
  signals:
-  void commandReceived(const QString &command);
+  // One line from the bot, still as UTF-8 bytes. The view is only valid
+  // during the signal.
+  void commandReceived(QByteArrayView command);
+  void frameReceived(const QByteArray &frame);
   void logReceived(const QString &line);
+  // status is "cpu-limit", "memory-limit" or "no-response".
+  void limitExceeded(const QString &status, const QString &reason);
   void finished();
 
  private:
   QProcess *m_process = nullptr;
-  QStringList m_stdoutBuffer;
-  QStringList m_stderrBuffer;
+  // The process's stdio, when an I/O thread services it (see BotPipes).
+  BotPipes *m_pipes = nullptr;
+  QLocalSocket *m_socket = nullptr;
+  LineBuffer m_stdoutLines;
+  LineBuffer m_stderrLines;
+  bool m_binary = false;
+  QByteArray m_frameBuffer;
+  bool m_useSharedMemory = false;
+  SharedMemoryChannel *m_shm = nullptr;
+  bool m_shmActive = false;
+  BotPool *m_pool = nullptr;
+  qint64 m_receivedAt = 0;
+  BotLimits m_limits;
+  QTimer m_responseTimer;
+  QTimer m_usageTimer;
+  double m_cpuSeconds = 0.0;
+  qint64 m_peakMemory = 0;
+  // The bot said on stderr that an allocation failed.
+  bool m_allocationFailed = false;
+  QString m_exitReason;
+  bool m_limitHit = false;
+  bool m_readPaused = false;
+  QString m_serverPath;
+  QTimer m_handshakeTimer;
+  // Between connecting and the server's "ready", with what we would have
+  // sent meanwhile.
+  bool m_handshaking = false;
+  QByteArray m_held;
+
+  void adopt(const BotSpawn &spawn);
+  void noteReceived(qint64 at);
+  void sampleUsage();
+  void checkExit(int exitCode, QProcess::ExitStatus status);
+  void reportLimit(const QString &status, const QString &reason);
+  void noteLog(QByteArrayView line);
+  void readOutput(const QByteArray &output);
+  void readFrames(const QByteArray &output);
+  void transmit(const QByteArray &bytes);
+  void readHandshake();
+  void failHandshake(const QString &reason);
 
-  QStringList consumeLines(QString text, QStringList *buffer);
+  void consumeLines(const QByteArray &output, LineBuffer *lines, bool log);
 };
 
 }  // namespace hadak
@@ -0,0 +1,535 @@
+#include "controller/CommandParser.h"
+
+#include <array>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+namespace hadak {
+
+namespace {
+
+template <typename Id>
+struct NameEntry {
+  std::string_view name;
+  Id id;
+};
+
+constexpr quint32 hashName(std::string_view name, quint32 seed) {
+  quint32 hash = seed;
+  for (char c : name) {
+    hash ^= static_cast<quint8>(c);
+    hash *= 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
+
+// Open-addressed table with no probing: the seed is searched at compile
+// time until every name lands in its own slot, so a lookup is one hash,
+// one index and one comparison.
+template <typename Id, std::size_t Slots>
+struct PerfectHash {
+  static_assert((Slots & (Slots - 1)) == 0, "slot count must be a power of 2");
+
+  std::array<NameEntry<Id>, Slots> entries{};
+  quint32 seed = 0;
+
+  constexpr Id find(std::string_view name, Id missing) const {
+    const NameEntry<Id> &entry = entries[hashName(name, seed) & (Slots - 1)];
+    return entry.name == name && !name.empty() ? entry.id : missing;
+  }
+};
+
+template <std::size_t Slots, typename Id, std::size_t N>
+constexpr bool isPerfect(const std::array<NameEntry<Id>, N> &names,
+                         quint32 seed) {
+  bool used[Slots] = {};
+  for (const NameEntry<Id> &entry : names) {
+    quint32 slot = hashName(entry.name, seed) & (Slots - 1);
+    if (used[slot]) {
+      return false;
+    }
+    used[slot] = true;
+  }
+  return true;
+}
+
+template <std::size_t Slots, typename Id, std::size_t N>
+constexpr PerfectHash<Id, Slots> makePerfectHash(
+    const std::array<NameEntry<Id>, N> &names) {
+  PerfectHash<Id, Slots> table;
+  for (quint32 seed = 1; seed < 100000; ++seed) {
+    if (isPerfect<Slots>(names, seed)) {
+      table.seed = seed;
+      break;
+    }
+  }
+  for (const NameEntry<Id> &entry : names) {
+    table.entries[hashName(entry.name, table.seed) & (Slots - 1)] = entry;
+  }
+  return table;
+}
+
+constexpr std::array<NameEntry<CommandId>, 40> kCommandNames = {{
+    {"mazeWidth", CommandId::MazeWidth},
+    {"mazeHeight", CommandId::MazeHeight},
+    {"goalCount", CommandId::GoalCount},
+    {"goalCell", CommandId::GoalCell},
+    {"isGoal", CommandId::IsGoal},
+    {"wallFront", CommandId::WallFront},
+    {"wallRight", CommandId::WallRight},
+    {"wallLeft", CommandId::WallLeft},
+    {"wallBack", CommandId::WallBack},
+    {"wallFrontRight", CommandId::WallFrontRight},
+    {"wallFrontLeft", CommandId::WallFrontLeft},
+    {"wallBackRight", CommandId::WallBackRight},
+    {"wallBackLeft", CommandId::WallBackLeft},
+    {"moveForward", CommandId::MoveForward},
+    {"moveForwardHalf", CommandId::MoveForwardHalf},
+    {"turnRight", CommandId::TurnRight},
+    {"turnRight90", CommandId::TurnRight},
+    {"turnLeft", CommandId::TurnLeft},
+    {"turnLeft90", CommandId::TurnLeft},
+    {"turnRight45", CommandId::TurnRight45},
+    {"turnLeft45", CommandId::TurnLeft45},
+    {"setWall", CommandId::SetWall},
+    {"clearWall", CommandId::ClearWall},
+    {"setColor", CommandId::SetColor},
+    {"clearColor", CommandId::ClearColor},
+    {"clearAllColor", CommandId::ClearAllColor},
+    {"setText", CommandId::SetText},
+    {"clearText", CommandId::ClearText},
+    {"clearAllText", CommandId::ClearAllText},
+    {"wasReset", CommandId::WasReset},
+    {"ackReset", CommandId::AckReset},
+    {"getStat", CommandId::GetStat},
+    {"sense", CommandId::Sense},
+    {"setColorGrid", CommandId::SetColorGrid},
+    {"setTextGrid", CommandId::SetTextGrid},
+    {"setColorRect", CommandId::SetColorRect},
+    {"runPath", CommandId::RunPath},
+    {"floodKnown", CommandId::FloodKnown},
+    {"nextMoveKnown", CommandId::NextMoveKnown},
+    {"pushSense", CommandId::PushSense},
+}};
+
+constexpr std::array<NameEntry<StatId>, kStatCount> kStatNames = {{
+    {"total-distance", StatId::TotalDistance},
+    {"total-turns", StatId::TotalTurns},
+    {"best-run-distance", StatId::BestRunDistance},
+    {"best-run-turns", StatId::BestRunTurns},
+    {"current-run-distance", StatId::CurrentRunDistance},
+    {"current-run-turns", StatId::CurrentRunTurns},
+    {"total-effective-distance", StatId::TotalEffectiveDistance},
+    {"best-run-effective-distance", StatId::BestRunEffectiveDistance},
+    {"current-run-effective-distance", StatId::CurrentRunEffectiveDistance},
+    {"total-time", StatId::TotalTime},
+    {"best-run-time", StatId::BestRunTime},
+    {"current-run-time", StatId::CurrentRunTime},
+    {"score", StatId::Score},
+}};
+
+constexpr PerfectHash<CommandId, 128> kCommandTable =
+    makePerfectHash<128>(kCommandNames);
+constexpr PerfectHash<StatId, 32> kStatTable = makePerfectHash<32>(kStatNames);
+
+static_assert(kCommandTable.seed != 0, "no perfect seed for command names");
+static_assert(kStatTable.seed != 0, "no perfect seed for stat names");
+static_assert(kCommandTable.find("wallFront", CommandId::Unknown) ==
+                  CommandId::WallFront,
+              "command table lookup is broken");
+
+std::string_view view(const CommandToken &token) {
+  return std::string_view(token.data, static_cast<std::size_t>(token.size));
+}
+
+// Bytes in the UTF-8 sequence lead starts, or 0 if it cannot start one.
+int utf8Length(char lead) {
+  uchar byte = static_cast<uchar>(lead);
+  if ((byte & 0xe0) == 0xc0) {
+    return 2;
+  }
+  if ((byte & 0xf0) == 0xe0) {
+    return 3;
+  }
+  if ((byte & 0xf8) == 0xf0) {
+    return 4;
+  }
+  return 0;
+}
+
+}  // namespace
+
+CommandToken CommandLine::rest(int index) const {
+  CommandToken token = tokens[index];
+  token.size = static_cast<int>(end - token.data);
+  return token;
+}
+
+bool parseCommandLine(const char *data, int size, CommandLine *line) {
+  line->count = 0;
+  line->end = data + size;
+  int i = 0;
+  while (i < size) {
+    while (i < size && data[i] == ' ') {
+      ++i;
+    }
+    if (i == size) {
+      break;
+    }
+    int start = i;
+    while (i < size && data[i] != ' ') {
+      ++i;
+    }
+    if (line->count < kMaxCommandTokens) {
+      line->tokens[line->count] = {data + start, i - start};
+    }
+    line->count += 1;
+  }
+  if (line->count == 0) {
+    line->id = CommandId::Unknown;
+    return false;
+  }
+  line->id = commandFromName(line->tokens[0]);
+  return line->id != CommandId::Unknown;
+}
+
+bool buildCommand(const CommandLine &line, Command *command) {
+  *command = Command();
+  command->id = line.id;
+  int args = line.argCount();
+  auto parseCell = [&]() {
+    command->argCount = 2;
+    return parseCommandInt(line.arg(0), &command->args[0]) &&
+           parseCommandInt(line.arg(1), &command->args[1]);
+  };
+
+  switch (line.id) {
+    case CommandId::MazeWidth:
+    case CommandId::MazeHeight:
+    case CommandId::GoalCount:
+    case CommandId::IsGoal:
+    case CommandId::TurnRight:
+    case CommandId::TurnLeft:
+    case CommandId::TurnRight45:
+    case CommandId::TurnLeft45:
+    case CommandId::ClearAllColor:
+    case CommandId::ClearAllText:
+    case CommandId::WasReset:
+    case CommandId::AckReset:
+      // A stray argument has always been tolerated here.
+      return args <= 1;
+    case CommandId::WallFront:
+    case CommandId::WallRight:
+    case CommandId::WallLeft:
+    case CommandId::WallBack:
+    case CommandId::WallFrontRight:
+    case CommandId::WallFrontLeft:
+    case CommandId::WallBackRight:
+    case CommandId::WallBackLeft:
+    case CommandId::MoveForward:
+    case CommandId::MoveForwardHalf:
+    case CommandId::Sense:
+      if (args > 1) {
+        return false;
+      }
+      // A malformed distance reads as 0 rather than rejecting the command.
+      if (args == 1) {
+        command->argCount = 1;
+        parseCommandInt(line.arg(0), &command->args[0]);
+      }
+      return true;
+    case CommandId::GoalCell:
+    case CommandId::PushSense:
+      command->argCount = 1;
+      return args == 1 && parseCommandInt(line.arg(0), &command->args[0]);
+    case CommandId::GetStat:
+      return args == 1 && statFromName(line.arg(0), &command->stat);
+    case CommandId::NextMoveKnown:
+      return args == 0;
+    case CommandId::ClearColor:
+    case CommandId::ClearText:
+    case CommandId::FloodKnown:
+      return args == 2 && parseCell();
+    case CommandId::SetWall:
+    case CommandId::ClearWall:
+      if (args != 3 || !parseCell() || line.arg(2).size != 1) {
+        return false;
+      }
+      command->symbol = QChar(line.arg(2).data[0]);
+      return true;
+    case CommandId::SetColor:
+    case CommandId::SetColorRect: {
+      int colorArg = line.id == CommandId::SetColorRect ? 4 : 2;
+      if (args != colorArg + 1 || !parseCell()) {
+        return false;
+      }
+      if (line.id == CommandId::SetColorRect) {
+        command->argCount = 4;
+        if (!parseCommandInt(line.arg(2), &command->args[2]) ||
+            !parseCommandInt(line.arg(3), &command->args[3])) {
+          return false;
+        }
+      }
+      const CommandToken &color = line.arg(colorArg);
+      if (color.size == 1) {
+        command->symbol = QChar(color.data[0]);
+        return true;
+      }
+      // A non-ASCII color is still one character, just several bytes.
+      QString decoded = QString::fromUtf8(color.data, color.size);
+      if (decoded.size() != 1) {
+        return false;
+      }
+      command->symbol = decoded.at(0);
+      return true;
+    }
+    case CommandId::SetText: {
+      if (args < 3 || !parseCell()) {
+        return false;
+      }
+      CommandToken text = line.rest(3);
+      command->text = text.data;
+      command->textSize = text.size;
+      return true;
+    }
+    case CommandId::SetColorGrid:
+    case CommandId::SetTextGrid:
+    case CommandId::RunPath: {
+      // Checked against the maze when it runs.
+      if (args < 1) {
+        return false;
+      }
+      CommandToken payload = line.rest(1);
+      command->text = payload.data;
+      command->textSize = payload.size;
+      return true;
+    }
+    case CommandId::Unknown:
+      break;
+  }
+  return false;
+}
+
+QString commandName(CommandId id) {
+  for (const NameEntry<CommandId> &entry : kCommandNames) {
+    if (entry.id == id) {
+      return QString::fromLatin1(entry.name.data(),
+                                 static_cast<int>(entry.name.size()));
+    }
+  }
+  return QString();
+}
+
+QString commandText(const Command &command) {
+  QString text = commandName(command.id);
+  for (int i = 0; i < command.argCount; ++i) {
+    text += ' ' + QString::number(command.args[i]);
+  }
+  if (!command.symbol.isNull()) {
+    text += ' ';
+    text += command.symbol;
+  }
+  if (command.id == CommandId::GetStat) {
+    for (const NameEntry<StatId> &entry : kStatNames) {
+      if (entry.id == command.stat) {
+        text += ' ' + QString::fromLatin1(entry.name.data(),
+                                          static_cast<int>(entry.name.size()));
+      }
+    }
+  }
+  if (command.id == CommandId::SetText ||
+      command.id == CommandId::SetColorGrid ||
+      command.id == CommandId::SetTextGrid ||
+      command.id == CommandId::RunPath) {
+    text += ' ' + QString::fromUtf8(command.text, command.textSize);
+  }
+  return text;
+}
+
+CommandId commandFromName(const CommandToken &name) {
+  return kCommandTable.find(view(name), CommandId::Unknown);
+}
+
+bool statFromName(const CommandToken &name, StatId *stat) {
+  // Every StatId is in the table, so a miss needs its own sentinel.
+  const StatId missing = static_cast<StatId>(-1);
+  StatId found = kStatTable.find(view(name), missing);
+  if (found == missing) {
+    return false;
+  }
+  *stat = found;
+  return true;
+}
+
+bool parseCommandInt(const CommandToken &token, int *value) {
+  int i = 0;
+  bool negative = false;
+  if (token.size > 0 && (token.data[0] == '-' || token.data[0] == '+')) {
+    negative = token.data[0] == '-';
+    i = 1;
+  }
+  if (i == token.size) {
+    return false;
+  }
+  qint64 result = 0;
+  for (; i < token.size; ++i) {
+    char c = token.data[i];
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    result = result * 10 + (c - '0');
+    if (result > static_cast<qint64>(std::numeric_limits<int>::max()) + 1) {
+      return false;
+    }
+  }
+  if (negative) {
+    result = -result;
+  }
+  if (result > std::numeric_limits<int>::max()) {
+    return false;
+  }
+  *value = static_cast<int>(result);
+  return true;
+}
+
+bool decodeColorGrid(const char *data, int size, int cells,
+                     QVector<QChar> *colors) {
+  colors->clear();
+  colors->reserve(cells);
+  int count = 0;
+  bool counted = false;
+  for (int i = 0; i < size; ++i) {
+    char c = data[i];
+    if (c == ' ') {
+      if (counted) {
+        return false;  // A count goes right before its color.
+      }
+      continue;
+    }
+    if (c >= '0' && c <= '9') {
+      count = count * 10 + (c - '0');
+      counted = true;
+      if (count > cells) {
+        return false;
+      }
+      continue;
+    }
+    QChar color = c == '.' ? QChar() : QChar(c);
+    if (static_cast<uchar>(c) >= 0x80) {
+      // Like setColor, a non-ASCII color is one UTF-8 encoded character.
+      int length = utf8Length(c);
+      if (length == 0 || length > size - i) {
+        return false;
+      }
+      for (int k = 1; k < length; ++k) {
+        if ((static_cast<uchar>(data[i + k]) & 0xc0) != 0x80) {
+          return false;
+        }
+      }
+      QString decoded = QString::fromUtf8(data + i, length);
+      if (decoded.size() != 1) {
+        return false;
+      }
+      color = decoded.at(0);
+      i += length - 1;
+    } else if (c < '!' || c == 0x7f) {
+      return false;
+    }
+    int repeat = counted ? count : 1;
+    if (repeat == 0 || repeat > cells - colors->size()) {
+      return false;
+    }
+    for (int k = 0; k < repeat; ++k) {
+      colors->append(color);
+    }
+    count = 0;
+    counted = false;
+  }
+  return !counted && colors->size() == cells;
+}
+
+bool decodeTextGrid(const char *data, int size, int cells,
+                    QVector<QString> *text) {
+  text->clear();
+  text->reserve(cells);
+  int i = 0;
+  while (i < size) {
+    if (data[i] == ' ') {
+      ++i;
+      continue;
+    }
+    CommandToken token = {data + i, 0};
+    while (i < size && data[i] != ' ') {
+      ++i;
+    }
+    token.size = static_cast<int>(data + i - token.data);
+    int repeat = 1;
+    const char *star =
+        static_cast<const char *>(std::memchr(token.data, '*', token.size));
+    if (star && star + 1 < token.data + token.size) {
+      CommandToken count = {token.data, static_cast<int>(star - token.data)};
+      int parsed = 0;
+      // Anything but a positive count before the '*' is plain text.
+      if (parseCommandInt(count, &parsed) && parsed > 0) {
+        repeat = parsed;
+        token.size -= count.size + 1;
+        token.data = star + 1;
+      }
+    }
+    if (repeat > cells - text->size()) {
+      return false;
+    }
+    QString value = token.size == 1 && token.data[0] == '.'
+                        ? QString()
+                        : QString::fromUtf8(token.data, token.size);
+    for (int k = 0; k < repeat; ++k) {
+      text->append(value);
+    }
+  }
+  return text->size() == cells;
+}
+
+bool parsePath(const char *data, int size, QVector<Command> *steps) {
+  steps->clear();
+  int i = 0;
+  while (i < size) {
+    if (data[i] == ' ') {
+      ++i;
+      continue;
+    }
+    char kind = data[i++];
+    CommandToken count = {data + i, 0};
+    while (i < size && data[i] != ' ') {
+      ++i;
+    }
+    count.size = static_cast<int>(data + i - count.data);
+    Command step;
+    step.argCount = 1;
+    step.args[0] = 1;
+    if (kind == 'F' || kind == 'D') {
+      step.id = kind == 'F' ? CommandId::MoveForward
+                            : CommandId::MoveForwardHalf;
+      if (count.size > 0 &&
+          (!parseCommandInt(count, &step.args[0]) || step.args[0] < 1)) {
+        return false;
+      }
+    } else if (kind == 'R' || kind == 'L') {
+      std::string_view angle = view(count);
+      step.argCount = 0;
+      if (angle.empty() || angle == "90") {
+        step.id = kind == 'R' ? CommandId::TurnRight : CommandId::TurnLeft;
+      } else if (angle == "45") {
+        step.id = kind == 'R' ? CommandId::TurnRight45 : CommandId::TurnLeft45;
+      } else {
+        return false;
+      }
+    } else {
+      return false;
+    }
+    steps->append(step);
+  }
+  return !steps->isEmpty();
+}
+
+}  // namespace hadak
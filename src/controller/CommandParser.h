@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QChar>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "engine/Stats.h"
+
+namespace hadak {
+
+// The values double as binary protocol opcodes, so new commands go at
+// the end and existing values never change.
+enum class CommandId {
+  Unknown = 0,
+  MazeWidth = 1,
+  MazeHeight = 2,
+  GoalCount = 3,
+  GoalCell = 4,
+  IsGoal = 5,
+  WallFront = 6,
+  WallRight = 7,
+  WallLeft = 8,
+  WallBack = 9,
+  WallFrontRight = 10,
+  WallFrontLeft = 11,
+  WallBackRight = 12,
+  WallBackLeft = 13,
+  MoveForward = 14,
+  MoveForwardHalf = 15,
+  TurnRight = 16,
+  TurnLeft = 17,
+  TurnRight45 = 18,
+  TurnLeft45 = 19,
+  SetWall = 20,
+  ClearWall = 21,
+  SetColor = 22,
+  ClearColor = 23,
+  ClearAllColor = 24,
+  SetText = 25,
+  ClearText = 26,
+  ClearAllText = 27,
+  WasReset = 28,
+  AckReset = 29,
+  GetStat = 30,
+  Sense = 31,
+  SetColorGrid = 32,
+  SetTextGrid = 33,
+  SetColorRect = 34,
+  RunPath = 35,
+  FloodKnown = 36,
+  NextMoveKnown = 37,
+  PushSense = 38,
+};
+
+// Bits of the sense answer: every isWall* probe plus the goal and reset
+// flags, so one round trip replaces a step's worth of queries.
+enum SenseBit {
+  SenseFront = 1 << 0,
+  SenseLeft = 1 << 1,
+  SenseRight = 1 << 2,
+  SenseBack = 1 << 3,
+  SenseFrontLeft = 1 << 4,
+  SenseFrontRight = 1 << 5,
+  SenseBackLeft = 1 << 6,
+  SenseBackRight = 1 << 7,
+  SenseGoal = 1 << 8,
+  SenseReset = 1 << 9,
+};
+
+// A view into a command line; nothing is copied.
+struct CommandToken {
+  const char *data = nullptr;
+  int size = 0;
+};
+
+const int kMaxCommandTokens = 6;
+
+// One bot line split on spaces, straight from its UTF-8 bytes. Only the
+// first kMaxCommandTokens tokens are kept but count covers them all, so
+// arity checks still see extra arguments. rest() runs from the start of a
+// token to the end of the line (setText's free-form text).
+struct CommandLine {
+  CommandId id = CommandId::Unknown;
+  CommandToken tokens[kMaxCommandTokens];
+  int count = 0;
+  const char *end = nullptr;
+
+  int argCount() const { return count - 1; }
+  const CommandToken &arg(int index) const { return tokens[index + 1]; }
+  CommandToken rest(int index) const;
+};
+
+// A request decoded from either protocol: the integer arguments in order,
+// the color or wall direction as symbol, and setText's text, a grid's
+// payload or runPath's program as a view into the request bytes.
+struct Command {
+  CommandId id = CommandId::Unknown;
+  int argCount = 0;
+  int args[4] = {};
+  QChar symbol;
+  StatId stat = StatId::Score;
+  const char *text = nullptr;
+  int textSize = 0;
+};
+
+bool parseCommandLine(const char *data, int size, CommandLine *line);
+bool buildCommand(const CommandLine &line, Command *command);
+QString commandText(const Command &command);
+QString commandName(CommandId id);
+CommandId commandFromName(const CommandToken &name);
+bool statFromName(const CommandToken &name, StatId *stat);
+bool parseCommandInt(const CommandToken &token, int *value);
+
+// Bulk overlay payloads list cells row by row, y = 0 first and x
+// increasing, and must cover exactly cells cells. A color grid has one
+// character per cell, '.' clearing it, and a decimal count in front of a
+// character repeats it; spaces are ignored. Colors are the printable ones
+// setColor takes, UTF-8 included, except digits. A text grid has one
+// space-separated token per cell, "." clearing it, and "count*token"
+// repeats a token.
+bool decodeColorGrid(const char *data, int size, int cells,
+                     QVector<QChar> *colors);
+bool decodeTextGrid(const char *data, int size, int cells,
+                    QVector<QString> *text);
+
+// runPath's program, as the move and turn commands it stands for. Steps
+// are separated by spaces: Fn moves n cells and Dn n half-steps (a
+// diagonal's unit), n defaulting to 1; R and L turn 90 degrees, R45 and
+// L45 45 degrees.
+bool parsePath(const char *data, int size, QVector<Command> *steps);
+
+}  // namespace hadak
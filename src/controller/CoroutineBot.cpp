@@ -0,0 +1,259 @@
+#include "controller/CoroutineBot.h"
+
+#include <utility>
+
+#include "controller/BinaryProtocol.h"
+#include "controller/SimController.h"
+#include "engine/Simulation.h"
+
+namespace hadak {
+
+BotTask::BotTask(std::coroutine_handle<promise_type> handle)
+    : m_handle(handle) {}
+
+BotTask::BotTask(BotTask &&other) noexcept
+    : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+BotTask &BotTask::operator=(BotTask &&other) noexcept {
+  if (this != &other) {
+    if (m_handle) {
+      m_handle.destroy();
+    }
+    m_handle = std::exchange(other.m_handle, nullptr);
+  }
+  return *this;
+}
+
+BotTask::~BotTask() {
+  if (m_handle) {
+    m_handle.destroy();
+  }
+}
+
+bool BotTask::isValid() const { return static_cast<bool>(m_handle); }
+
+bool BotTask::isDone() const { return !m_handle || m_handle.done(); }
+
+bool BotTask::failed() const { return m_handle && m_handle.promise().failed; }
+
+void BotTask::resume() {
+  if (!isDone()) {
+    m_handle.resume();
+  }
+}
+
+void BotMouse::Movement::await_suspend(std::coroutine_handle<> handle) {
+  m_mouse->m_waiting = handle;
+}
+
+bool BotMouse::Movement::await_resume() const noexcept {
+  return !(m_started ? m_mouse->m_lastCrashed : m_crashed);
+}
+
+BotMouse::BotMouse(SimController *controller) : m_controller(controller) {}
+
+int BotMouse::mazeWidth() { return query(CommandId::MazeWidth); }
+
+int BotMouse::mazeHeight() { return query(CommandId::MazeHeight); }
+
+int BotMouse::goalCount() { return query(CommandId::GoalCount); }
+
+QPair<int, int> BotMouse::goalCell(int index) {
+  qint32 y = 0;
+  qint32 x = query(CommandId::GoalCell, 0, index, 0, &y);
+  return qMakePair(x, y);
+}
+
+bool BotMouse::isGoal() { return query(CommandId::IsGoal) != 0; }
+
+bool BotMouse::wallFront(int distance) {
+  return query(CommandId::WallFront, 0, distance) != 0;
+}
+
+bool BotMouse::wallRight(int distance) {
+  return query(CommandId::WallRight, 0, distance) != 0;
+}
+
+bool BotMouse::wallLeft(int distance) {
+  return query(CommandId::WallLeft, 0, distance) != 0;
+}
+
+bool BotMouse::wallBack(int distance) {
+  return query(CommandId::WallBack, 0, distance) != 0;
+}
+
+int BotMouse::sense(int distance) {
+  return query(CommandId::Sense, 0, distance);
+}
+
+bool BotMouse::wasReset() { return query(CommandId::WasReset) != 0; }
+
+void BotMouse::ackReset() { query(CommandId::AckReset); }
+
+void BotMouse::setWall(int x, int y, QChar direction) {
+  query(CommandId::SetWall, direction.unicode(), x, y);
+}
+
+void BotMouse::clearWall(int x, int y, QChar direction) {
+  query(CommandId::ClearWall, direction.unicode(), x, y);
+}
+
+void BotMouse::setColor(int x, int y, QChar color) {
+  query(CommandId::SetColor, color.unicode(), x, y);
+}
+
+void BotMouse::clearColor(int x, int y) {
+  query(CommandId::ClearColor, 0, x, y);
+}
+
+void BotMouse::clearAllColor() { query(CommandId::ClearAllColor); }
+
+void BotMouse::setText(int x, int y, const QString &text) {
+  sendPayload(CommandId::SetText, text.toUtf8(), x, y);
+}
+
+void BotMouse::clearText(int x, int y) { query(CommandId::ClearText, 0, x, y); }
+
+void BotMouse::clearAllText() { query(CommandId::ClearAllText); }
+
+void BotMouse::setColorRect(int x0, int y0, int x1, int y1, QChar color) {
+  query(CommandId::SetColorRect, color.unicode(), packBinaryCell(x0, y0),
+        packBinaryCell(x1, y1));
+}
+
+void BotMouse::setColorGrid(const QByteArray &grid) {
+  sendPayload(CommandId::SetColorGrid, grid);
+}
+
+void BotMouse::setTextGrid(const QByteArray &grid) {
+  sendPayload(CommandId::SetTextGrid, grid);
+}
+
+void BotMouse::sendPayload(CommandId id, const QByteArray &payload, qint32 a,
+                           qint32 b) {
+  ++m_calls;
+  QByteArray bytes = payload.left(0xffff);
+  Command command;
+  buildBinaryCommand(static_cast<quint16>(id),
+                     static_cast<quint16>(bytes.size()), a, b,
+                     bytes.constData(), &command);
+  bool crashed = false;
+  bool deferred = false;
+  qint32 value = 0;
+  qint32 extra = 0;
+  m_controller->executeDirect(command, &crashed, &value, &extra, &deferred);
+}
+
+BotMouse::Movement BotMouse::moveForward(int cells) {
+  return move(CommandId::MoveForward, cells);
+}
+
+BotMouse::Movement BotMouse::moveForwardHalf(int halfSteps) {
+  return move(CommandId::MoveForwardHalf, halfSteps);
+}
+
+BotMouse::Movement BotMouse::turnRight() { return move(CommandId::TurnRight); }
+
+BotMouse::Movement BotMouse::turnLeft() { return move(CommandId::TurnLeft); }
+
+BotMouse::Movement BotMouse::turnRight45() {
+  return move(CommandId::TurnRight45);
+}
+
+BotMouse::Movement BotMouse::turnLeft45() {
+  return move(CommandId::TurnLeft45);
+}
+
+qint32 BotMouse::query(CommandId id, quint16 aux, qint32 a, qint32 b,
+                    qint32 *extra) {
+  ++m_calls;
+  Command command;
+  bool crashed = false;
+  bool deferred = false;
+  qint32 value = 0;
+  qint32 second = 0;
+  if (!buildBinaryCommand(static_cast<quint16>(id), aux, a, b, nullptr,
+                          &command) ||
+      !m_controller->executeDirect(command, &crashed, &value, &second,
+                                   &deferred)) {
+    return 0;
+  }
+  if (extra) {
+    *extra = second;
+  }
+  return value;
+}
+
+BotMouse::Movement BotMouse::move(CommandId id, qint32 count) {
+  ++m_calls;
+  Command command;
+  bool crashed = true;
+  bool deferred = false;
+  qint32 value = 0;
+  qint32 extra = 0;
+  if (buildBinaryCommand(static_cast<quint16>(id), 0, count, 0, nullptr,
+                         &command) &&
+      m_controller->executeDirect(command, &crashed, &value, &extra,
+                                  &deferred)) {
+    return Movement(this, deferred, crashed);
+  }
+  // An invalid move (for one, issued while another is still running)
+  // reports as a crash without suspending.
+  return Movement(this, false, true);
+}
+
+CoroutineBot::CoroutineBot(Simulation *sim, SimController *controller,
+                           QObject *parent)
+    : QObject(parent), m_mouse(controller) {
+  // Connected after the controller's own handler, so by the time the bot
+  // resumes the controller is ready for its next command.
+  connect(sim, &Simulation::movementFinished, this,
+          [this, controller](int agent, bool crashed) {
+            if (agent != controller->agent() || !m_mouse.m_waiting) {
+              return;
+            }
+            m_mouse.m_lastCrashed = crashed;
+            resume();
+          });
+}
+
+CoroutineBot::~CoroutineBot() = default;
+
+void CoroutineBot::start(const Body &body) {
+  stop();
+  m_mouse.m_calls = 0;
+  m_mouse.m_lastCrashed = false;
+  m_task = body(m_mouse);
+  m_running = true;
+  m_task.resume();
+  if (m_task.isDone()) {
+    m_running = false;
+    emit finished();
+  }
+}
+
+void CoroutineBot::stop() {
+  m_running = false;
+  m_mouse.m_waiting = nullptr;
+  m_task = BotTask();
+}
+
+bool CoroutineBot::isRunning() const { return m_running; }
+
+bool CoroutineBot::failed() const { return m_task.failed(); }
+
+qint64 CoroutineBot::calls() const { return m_mouse.m_calls; }
+
+void CoroutineBot::resume() {
+  std::coroutine_handle<> handle = std::exchange(m_mouse.m_waiting, nullptr);
+  if (!m_running || !handle) {
+    return;
+  }
+  handle.resume();
+  if (m_task.isDone()) {
+    m_running = false;
+    emit finished();
+  }
+}
+
+}  // namespace hadak
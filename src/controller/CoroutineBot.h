@@ -0,0 +1,166 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <coroutine>
+#include <functional>
+
+#include "controller/CommandParser.h"
+
+namespace hadak {
+
+class SimController;
+class Simulation;
+
+// What a coroutine bot body returns. The body starts suspended and is
+// resumed by CoroutineBot.
+class BotTask {
+ public:
+  struct promise_type {
+    bool failed = false;
+
+    BotTask get_return_object() {
+      return BotTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { failed = true; }
+  };
+
+  BotTask() = default;
+  BotTask(BotTask &&other) noexcept;
+  BotTask &operator=(BotTask &&other) noexcept;
+  BotTask(const BotTask &) = delete;
+  BotTask &operator=(const BotTask &) = delete;
+  ~BotTask();
+
+  bool isValid() const;
+  bool isDone() const;
+  bool failed() const;
+  void resume();
+
+ private:
+  explicit BotTask(std::coroutine_handle<promise_type> handle);
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+// A coroutine bot's view of its mouse. Questions answer at once; moves
+// are awaited and suspend the bot until the simulation finishes them:
+//
+//   BotTask leftWall(BotMouse &mouse) {
+//     while (!mouse.isGoal()) {
+//       if (!mouse.wallLeft()) co_await mouse.turnLeft();
+//       while (mouse.wallFront()) co_await mouse.turnRight();
+//       if (!co_await mouse.moveForward()) co_return;
+//     }
+//   }
+//
+// Every call goes through SimController::executeDirect, so traces, pause
+// and overlays behave as for any other bot.
+class BotMouse {
+ public:
+  // co_await yields false if the mouse crashed.
+  class [[nodiscard]] Movement {
+   public:
+    bool await_ready() const noexcept { return !m_started; }
+    void await_suspend(std::coroutine_handle<> handle);
+    bool await_resume() const noexcept;
+
+   private:
+    friend class BotMouse;
+    Movement(BotMouse *mouse, bool started, bool crashed)
+        : m_mouse(mouse), m_started(started), m_crashed(crashed) {}
+
+    BotMouse *m_mouse;
+    bool m_started;
+    bool m_crashed;
+  };
+
+  explicit BotMouse(SimController *controller);
+
+  int mazeWidth();
+  int mazeHeight();
+  int goalCount();
+  QPair<int, int> goalCell(int index);
+  bool isGoal();
+  bool wallFront(int distance = 1);
+  bool wallRight(int distance = 1);
+  bool wallLeft(int distance = 1);
+  bool wallBack(int distance = 1);
+  // The SenseBit mask.
+  int sense(int distance = 1);
+  bool wasReset();
+  void ackReset();
+
+  void setWall(int x, int y, QChar direction);
+  void clearWall(int x, int y, QChar direction);
+  void setColor(int x, int y, QChar color);
+  void clearColor(int x, int y);
+  void clearAllColor();
+  void setText(int x, int y, const QString &text);
+  void clearText(int x, int y);
+  void clearAllText();
+  // Bulk forms; see decodeColorGrid and decodeTextGrid for the payloads.
+  void setColorRect(int x0, int y0, int x1, int y1, QChar color);
+  void setColorGrid(const QByteArray &grid);
+  void setTextGrid(const QByteArray &grid);
+
+  Movement moveForward(int cells = 1);
+  Movement moveForwardHalf(int halfSteps = 1);
+  Movement turnRight();
+  Movement turnLeft();
+  Movement turnRight45();
+  Movement turnLeft45();
+
+ private:
+  friend class CoroutineBot;
+
+  SimController *m_controller;
+  std::coroutine_handle<> m_waiting;
+  bool m_lastCrashed = false;
+  qint64 m_calls = 0;
+
+  qint32 query(CommandId id, quint16 aux = 0, qint32 a = 1, qint32 b = 0,
+               qint32 *extra = nullptr);
+  Movement move(CommandId id, qint32 count = 1);
+  void sendPayload(CommandId id, const QByteArray &payload, qint32 a = 0,
+                   qint32 b = 0);
+};
+
+// Runs one coroutine bot for a SimController's mouse. The bot is resumed
+// on whichever thread drives the simulation, straight from the tick that
+// finished its movement, so it needs no thread, process or lock of its own.
+class CoroutineBot : public QObject {
+  Q_OBJECT
+
+ public:
+  using Body = std::function<BotTask(BotMouse &)>;
+
+  CoroutineBot(Simulation *sim, SimController *controller,
+               QObject *parent = nullptr);
+  ~CoroutineBot() override;
+
+  // Runs the body up to its first movement.
+  void start(const Body &body);
+  void stop();
+  bool isRunning() const;
+  // Whether the body ended by throwing.
+  bool failed() const;
+  qint64 calls() const;
+
+ signals:
+  void finished();
+
+ private:
+  BotMouse m_mouse;
+  BotTask m_task;
+  bool m_running = false;
+
+  void resume();
+};
+
+}  // namespace hadak
@@ -0,0 +1,209 @@
+#include "controller/HeadlessRunner.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <memory>
+
+#include "controller/BotPool.h"
+#include "controller/BotProcess.h"
+#include "controller/PluginBot.h"
+#include "controller/SimController.h"
+#include "engine/Simulation.h"
+
+namespace hadak {
+
+namespace {
+
+void collectResult(const Simulation &sim, const QElapsedTimer &clock,
+                   MatchResult *result) {
+  result->solved = sim.goalReached();
+  result->steps = sim.stepCount();
+  result->collisions = sim.collisionCount();
+  result->simTime = sim.simTime();
+  result->stats = sim.stats();
+  result->elapsedMs = clock.elapsed();
+}
+
+}  // namespace
+
+void HeadlessRunner::setLimits(const MatchLimits &limits) {
+  m_limits = limits;
+}
+
+const MatchLimits &HeadlessRunner::limits() const { return m_limits; }
+
+void HeadlessRunner::setKinematic(bool enabled, const KinematicModel &model) {
+  m_kinematic = enabled;
+  m_kinematics = model;
+}
+
+void HeadlessRunner::setSharedMemory(bool enabled) {
+  m_sharedMemory = enabled;
+}
+
+void HeadlessRunner::setSpareBots(int count) { m_spareBots = count; }
+
+void HeadlessRunner::setProfiling(bool enabled) { m_profiling = enabled; }
+
+MatchResult HeadlessRunner::run(const Maze &maze, const QString &command,
+                                const QString &workingDir) const {
+  MatchResult result;
+  QElapsedTimer clock;
+  clock.start();
+
+  Simulation sim;
+  setUp(&sim, maze);
+  SimController controller(&sim);
+  if (m_profiling) {
+    controller.setProfiler(&result.latency);
+  }
+  BotProcess bot;
+  bot.setSharedMemory(m_sharedMemory);
+  BotLimits botLimits;
+  botLimits.cpuSeconds = m_limits.cpuSeconds;
+  botLimits.memoryBytes = m_limits.memoryBytes;
+  botLimits.responseTimeoutMs = m_limits.responseTimeoutMs;
+  bot.setLimits(botLimits);
+  if (m_spareBots > 0) {
+    // Processes belong to the thread that started them, so each thread
+    // keeps its own spares.
+    static thread_local std::unique_ptr<BotPool> pool;
+    if (!pool) {
+      pool = std::make_unique<BotPool>();
+    }
+    pool->setSize(m_spareBots);
+    bot.setPool(pool.get());
+  }
+  QEventLoop loop;
+  QTimer watchdog;
+  watchdog.setSingleShot(true);
+
+  auto finish = [&](const QString &status, const QString &reason = {}) {
+    if (result.status.isEmpty()) {
+      result.status = status;
+      result.reason = reason;
+    }
+    loop.quit();
+  };
+
+  auto afterCommand = [&]() {
+    while (sim.isMoving() && result.ticks < m_limits.maxTicks) {
+      result.ticks += sim.advanceToNextEvent();
+    }
+    if (sim.goalReached()) {
+      finish("solved");
+    } else if (result.ticks >= m_limits.maxTicks) {
+      finish("tick-limit",
+             QString("Reached %1 ticks").arg(m_limits.maxTicks));
+    }
+  };
+  QObject::connect(&bot, &BotProcess::commandReceived, &loop,
+                   [&](QByteArrayView line) {
+                     if (!result.status.isEmpty()) {
+                       return;
+                     }
+                     ++result.commands;
+                     controller.enqueueLine(line);
+                     afterCommand();
+                   });
+  QObject::connect(&bot, &BotProcess::frameReceived, &loop,
+                   [&](const QByteArray &frame) {
+                     if (!result.status.isEmpty()) {
+                       return;
+                     }
+                     ++result.commands;
+                     controller.enqueueFrame(frame);
+                     afterCommand();
+                   });
+  QObject::connect(&bot, &BotProcess::limitExceeded, &loop,
+                   [&](const QString &status, const QString &reason) {
+                     finish(status, reason);
+                   });
+  QObject::connect(&bot, &BotProcess::finished, &loop,
+                   [&]() { finish("exited", bot.exitReason()); });
+  QObject::connect(&watchdog, &QTimer::timeout, &loop, [&]() {
+    finish("timeout",
+           QString("Over the %1 ms wall-clock limit").arg(m_limits.timeoutMs));
+  });
+
+  if (PluginBot::isPluginCommand(command)) {
+    // Plugins run on this thread with no event loop: each step is followed
+    // by the movement it started, until the bot is done.
+    PluginBot plugin;
+    QString error;
+    if (!plugin.load(QDir(workingDir).absoluteFilePath(command.trimmed()),
+                     &error)) {
+      result.status = "start-failed";
+      result.reason = error;
+    } else {
+      plugin.attach(&sim, &controller);
+      while (result.status.isEmpty()) {
+        if (!plugin.step()) {
+          finish("exited");
+          break;
+        }
+        afterCommand();
+        if (result.status.isEmpty() && clock.elapsed() >= m_limits.timeoutMs) {
+          finish("timeout", QString("Over the %1 ms wall-clock limit")
+                                .arg(m_limits.timeoutMs));
+        }
+      }
+      plugin.stop();
+      result.commands = plugin.calls();
+    }
+  } else if (!bot.start(command, workingDir)) {
+    result.status = "start-failed";
+    result.reason = "The bot process did not start";
+  } else {
+    controller.attachBot(&bot);
+    watchdog.start(m_limits.timeoutMs);
+    loop.exec();
+    controller.attachBot(nullptr);
+    bot.stop();
+  }
+
+  collectResult(sim, clock, &result);
+  return result;
+}
+
+MatchResult HeadlessRunner::run(const Maze &maze,
+                                const CoroutineBot::Body &body) const {
+  MatchResult result;
+  QElapsedTimer clock;
+  clock.start();
+
+  Simulation sim;
+  setUp(&sim, maze);
+  SimController controller(&sim);
+  CoroutineBot bot(&sim, &controller);
+  // Each event may finish a movement and so resume the bot, which starts
+  // the next one before advanceToNextEvent() returns.
+  bot.start(body);
+  while (result.status.isEmpty()) {
+    if (sim.goalReached()) {
+      result.status = "solved";
+    } else if (!bot.isRunning() || !sim.isMoving()) {
+      result.status = "exited";
+    } else if (result.ticks >= m_limits.maxTicks) {
+      result.status = "tick-limit";
+    } else if (clock.elapsed() >= m_limits.timeoutMs) {
+      result.status = "timeout";
+    } else {
+      result.ticks += sim.advanceToNextEvent();
+    }
+  }
+  bot.stop();
+  result.commands = bot.calls();
+  collectResult(sim, clock, &result);
+  return result;
+}
+
+void HeadlessRunner::setUp(Simulation *sim, const Maze &maze) const {
+  sim->setMaze(std::unique_ptr<Maze>(new Maze(maze)));
+  sim->setKinematicEnabled(m_kinematic);
+  sim->setKinematicModel(m_kinematics);
+}
+
+}  // namespace hadak
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include "controller/CoroutineBot.h"
+#include "controller/LatencyProfiler.h"
+#include "engine/Kinematics.h"
+#include "engine/Maze.h"
+#include "engine/Stats.h"
+
+namespace hadak {
+
+class Simulation;
+
+// timeoutMs is the wall clock for the whole match. The rest only apply to
+// bot processes; 0 leaves them off (see BotLimits).
+struct MatchLimits {
+  qint64 maxTicks = 200000;
+  int timeoutMs = 60000;
+  int cpuSeconds = 0;
+  qint64 memoryBytes = 0;
+  int responseTimeoutMs = 0;
+};
+
+// Outcome of one bot on one maze. status is "solved", "exited" (the bot
+// quit first), "timeout", "tick-limit", "cpu-limit", "memory-limit",
+// "no-response" or "start-failed"; reason says more for the failures and
+// gives the exit code or signal of a bot that exited badly.
+struct MatchResult {
+  QString status;
+  QString reason;
+  bool solved = false;
+  int steps = 0;
+  int collisions = 0;
+  qint64 ticks = 0;
+  double simTime = 0.0;
+  qint64 commands = 0;
+  qint64 elapsedMs = 0;
+  Stats stats;
+  // Filled for bot processes when profiling is on.
+  LatencyProfiler latency;
+};
+
+// Plays one bot process or plugin against one maze without a window:
+// every command is answered as soon as it arrives and each move is
+// completed in one scheduler event, so a match runs as fast as the bot can
+// talk. ticks still counts what the window would have animated. run()
+// blocks in a local event loop and may be called from any QThread.
+class HeadlessRunner {
+ public:
+  void setLimits(const MatchLimits &limits);
+  const MatchLimits &limits() const;
+  void setKinematic(bool enabled, const KinematicModel &model = {});
+  void setSharedMemory(bool enabled);
+  // Spare bot processes each calling thread keeps started for the next
+  // match of the same bot. They sit idle outside any match.
+  void setSpareBots(int count);
+  // Times every request of a bot process into MatchResult::latency.
+  void setProfiling(bool enabled);
+
+  MatchResult run(const Maze &maze, const QString &command,
+                  const QString &workingDir) const;
+  // Plays a coroutine bot on the calling thread with no event loop, so
+  // many can be evaluated on a few threads.
+  MatchResult run(const Maze &maze, const CoroutineBot::Body &body) const;
+
+ private:
+  MatchLimits m_limits;
+  bool m_kinematic = false;
+  KinematicModel m_kinematics;
+  bool m_sharedMemory = false;
+  int m_spareBots = 0;
+  bool m_profiling = false;
+
+  void setUp(Simulation *sim, const Maze &maze) const;
+};
+
+}  // namespace hadak
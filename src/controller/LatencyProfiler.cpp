@@ -0,0 +1,196 @@
+#include "controller/LatencyProfiler.h"
+
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace hadak {
+
+namespace {
+
+const char *const kPhaseNames[] = {"think", "wait", "service"};
+
+// Eight linear sub-buckets per power of two; below 8 ns every value has
+// its own bucket.
+int bucketIndex(qint64 ns) {
+  quint64 value = ns > 0 ? static_cast<quint64>(ns) : 0;
+  if (value < 8) {
+    return static_cast<int>(value);
+  }
+  int octave = 63 - static_cast<int>(qCountLeadingZeroBits(value));
+  return (octave - 2) * 8 + static_cast<int>((value >> (octave - 3)) & 7);
+}
+
+qint64 bucketValue(int index) {
+  if (index < 8) {
+    return index;
+  }
+  int shift = index / 8 - 1;
+  qint64 lower = static_cast<qint64>(8 + index % 8) << shift;
+  return lower + ((Q_INT64_C(1) << shift) >> 1);
+}
+
+QString formatDuration(qint64 ns) {
+  if (ns < 1000000) {
+    return QString("%1us").arg(ns / 1000.0, 0, 'f', 1);
+  }
+  if (ns < Q_INT64_C(1000000000)) {
+    return QString("%1ms").arg(ns / 1000000.0, 0, 'f', 1);
+  }
+  return QString("%1s").arg(ns / 1000000000.0, 0, 'f', 2);
+}
+
+}  // namespace
+
+void LatencyHistogram::add(qint64 ns) {
+  ++m_buckets[std::min(bucketIndex(ns), kBuckets - 1)];
+  ++m_count;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+  for (int i = 0; i < kBuckets; ++i) {
+    m_buckets[i] += other.m_buckets[i];
+  }
+  m_count += other.m_count;
+}
+
+qint64 LatencyHistogram::count() const { return m_count; }
+
+qint64 LatencyHistogram::percentile(double fraction) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  qint64 rank = std::max<qint64>(
+      1, static_cast<qint64>(std::ceil(fraction * m_count)));
+  qint64 seen = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    seen += m_buckets[i];
+    if (seen >= rank) {
+      return bucketValue(i);
+    }
+  }
+  return bucketValue(kBuckets - 1);
+}
+
+qint64 LatencyProfiler::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void LatencyProfiler::clear() {
+  m_entries.clear();
+  startRun();
+}
+
+void LatencyProfiler::startRun() {
+  m_lastReceived = 0;
+  m_lastAnswered = 0;
+}
+
+LatencyProfiler::Sample LatencyProfiler::received(qint64 ns) {
+  Sample sample;
+  sample.received = ns;
+  qint64 since = std::max(m_lastReceived, m_lastAnswered);
+  if (since > 0) {
+    sample.think = std::max<qint64>(0, ns - since);
+  }
+  m_lastReceived = ns;
+  return sample;
+}
+
+void LatencyProfiler::dispatched(Sample *sample) {
+  if (sample->received > 0) {
+    sample->dispatched = now();
+  }
+}
+
+void LatencyProfiler::finished(CommandId id, const Sample &sample,
+                               bool answered) {
+  // Requests that arrived before the profiler was attached are not timed.
+  if (sample.received == 0) {
+    return;
+  }
+  qint64 done = now();
+  Entry &entry = m_entries[static_cast<int>(id)];
+  if (sample.think >= 0) {
+    entry.phases[Think].add(sample.think);
+  }
+  entry.phases[Wait].add(sample.dispatched - sample.received);
+  entry.phases[Service].add(done - sample.dispatched);
+  if (answered) {
+    m_lastAnswered = done;
+  }
+}
+
+void LatencyProfiler::merge(const LatencyProfiler &other) {
+  for (auto it = other.m_entries.cbegin(); it != other.m_entries.cend();
+       ++it) {
+    Entry &entry = m_entries[it.key()];
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+      entry.phases[phase].merge(it.value().phases[phase]);
+    }
+  }
+}
+
+bool LatencyProfiler::isEmpty() const { return m_entries.isEmpty(); }
+
+QJsonObject LatencyProfiler::toJson() const {
+  QJsonObject commands;
+  for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+    QJsonObject entry;
+    entry.insert("count", it.value().phases[Service].count());
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+      const LatencyHistogram &histogram = it.value().phases[phase];
+      QJsonObject percentiles;
+      percentiles.insert("p50", histogram.percentile(0.5) / 1000.0);
+      percentiles.insert("p99", histogram.percentile(0.99) / 1000.0);
+      entry.insert(kPhaseNames[phase], percentiles);
+    }
+    commands.insert(commandName(static_cast<CommandId>(it.key())), entry);
+  }
+  return commands;
+}
+
+QString LatencyProfiler::report() const {
+  // Busiest commands first.
+  QList<QPair<qint64, int>> order;
+  for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+    order.append({it.value().phases[Service].count(), it.key()});
+  }
+  std::sort(order.begin(), order.end(),
+            [](const QPair<qint64, int> &a, const QPair<qint64, int> &b) {
+              return a.first > b.first;
+            });
+  QStringList lines;
+  lines << QString("%1 %2 %3 %4 %5")
+               .arg("command", -16)
+               .arg("count", 7)
+               .arg("think p50/p99", 19)
+               .arg("wait p50/p99", 19)
+               .arg("service p50/p99", 19);
+  for (const QPair<qint64, int> &item : order) {
+    const Entry &entry = m_entries.constFind(item.second).value();
+    QString line = QString("%1 %2")
+                       .arg(commandName(static_cast<CommandId>(item.second)),
+                            -16)
+                       .arg(item.first, 7);
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+      const LatencyHistogram &histogram = entry.phases[phase];
+      QString cell = histogram.count() == 0
+                         ? QStringLiteral("-")
+                         : QString("%1/%2")
+                               .arg(formatDuration(histogram.percentile(0.5)))
+                               .arg(formatDuration(histogram.percentile(0.99)));
+      line += QString(" %1").arg(cell, 19);
+    }
+    lines << line;
+  }
+  return lines.join('\n');
+}
+
+}  // namespace hadak
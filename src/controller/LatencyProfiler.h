@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QtGlobal>
+
+#include "controller/CommandParser.h"
+
+namespace hadak {
+
+// Counts durations in log-spaced buckets, eight to an octave, so a
+// percentile is within about 6% of the true value whatever the scale and
+// memory stays fixed however long the run.
+class LatencyHistogram {
+ public:
+  void add(qint64 ns);
+  void merge(const LatencyHistogram &other);
+  qint64 count() const;
+  // The duration below which fraction of the samples fall, in ns.
+  qint64 percentile(double fraction) const;
+
+ private:
+  static const int kBuckets = 328;
+
+  quint32 m_buckets[kBuckets] = {};
+  qint64 m_count = 0;
+};
+
+// Where one request's time went, per command type:
+//  think   - from the bot's last chance to act (our previous answer, or
+//            its previous request) until this request was read off the
+//            pipe;
+//  wait    - from being read until SimController dispatched it: the hop to
+//            the GUI thread plus any queueing behind a movement;
+//  service - from dispatch until the answer was sent, so a move includes
+//            its animation.
+class LatencyProfiler {
+ public:
+  enum Phase { Think, Wait, Service, PhaseCount };
+
+  // One request on its way through SimController.
+  struct Sample {
+    qint64 received = 0;
+    qint64 think = -1;
+    qint64 dispatched = 0;
+  };
+
+  // A monotonic clock in ns, shared by every timestamp the profiler sees.
+  static qint64 now();
+
+  void clear();
+  // Forgets the last request and answer, so the first request of a new
+  // run gets no think time.
+  void startRun();
+
+  Sample received(qint64 ns);
+  void dispatched(Sample *sample);
+  // answered is false for commands that have no answer; the bot did not
+  // wait for them.
+  void finished(CommandId id, const Sample &sample, bool answered);
+
+  void merge(const LatencyProfiler &other);
+  bool isEmpty() const;
+  // Per command: count and p50/p99 of each phase in microseconds.
+  QJsonObject toJson() const;
+  // The same as a fixed-width table for the debug panel.
+  QString report() const;
+
+ private:
+  struct Entry {
+    LatencyHistogram phases[PhaseCount];
+  };
+
+  QHash<int, Entry> m_entries;
+  qint64 m_lastReceived = 0;
+  qint64 m_lastAnswered = 0;
+};
+
+}  // namespace hadak
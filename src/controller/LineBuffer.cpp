@@ -0,0 +1,109 @@
+#include "controller/LineBuffer.h"
+
+#include <cstring>
+
+namespace hadak {
+
+namespace {
+
+QByteArrayView withoutCarriageReturn(const char *data, int size) {
+  if (size > 0 && data[size - 1] == '\r') {
+    --size;
+  }
+  return QByteArrayView(data, size);
+}
+
+}  // namespace
+
+void LineBuffer::append(const char *data, int size) {
+  compact();
+  m_data.append(data, size);
+}
+
+void LineBuffer::append(const QByteArray &bytes) {
+  if (m_data.isEmpty()) {
+    // Shares the caller's buffer; nothing is copied until we write to it.
+    m_data = bytes;
+    m_start = 0;
+    return;
+  }
+  append(bytes.constData(), bytes.size());
+}
+
+bool LineBuffer::nextLine(QByteArrayView *line) {
+  const char *begin = m_data.constData() + m_start;
+  int size = m_data.size() - m_start;
+  const char *end = static_cast<const char *>(std::memchr(begin, '\n', size));
+  if (!end) {
+    return false;
+  }
+  int length = static_cast<int>(end - begin);
+  *line = withoutCarriageReturn(begin, length);
+  m_start += length + 1;
+  return true;
+}
+
+QByteArray LineBuffer::takeLines() {
+  const char *begin = m_data.constData() + m_start;
+  int size = m_data.size() - m_start;
+  // Reads usually end on a newline, so look from the back.
+  int length = size;
+  while (length > 0 && begin[length - 1] != '\n') {
+    --length;
+  }
+  if (length == 0) {
+    return QByteArray();
+  }
+  QByteArray lines;
+  if (m_start == 0 && length == m_data.size()) {
+    lines = m_data;
+    clear();
+  } else {
+    lines = QByteArray(begin, length);
+    m_start += length;
+  }
+  return lines;
+}
+
+QByteArray LineBuffer::takeAll() {
+  QByteArray rest = m_start == 0 ? m_data : m_data.mid(m_start);
+  clear();
+  return rest;
+}
+
+bool LineBuffer::isEmpty() const { return m_start == m_data.size(); }
+
+void LineBuffer::clear() {
+  m_data.clear();
+  m_start = 0;
+}
+
+bool LineBuffer::splitLine(QByteArrayView *block, QByteArrayView *line) {
+  const char *begin = block->data();
+  int size = static_cast<int>(block->size());
+  const char *end =
+      size > 0 ? static_cast<const char *>(std::memchr(begin, '\n', size))
+               : nullptr;
+  if (!end) {
+    return false;
+  }
+  int length = static_cast<int>(end - begin);
+  *line = withoutCarriageReturn(begin, length);
+  *block = QByteArrayView(end + 1, size - length - 1);
+  return true;
+}
+
+void LineBuffer::compact() {
+  if (m_start == 0) {
+    return;
+  }
+  if (m_start == m_data.size()) {
+    m_data.resize(0);
+    m_start = 0;
+  } else if (m_start * 2 >= m_data.size()) {
+    m_data.remove(0, m_start);
+    m_start = 0;
+  }
+}
+
+}  // namespace hadak
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+namespace hadak {
+
+// Splits a byte stream into lines without copying them. Bytes are
+// appended at the back and consumed from the front; the space in front is
+// only reclaimed once it outweighs what is left, so each byte is moved at
+// most about once. Lines end at '\n' and lose a trailing '\r'.
+class LineBuffer {
+ public:
+  void append(const char *data, int size);
+  void append(const QByteArray &bytes);
+
+  // The next complete line, as a view that stays valid until the buffer
+  // is next changed.
+  bool nextLine(QByteArrayView *line);
+  // Every complete line, newlines included, as one block for
+  // splitLine(); a trailing partial line stays behind.
+  QByteArray takeLines();
+  // Whatever has not been consumed, complete or not.
+  QByteArray takeAll();
+
+  bool isEmpty() const;
+  void clear();
+
+  // Cuts the first line off *block, a run of lines as made by takeLines().
+  static bool splitLine(QByteArrayView *block, QByteArrayView *line);
+
+ private:
+  QByteArray m_data;
+  int m_start = 0;
+
+  void compact();
+};
+
+}  // namespace hadak
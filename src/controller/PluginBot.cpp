@@ -0,0 +1,248 @@
+#include "controller/PluginBot.h"
+
+#include <QTimer>
+#include <cstring>
+
+#include "controller/BinaryProtocol.h"
+#include "controller/SimController.h"
+#include "engine/Simulation.h"
+
+namespace hadak {
+
+namespace {
+
+const quint32 kPluginAbi = 2;
+// ABI 2 only added callPayload; plugins built for 1 still load.
+const quint32 kOldestPluginAbi = 1;
+const int kStepDone = 1;
+
+// call() results, as in enum hadak_status and enum hadak_plugin_status.
+enum PluginStatus { Ok = 0, Crash = 1, Pending = 2, Busy = 3, Invalid = 4 };
+
+// Steps that start no movement before yielding to the event loop, so a
+// bot that only ever asks questions cannot freeze the window.
+const int kStepsPerBatch = 64;
+
+}  // namespace
+
+// Mirrors struct hadak_api.
+struct PluginBot::Api {
+  quint32 abi;
+  void *sim;
+  int (*call)(void *, quint16, quint16, qint32, qint32, qint32 *, qint32 *);
+  int (*setText)(void *, qint32, qint32, const char *);
+  int (*lastMove)(void *);
+  void (*log)(void *, const char *);
+  int (*callPayload)(void *, quint16, qint32, qint32, const char *, quint16,
+                     qint32 *, qint32 *);
+};
+
+PluginBot::PluginBot(QObject *parent) : QObject(parent) {}
+
+PluginBot::~PluginBot() {
+  stop();
+  delete m_api;
+  m_library.unload();
+}
+
+bool PluginBot::isPluginCommand(const QString &command) {
+  QString target = command.trimmed();
+  return !target.isEmpty() && !target.contains(' ') &&
+         QLibrary::isLibrary(target);
+}
+
+bool PluginBot::load(const QString &path, QString *error) {
+  stop();
+  m_library.unload();
+  m_library.setFileName(path);
+  if (!m_library.load()) {
+    if (error) {
+      *error = m_library.errorString();
+    }
+    return false;
+  }
+  auto abi = reinterpret_cast<AbiFn>(m_library.resolve("hadak_bot_abi"));
+  m_create = reinterpret_cast<CreateFn>(m_library.resolve("hadak_bot_create"));
+  m_step = reinterpret_cast<StepFn>(m_library.resolve("hadak_bot_step"));
+  m_destroy =
+      reinterpret_cast<DestroyFn>(m_library.resolve("hadak_bot_destroy"));
+  if (!abi || !m_create || !m_step || !m_destroy) {
+    if (error) {
+      *error = "Missing one of hadak_bot_abi, hadak_bot_create, "
+               "hadak_bot_step or hadak_bot_destroy";
+    }
+    m_library.unload();
+    return false;
+  }
+  if (abi() < kOldestPluginAbi || abi() > kPluginAbi) {
+    if (error) {
+      *error = QString("Plugin ABI %1, expected %2").arg(abi()).arg(kPluginAbi);
+    }
+    m_library.unload();
+    return false;
+  }
+
+  if (!m_api) {
+    m_api = new Api();
+  }
+  m_api->abi = kPluginAbi;
+  m_api->sim = this;
+  m_api->call = &PluginBot::apiCall;
+  m_api->setText = &PluginBot::apiSetText;
+  m_api->lastMove = &PluginBot::apiLastMove;
+  m_api->log = &PluginBot::apiLog;
+  m_api->callPayload = &PluginBot::apiCallPayload;
+  return true;
+}
+
+void PluginBot::attach(Simulation *sim, SimController *controller) {
+  m_sim = sim;
+  m_controller = controller;
+  connect(sim, &Simulation::movementFinished, this,
+          [this](int agent, bool crashed) {
+            if (agent != m_controller->agent()) {
+              return;
+            }
+            m_lastMoveCrashed = crashed;
+            if (m_running) {
+              schedule();
+            }
+          });
+  connect(controller, &SimController::pausedChanged, this,
+          [this](bool paused) {
+            if (!paused && m_running) {
+              schedule();
+            }
+          });
+}
+
+void PluginBot::start() {
+  destroyContext();
+  m_context = m_create(m_api);
+  m_running = true;
+  schedule();
+}
+
+void PluginBot::stop() {
+  m_running = false;
+  destroyContext();
+}
+
+bool PluginBot::isRunning() const { return m_running; }
+
+bool PluginBot::step() {
+  if (!m_context) {
+    m_context = m_create(m_api);
+  }
+  m_movedThisStep = false;
+  return m_step(m_context, m_api) != kStepDone;
+}
+
+qint64 PluginBot::calls() const { return m_calls; }
+
+void PluginBot::schedule() {
+  if (m_scheduled) {
+    return;
+  }
+  m_scheduled = true;
+  // Never step from inside the tick that finished the last movement.
+  QTimer::singleShot(0, this, [this]() {
+    m_scheduled = false;
+    runSteps();
+  });
+}
+
+void PluginBot::runSteps() {
+  for (int i = 0; i < kStepsPerBatch; ++i) {
+    if (!m_running || m_controller->isPaused() || m_controller->isWaiting()) {
+      return;
+    }
+    if (!step()) {
+      m_running = false;
+      emit finished();
+      return;
+    }
+  }
+  schedule();
+}
+
+int PluginBot::runCommand(const Command &command, qint32 *value,
+                          qint32 *extra) {
+  bool crashed = false;
+  bool deferred = false;
+  qint32 answer = 0;
+  qint32 second = 0;
+  if (!m_controller->executeDirect(command, &crashed, &answer, &second,
+                                   &deferred)) {
+    return Invalid;
+  }
+  if (value) {
+    *value = answer;
+  }
+  if (extra) {
+    *extra = second;
+  }
+  if (deferred) {
+    m_movedThisStep = true;
+    return Pending;
+  }
+  return crashed ? Crash : Ok;
+}
+
+void PluginBot::destroyContext() {
+  if (m_context && m_destroy) {
+    m_destroy(m_context);
+  }
+  m_context = nullptr;
+}
+
+int PluginBot::apiCall(void *self, quint16 opcode, quint16 aux, qint32 a,
+                       qint32 b, qint32 *value, qint32 *extra) {
+  PluginBot *bot = static_cast<PluginBot *>(self);
+  ++bot->m_calls;
+  if (bot->m_movedThisStep) {
+    return Busy;
+  }
+  // Here aux is never a payload's length: those go through callPayload,
+  // which says where the bytes are.
+  Command command;
+  if (binaryHasPayload(static_cast<CommandId>(opcode)) ||
+      !buildBinaryCommand(opcode, aux, a, b, nullptr, &command)) {
+    return Invalid;
+  }
+  return bot->runCommand(command, value, extra);
+}
+
+int PluginBot::apiCallPayload(void *self, quint16 opcode, qint32 a, qint32 b,
+                              const char *payload, quint16 size,
+                              qint32 *value, qint32 *extra) {
+  PluginBot *bot = static_cast<PluginBot *>(self);
+  ++bot->m_calls;
+  if (bot->m_movedThisStep) {
+    return Busy;
+  }
+  Command command;
+  if (!binaryHasPayload(static_cast<CommandId>(opcode)) ||
+      (size > 0 && !payload) ||
+      !buildBinaryCommand(opcode, size, a, b, payload, &command)) {
+    return Invalid;
+  }
+  return bot->runCommand(command, value, extra);
+}
+
+int PluginBot::apiSetText(void *self, qint32 x, qint32 y, const char *text) {
+  quint16 size =
+      text ? static_cast<quint16>(qMin<size_t>(std::strlen(text), 0xffff)) : 0;
+  return apiCallPayload(self, static_cast<quint16>(CommandId::SetText), x, y,
+                        text, size, nullptr, nullptr);
+}
+
+int PluginBot::apiLastMove(void *self) {
+  return static_cast<PluginBot *>(self)->m_lastMoveCrashed ? Crash : Ok;
+}
+
+void PluginBot::apiLog(void *self, const char *message) {
+  emit static_cast<PluginBot *>(self)->logReceived(QString::fromUtf8(message));
+}
+
+}  // namespace hadak
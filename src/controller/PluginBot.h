@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QLibrary>
+#include <QObject>
+#include <QString>
+
+namespace hadak {
+
+struct Command;
+class SimController;
+class Simulation;
+
+// A bot loaded from a shared library implementing the C ABI in
+// controller/sdk/hadak_plugin.h. It runs inside the simulator: each step
+// calls straight into SimController, so there is no process, pipe or
+// serialisation between the bot and the maze.
+class PluginBot : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit PluginBot(QObject *parent = nullptr);
+  ~PluginBot() override;
+
+  // Whether a bot command names a plugin rather than a program to run.
+  static bool isPluginCommand(const QString &command);
+
+  bool load(const QString &path, QString *error);
+  void attach(Simulation *sim, SimController *controller);
+
+  // Steps from the event loop whenever the mouse is idle and the
+  // controller is not paused, until the bot is done or stop() is called.
+  void start();
+  void stop();
+  bool isRunning() const;
+
+  // Calls hadak_bot_step once. Returns false once the bot is done.
+  // Headless runs drive the bot with this directly.
+  bool step();
+  qint64 calls() const;
+
+ signals:
+  void logReceived(const QString &line);
+  void finished();
+
+ private:
+  struct Api;
+  using AbiFn = quint32 (*)();
+  using CreateFn = void *(*)(const void *);
+  using StepFn = int (*)(void *, const void *);
+  using DestroyFn = void (*)(void *);
+
+  QLibrary m_library;
+  CreateFn m_create = nullptr;
+  StepFn m_step = nullptr;
+  DestroyFn m_destroy = nullptr;
+  Api *m_api = nullptr;
+  void *m_context = nullptr;
+  Simulation *m_sim = nullptr;
+  SimController *m_controller = nullptr;
+  bool m_running = false;
+  bool m_scheduled = false;
+  bool m_movedThisStep = false;
+  bool m_lastMoveCrashed = false;
+  qint64 m_calls = 0;
+
+  void schedule();
+  void runSteps();
+  void destroyContext();
+  int runCommand(const Command &command, qint32 *value, qint32 *extra);
+
+  static int apiCall(void *self, quint16 opcode, quint16 aux, qint32 a,
+                     qint32 b, qint32 *value, qint32 *extra);
+  static int apiCallPayload(void *self, quint16 opcode, qint32 a, qint32 b,
+                            const char *payload, quint16 size, qint32 *value,
+                            qint32 *extra);
+  static int apiSetText(void *self, qint32 x, qint32 y, const char *text);
+  static int apiLastMove(void *self);
+  static void apiLog(void *self, const char *message);
+};
+
+}  // namespace hadak
@@ -0,0 +1,535 @@
+#include "controller/SessionTrace.h"
+
+#include <QElapsedTimer>
+#include <QQueue>
+#include <cstring>
+#include <memory>
+
+#include "controller/BotChannel.h"
+#include "controller/SimController.h"
+#include "engine/Simulation.h"
+
+namespace hadak {
+
+namespace {
+
+const char kTraceMagic[4] = {'H', 'D', 'K', 'T'};
+// Version 2 added the kinematic timing settings to the header.
+const quint8 kTraceVersion = 2;
+const int kHashInterval = 64;
+const int kFlushBytes = 64 * 1024;
+
+void putVarint(QByteArray *out, quint64 value) {
+  while (value >= 0x80) {
+    out->append(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->append(static_cast<char>(value));
+}
+
+bool readVarint(const uchar **cursor, const uchar *end, quint64 *value) {
+  quint64 result = 0;
+  int shift = 0;
+  while (*cursor < end && shift < 64) {
+    uchar byte = *(*cursor)++;
+    result |= static_cast<quint64>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+    shift += 7;
+  }
+  return false;
+}
+
+quint64 zigzag(qint64 value) {
+  return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+qint64 unzigzag(quint64 value) {
+  return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+void putHash(QByteArray *out, quint64 hash) {
+  for (int i = 0; i < 8; ++i) {
+    out->append(static_cast<char>((hash >> (i * 8)) & 0xff));
+  }
+}
+
+bool readHash(const uchar **cursor, const uchar *end, quint64 *hash) {
+  if (end - *cursor < 8) {
+    return false;
+  }
+  quint64 result = 0;
+  for (int i = 0; i < 8; ++i) {
+    result |= static_cast<quint64>((*cursor)[i]) << (i * 8);
+  }
+  *cursor += 8;
+  *hash = result;
+  return true;
+}
+
+// The model's parameters, in declaration order, as raw doubles.
+void putKinematics(QByteArray *out, const KinematicModel &model) {
+  const double values[] = {model.cellLength, model.acceleration,
+                           model.maxSpeed,   model.diagonalSpeed,
+                           model.turn45Time, model.turn90Time};
+  for (double value : values) {
+    quint64 bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putHash(out, bits);
+  }
+}
+
+bool readKinematics(const uchar **cursor, const uchar *end,
+                    KinematicModel *model) {
+  double *values[] = {&model->cellLength, &model->acceleration,
+                      &model->maxSpeed,   &model->diagonalSpeed,
+                      &model->turn45Time, &model->turn90Time};
+  for (double *value : values) {
+    quint64 bits = 0;
+    if (!readHash(cursor, end, &bits)) {
+      return false;
+    }
+    std::memcpy(value, &bits, sizeof(bits));
+  }
+  return true;
+}
+
+quint8 wallNibble(const Maze &maze, int x, int y) {
+  const Cell &c = maze.cell(x, y);
+  return (c.north ? 1 : 0) | (c.east ? 2 : 0) | (c.south ? 4 : 0) |
+         (c.west ? 8 : 0);
+}
+
+class ReplayChannel : public BotChannel {
+ public:
+  void sendLine(const QString &line) override { lines.enqueue(line); }
+
+  QQueue<QString> lines;
+};
+
+}  // namespace
+
+TraceRecorder::~TraceRecorder() {
+  if (isRecording()) {
+    flush(true);
+    m_file.close();
+  }
+}
+
+bool TraceRecorder::begin(const QString &path, const Simulation &sim,
+                          QString *error) {
+  if (isRecording()) {
+    flush(true);
+    m_file.close();
+  }
+  const Maze *maze = sim.maze();
+  if (!maze) {
+    if (error) {
+      *error = "No maze loaded";
+    }
+    return false;
+  }
+  m_file.setFileName(path);
+  if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+    if (error) {
+      *error = "Failed to open trace file";
+    }
+    return false;
+  }
+
+  m_buffer.clear();
+  m_strings.clear();
+  m_lastPos = sim.position();
+  m_ticksSinceHash = 0;
+
+  m_buffer.append(kTraceMagic, sizeof(kTraceMagic));
+  m_buffer.append(static_cast<char>(kTraceVersion));
+  putVarint(&m_buffer, maze->width());
+  putVarint(&m_buffer, maze->height());
+  int cellCount = maze->width() * maze->height();
+  for (int i = 0; i < cellCount; i += 2) {
+    quint8 packed = wallNibble(*maze, i / maze->height(), i % maze->height());
+    if (i + 1 < cellCount) {
+      packed |= wallNibble(*maze, (i + 1) / maze->height(),
+                           (i + 1) % maze->height())
+                << 4;
+    }
+    m_buffer.append(static_cast<char>(packed));
+  }
+  putVarint(&m_buffer, sim.startCell().first);
+  putVarint(&m_buffer, sim.startCell().second);
+  QSet<QPair<int, int>> goals = sim.goalCells();
+  putVarint(&m_buffer, goals.size());
+  for (const auto &goal : goals) {
+    putVarint(&m_buffer, goal.first);
+    putVarint(&m_buffer, goal.second);
+  }
+  putVarint(&m_buffer, m_lastPos.x);
+  putVarint(&m_buffer, m_lastPos.y);
+  putVarint(&m_buffer, static_cast<quint64>(sim.heading()));
+  // Kinematic timing changes the time stats, which the state hash covers.
+  m_buffer.append(static_cast<char>(sim.kinematicEnabled() ? 1 : 0));
+  if (sim.kinematicEnabled()) {
+    putKinematics(&m_buffer, sim.kinematicModel());
+  }
+  return true;
+}
+
+void TraceRecorder::end(const Simulation &sim) {
+  if (!isRecording()) {
+    return;
+  }
+  m_buffer.append(static_cast<char>(TraceRecord::End));
+  putHash(&m_buffer, sim.stateHash());
+  flush(true);
+  m_file.close();
+}
+
+bool TraceRecorder::isRecording() const { return m_file.isOpen(); }
+
+QString TraceRecorder::path() const { return m_file.fileName(); }
+
+void TraceRecorder::recordCommand(const QString &command) {
+  writeString(TraceRecord::Command, command);
+}
+
+void TraceRecorder::recordResponse(const QString &response) {
+  writeString(TraceRecord::Response, response);
+}
+
+void TraceRecorder::recordTick(const Simulation &sim) {
+  if (!isRecording()) {
+    return;
+  }
+  SemiPosition pos = sim.position();
+  quint8 tag = static_cast<quint8>(TraceRecord::Tick) |
+               (static_cast<quint8>(sim.heading()) << 3);
+  m_buffer.append(static_cast<char>(tag));
+  putVarint(&m_buffer, zigzag(pos.x - m_lastPos.x));
+  putVarint(&m_buffer, zigzag(pos.y - m_lastPos.y));
+  m_lastPos = pos;
+  m_ticksSinceHash += 1;
+  if (m_ticksSinceHash >= kHashInterval) {
+    writeHash(sim);
+  }
+  flush(false);
+}
+
+void TraceRecorder::recordPaused(bool paused) {
+  if (!isRecording()) {
+    return;
+  }
+  quint8 tag =
+      static_cast<quint8>(TraceRecord::Paused) | ((paused ? 1 : 0) << 3);
+  m_buffer.append(static_cast<char>(tag));
+}
+
+void TraceRecorder::recordControllerReset() {
+  if (!isRecording()) {
+    return;
+  }
+  m_buffer.append(static_cast<char>(TraceRecord::ControllerReset));
+}
+
+void TraceRecorder::writeString(TraceRecord kind, const QString &text) {
+  if (!isRecording()) {
+    return;
+  }
+  m_buffer.append(static_cast<char>(kind));
+  int id = m_strings.value(text, -1);
+  if (id >= 0) {
+    putVarint(&m_buffer, id);
+  } else {
+    id = m_strings.size();
+    m_strings.insert(text, id);
+    putVarint(&m_buffer, id);
+    QByteArray utf8 = text.toUtf8();
+    putVarint(&m_buffer, utf8.size());
+    m_buffer.append(utf8);
+  }
+  flush(false);
+}
+
+void TraceRecorder::writeHash(const Simulation &sim) {
+  m_buffer.append(static_cast<char>(TraceRecord::Hash));
+  putHash(&m_buffer, sim.stateHash());
+  m_ticksSinceHash = 0;
+}
+
+void TraceRecorder::flush(bool force) {
+  if (!force && m_buffer.size() < kFlushBytes) {
+    return;
+  }
+  m_file.write(m_buffer);
+  m_buffer.clear();
+}
+
+bool TraceReplayer::load(const QString &path, QString *error) {
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly)) {
+    if (error) {
+      *error = "Failed to open file";
+    }
+    return false;
+  }
+  return loadData(file.readAll(), error);
+}
+
+bool TraceReplayer::loadData(const QByteArray &data, QString *error) {
+  auto fail = [error](const QString &message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  m_data = data;
+  const uchar *begin = reinterpret_cast<const uchar *>(m_data.constData());
+  const uchar *end = begin + m_data.size();
+  const uchar *cursor = begin;
+  if (m_data.size() < 5 ||
+      std::memcmp(cursor, kTraceMagic, sizeof(kTraceMagic)) != 0) {
+    return fail("Not a session trace");
+  }
+  cursor += sizeof(kTraceMagic);
+  quint8 version = *cursor++;
+  if (version < 1 || version > kTraceVersion) {
+    return fail("Unsupported trace version");
+  }
+
+  quint64 width = 0;
+  quint64 height = 0;
+  if (!readVarint(&cursor, end, &width) || !readVarint(&cursor, end, &height) ||
+      width == 0 || height == 0 || width > 1024 || height > 1024) {
+    return fail("Invalid maze dimensions");
+  }
+  m_width = static_cast<int>(width);
+  m_height = static_cast<int>(height);
+
+  int cellCount = m_width * m_height;
+  int packedBytes = (cellCount + 1) / 2;
+  if (end - cursor < packedBytes) {
+    return fail("Truncated maze");
+  }
+  m_walls.resize(cellCount);
+  for (int i = 0; i < cellCount; ++i) {
+    quint8 packed = cursor[i / 2];
+    m_walls[i] = (i % 2 == 0) ? (packed & 0x0f) : (packed >> 4);
+  }
+  cursor += packedBytes;
+
+  quint64 values[2];
+  if (!readVarint(&cursor, end, &values[0]) ||
+      !readVarint(&cursor, end, &values[1])) {
+    return fail("Truncated start cell");
+  }
+  m_startCell = {static_cast<int>(values[0]), static_cast<int>(values[1])};
+
+  quint64 goalCount = 0;
+  if (!readVarint(&cursor, end, &goalCount) ||
+      goalCount > static_cast<quint64>(cellCount)) {
+    return fail("Invalid goal cells");
+  }
+  m_goalCells.clear();
+  for (quint64 i = 0; i < goalCount; ++i) {
+    if (!readVarint(&cursor, end, &values[0]) ||
+        !readVarint(&cursor, end, &values[1])) {
+      return fail("Truncated goal cells");
+    }
+    m_goalCells.insert(
+        {static_cast<int>(values[0]), static_cast<int>(values[1])});
+  }
+
+  quint64 heading = 0;
+  if (!readVarint(&cursor, end, &values[0]) ||
+      !readVarint(&cursor, end, &values[1]) ||
+      !readVarint(&cursor, end, &heading) || heading > 7) {
+    return fail("Truncated initial pose");
+  }
+  m_initialPos.x = static_cast<int>(values[0]);
+  m_initialPos.y = static_cast<int>(values[1]);
+  m_initialHeading = static_cast<SemiDirection>(heading);
+
+  m_kinematic = false;
+  m_kinematics = KinematicModel();
+  if (version >= 2) {
+    if (cursor >= end) {
+      return fail("Truncated timing settings");
+    }
+    m_kinematic = *cursor++ != 0;
+    if (m_kinematic && !readKinematics(&cursor, end, &m_kinematics)) {
+      return fail("Truncated kinematic model");
+    }
+  }
+
+  m_bodyOffset = static_cast<int>(cursor - begin);
+  return true;
+}
+
+int TraceReplayer::mazeWidth() const { return m_width; }
+
+int TraceReplayer::mazeHeight() const { return m_height; }
+
+ReplayResult TraceReplayer::run() const {
+  ReplayResult result;
+  if (m_width <= 0 || m_height <= 0) {
+    result.error = "No trace loaded";
+    return result;
+  }
+
+  std::unique_ptr<Maze> maze(new Maze(m_width, m_height));
+  for (int x = 0; x < m_width; ++x) {
+    for (int y = 0; y < m_height; ++y) {
+      quint8 walls = m_walls[x * m_height + y];
+      maze->setWall(x, y, Direction::North, walls & 1);
+      maze->setWall(x, y, Direction::East, walls & 2);
+      maze->setWall(x, y, Direction::South, walls & 4);
+      maze->setWall(x, y, Direction::West, walls & 8);
+    }
+  }
+
+  Simulation sim;
+  sim.setMaze(std::move(maze));
+  if (m_startCell != qMakePair(0, 0)) {
+    sim.setStartCell(m_startCell.first, m_startCell.second);
+  }
+  sim.setGoalCells(m_goalCells);
+  sim.setKinematicModel(m_kinematics);
+  sim.setKinematicEnabled(m_kinematic);
+  sim.reset();
+
+  SemiPosition expectedPos = m_initialPos;
+  if (sim.position().x != expectedPos.x ||
+      sim.position().y != expectedPos.y ||
+      sim.heading() != m_initialHeading) {
+    result.error = "Initial pose does not match the start cell";
+    return result;
+  }
+
+  ReplayChannel channel;
+  SimController controller(&sim);
+  controller.attachBot(&channel);
+
+  QVector<QString> strings;
+  QQueue<QString> expected;
+  const uchar *begin = reinterpret_cast<const uchar *>(m_data.constData());
+  const uchar *end = begin + m_data.size();
+  const uchar *cursor = begin + m_bodyOffset;
+  qint64 record = 0;
+
+  auto fail = [&result, &record](const QString &message) {
+    result.error = QString("Record %1: %2").arg(record).arg(message);
+    return result;
+  };
+
+  auto readString = [&](QString *out) {
+    quint64 id = 0;
+    if (!readVarint(&cursor, end, &id) || id > static_cast<quint64>(strings.size())) {
+      return false;
+    }
+    if (id == static_cast<quint64>(strings.size())) {
+      quint64 length = 0;
+      if (!readVarint(&cursor, end, &length) ||
+          static_cast<quint64>(end - cursor) < length) {
+        return false;
+      }
+      strings.append(QString::fromUtf8(reinterpret_cast<const char *>(cursor),
+                                       static_cast<qsizetype>(length)));
+      cursor += length;
+    }
+    *out = strings.at(static_cast<int>(id));
+    return true;
+  };
+
+  QElapsedTimer timer;
+  timer.start();
+  while (true) {
+    if (cursor >= end) {
+      result.elapsedNs = timer.nsecsElapsed();
+      return fail("Trace ended without an end record");
+    }
+    quint8 tag = *cursor++;
+    TraceRecord kind = static_cast<TraceRecord>(tag & 0x07);
+
+    if (kind == TraceRecord::End) {
+      result.elapsedNs = timer.nsecsElapsed();
+      quint64 hash = 0;
+      if (!readHash(&cursor, end, &hash)) {
+        return fail("Truncated end record");
+      }
+      result.hashesChecked += 1;
+      if (hash != sim.stateHash()) {
+        return fail("Final state hash mismatch");
+      }
+      if (!expected.isEmpty() || !channel.lines.isEmpty()) {
+        return fail(QString("%1 unmatched responses")
+                        .arg(expected.size() + channel.lines.size()));
+      }
+      result.ok = true;
+      return result;
+    }
+
+    if (kind == TraceRecord::Command) {
+      QString command;
+      if (!readString(&command)) {
+        return fail("Truncated command");
+      }
+      result.commands += 1;
+      controller.enqueueCommand(command);
+    } else if (kind == TraceRecord::Response) {
+      QString response;
+      if (!readString(&response)) {
+        return fail("Truncated response");
+      }
+      result.responses += 1;
+      expected.enqueue(response);
+    } else if (kind == TraceRecord::Tick) {
+      quint64 dx = 0;
+      quint64 dy = 0;
+      if (!readVarint(&cursor, end, &dx) || !readVarint(&cursor, end, &dy)) {
+        return fail("Truncated tick");
+      }
+      expectedPos.x += static_cast<int>(unzigzag(dx));
+      expectedPos.y += static_cast<int>(unzigzag(dy));
+      SemiDirection heading = static_cast<SemiDirection>((tag >> 3) & 0x07);
+      sim.advanceOneTick();
+      result.ticks += 1;
+      if (sim.position().x != expectedPos.x ||
+          sim.position().y != expectedPos.y ||
+          sim.heading() != heading) {
+        return fail(QString("Tick %1 diverged").arg(result.ticks));
+      }
+    } else if (kind == TraceRecord::Hash) {
+      quint64 hash = 0;
+      if (!readHash(&cursor, end, &hash)) {
+        return fail("Truncated hash");
+      }
+      result.hashesChecked += 1;
+      if (hash != sim.stateHash()) {
+        return fail(QString("State hash mismatch after tick %1")
+                        .arg(result.ticks));
+      }
+    } else if (kind == TraceRecord::Paused) {
+      controller.setPaused((tag >> 3) & 1);
+    } else if (kind == TraceRecord::ControllerReset) {
+      controller.resetState();
+    } else {
+      return fail("Unknown record type");
+    }
+
+    while (!expected.isEmpty() && !channel.lines.isEmpty()) {
+      QString want = expected.dequeue();
+      QString got = channel.lines.dequeue();
+      if (want != got) {
+        return fail(QString("Expected response '%1', replay sent '%2'")
+                        .arg(want)
+                        .arg(got));
+      }
+    }
+    record += 1;
+  }
+}
+
+}  // namespace hadak
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include "engine/Kinematics.h"
+#include "engine/Mouse.h"
+
+namespace hadak {
+
+class Simulation;
+
+// Binary session trace (.htrace). After a small header holding the maze,
+// start and goal cells and the timing model, the body is a stream of records, each starting with
+// a tag byte whose low 3 bits are the TraceRecord kind. Command and response
+// strings are interned: the first use of a string writes its text, later
+// uses only its index. Tick records hold the zigzag varint position delta
+// and the heading packed into the tag's upper bits.
+enum class TraceRecord : quint8 {
+  End = 0,
+  Command = 1,
+  Response = 2,
+  Tick = 3,
+  Hash = 4,
+  Paused = 5,
+  ControllerReset = 6,
+};
+
+class TraceRecorder {
+ public:
+  TraceRecorder() = default;
+  ~TraceRecorder();
+
+  bool begin(const QString &path, const Simulation &sim, QString *error);
+  void end(const Simulation &sim);
+  bool isRecording() const;
+  QString path() const;
+
+  void recordCommand(const QString &command);
+  void recordResponse(const QString &response);
+  void recordTick(const Simulation &sim);
+  void recordPaused(bool paused);
+  void recordControllerReset();
+
+ private:
+  QFile m_file;
+  QByteArray m_buffer;
+  QHash<QString, int> m_strings;
+  SemiPosition m_lastPos;
+  int m_ticksSinceHash = 0;
+
+  void writeString(TraceRecord kind, const QString &text);
+  void writeHash(const Simulation &sim);
+  void flush(bool force);
+};
+
+struct ReplayResult {
+  bool ok = false;
+  QString error;
+  qint64 commands = 0;
+  qint64 responses = 0;
+  qint64 ticks = 0;
+  qint64 hashesChecked = 0;
+  qint64 elapsedNs = 0;
+};
+
+class TraceReplayer {
+ public:
+  bool load(const QString &path, QString *error);
+  bool loadData(const QByteArray &data, QString *error);
+
+  int mazeWidth() const;
+  int mazeHeight() const;
+
+  ReplayResult run() const;
+
+ private:
+  QByteArray m_data;
+  int m_bodyOffset = 0;
+  int m_width = 0;
+  int m_height = 0;
+  QVector<quint8> m_walls;
+  QPair<int, int> m_startCell = {0, 0};
+  QSet<QPair<int, int>> m_goalCells;
+  SemiPosition m_initialPos;
+  SemiDirection m_initialHeading = SemiDirection::North;
+  bool m_kinematic = false;
+  KinematicModel m_kinematics;
+};
+
+}  // namespace hadak
@@ -0,0 +1,340 @@
+#include "controller/SharedMemoryChannel.h"
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QSocketNotifier>
+#include <QThread>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace hadak {
+
+const char kSharedMemoryEnv[] = "HADAK_SHM";
+
+namespace {
+
+const quint32 kMagic = 0x4b534448u;
+const quint32 kVersion = 1;
+const quint32 kRingSize = 65536;
+
+static_assert(sizeof(std::atomic<quint32>) == sizeof(quint32),
+              "ring counters must be plain 32-bit words in shared memory");
+static_assert(std::atomic<quint32>::is_always_lock_free,
+              "ring counters must be lock-free");
+
+// Mirrors struct hadak_shm_ring: producer and consumer fields each get a
+// cache line.
+struct Ring {
+  std::atomic<quint32> head;
+  std::atomic<quint32> producerSleeping;
+  quint8 producerPad[56];
+  std::atomic<quint32> tail;
+  std::atomic<quint32> consumerSleeping;
+  quint8 consumerPad[56];
+  quint8 data[kRingSize];
+};
+
+static_assert(offsetof(Ring, tail) == 64, "ring layout differs from C SDK");
+static_assert(offsetof(Ring, data) == 128, "ring layout differs from C SDK");
+
+}  // namespace
+
+struct SharedMemoryChannel::Region {
+  quint32 magic;
+  quint32 version;
+  quint32 ringSize;
+  qint32 simEventFd;
+  quint8 pad[48];
+  Ring toSim;
+  Ring toBot;
+};
+
+#ifdef Q_OS_LINUX
+
+namespace {
+
+void wakeFutex(std::atomic<quint32> *word) {
+  syscall(SYS_futex, reinterpret_cast<quint32 *>(word), FUTEX_WAKE, 1,
+          nullptr, nullptr, 0);
+}
+
+QString nextRegionName() {
+  static QAtomicInteger<quint32> counter;
+  return QString("/hadak-%1-%2")
+      .arg(QCoreApplication::applicationPid())
+      .arg(counter.fetchAndAddRelaxed(1));
+}
+
+}  // namespace
+
+SharedMemoryChannel::SharedMemoryChannel(QObject *parent) : QObject(parent) {
+  // Spinning only pays off when the bot has a core of its own.
+  m_spinUs = QThread::idealThreadCount() > 1 ? 20 : 0;
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() { close(); }
+
+bool SharedMemoryChannel::create(QString *error) {
+  close();
+  m_name = nextRegionName();
+  QByteArray name = m_name.toUtf8();
+  int fd = shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    if (error) {
+      *error = QString("shm_open failed: %1").arg(strerror(errno));
+    }
+    return false;
+  }
+  void *mapped = MAP_FAILED;
+  if (ftruncate(fd, sizeof(Region)) == 0) {
+    mapped = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0);
+  }
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    if (error) {
+      *error = QString("Unable to map shared memory: %1").arg(strerror(errno));
+    }
+    shm_unlink(name.constData());
+    return false;
+  }
+  // Non-blocking for our own reads; close-on-exec so only the bot it was
+  // made for inherits it (BotProcess clears the flag in that child).
+  m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_eventFd < 0) {
+    if (error) {
+      *error = QString("eventfd failed: %1").arg(strerror(errno));
+    }
+    munmap(mapped, sizeof(Region));
+    shm_unlink(name.constData());
+    return false;
+  }
+
+  // ftruncate zero-fills, so both rings start empty and awake.
+  m_region = static_cast<Region *>(mapped);
+  m_region->ringSize = kRingSize;
+  m_region->simEventFd = m_eventFd;
+  m_region->version = kVersion;
+  m_region->toSim.consumerSleeping.store(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  m_region->magic = kMagic;
+
+  m_notifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
+  connect(m_notifier, &QSocketNotifier::activated, this,
+          &SharedMemoryChannel::poll);
+  return true;
+}
+
+void SharedMemoryChannel::close() {
+  if (m_notifier) {
+    m_notifier->setEnabled(false);
+    m_notifier->deleteLater();
+    m_notifier = nullptr;
+  }
+  if (m_region) {
+    munmap(m_region, sizeof(Region));
+    m_region = nullptr;
+    shm_unlink(m_name.toUtf8().constData());
+  }
+  if (m_eventFd >= 0) {
+    ::close(m_eventFd);
+    m_eventFd = -1;
+  }
+  m_pending.clear();
+  m_paused = false;
+}
+
+void SharedMemoryChannel::write(const QByteArray &bytes) {
+  if (!m_region) {
+    return;
+  }
+  if (!m_pending.isEmpty()) {
+    m_pending.append(bytes);
+    flushPending();
+    return;
+  }
+  int written = writeRing(bytes.constData(), bytes.size());
+  if (written < bytes.size()) {
+    m_pending = bytes.mid(written);
+    flushPending();
+  }
+}
+
+void SharedMemoryChannel::poll() {
+  if (!m_region) {
+    return;
+  }
+  quint64 count = 0;
+  while (read(m_eventFd, &count, sizeof(count)) > 0) {
+  }
+  Ring &ring = m_region->toSim;
+  // Paused, we are not asleep either: the bot has no reason to signal
+  // until setPaused(false) comes back for its ring.
+  ring.consumerSleeping.store(0, std::memory_order_relaxed);
+  QElapsedTimer spin;
+  spin.start();
+  while (m_region) {
+    flushPending();
+    if (m_paused) {
+      break;
+    }
+    if (readAvailable()) {
+      spin.restart();
+      continue;
+    }
+    if (spin.nsecsElapsed() < m_spinUs * 1000LL) {
+      continue;
+    }
+    // Publish that we are going to sleep, then look once more so a write
+    // that raced with the flag is not left waiting for a wakeup.
+    ring.consumerSleeping.store(1, std::memory_order_seq_cst);
+    if (ring.head.load(std::memory_order_seq_cst) ==
+        ring.tail.load(std::memory_order_relaxed)) {
+      break;
+    }
+    ring.consumerSleeping.store(0, std::memory_order_relaxed);
+  }
+}
+
+void SharedMemoryChannel::setPaused(bool paused) {
+  if (m_paused == paused) {
+    return;
+  }
+  m_paused = paused;
+  if (!m_paused) {
+    // Not in place: the caller may be inside our received() signal.
+    QMetaObject::invokeMethod(this, [this]() { poll(); },
+                              Qt::QueuedConnection);
+  }
+}
+
+void SharedMemoryChannel::inheritInChild(int fd) {
+  fcntl(fd, F_SETFD, 0);
+}
+
+bool SharedMemoryChannel::readAvailable() {
+  Ring &ring = m_region->toSim;
+  quint32 tail = ring.tail.load(std::memory_order_relaxed);
+  quint32 head = ring.head.load(std::memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+  quint32 size = head - tail;
+  quint32 offset = tail & (kRingSize - 1);
+  quint32 first = qMin(size, kRingSize - offset);
+  QByteArray bytes(reinterpret_cast<const char *>(ring.data) + offset,
+                   static_cast<int>(first));
+  bytes.append(reinterpret_cast<const char *>(ring.data),
+               static_cast<int>(size - first));
+  ring.tail.store(head, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring.producerSleeping.load(std::memory_order_relaxed)) {
+    wakeFutex(&ring.tail);
+  }
+  // A handler may close the channel; poll() checks m_region afterwards.
+  emit received(bytes);
+  return true;
+}
+
+int SharedMemoryChannel::writeRing(const char *data, int size) {
+  Ring &ring = m_region->toBot;
+  quint32 head = ring.head.load(std::memory_order_relaxed);
+  quint32 tail = ring.tail.load(std::memory_order_acquire);
+  quint32 count = qMin(kRingSize - (head - tail), static_cast<quint32>(size));
+  if (count == 0) {
+    return 0;
+  }
+  quint32 offset = head & (kRingSize - 1);
+  quint32 first = qMin(count, kRingSize - offset);
+  std::memcpy(ring.data + offset, data, first);
+  std::memcpy(ring.data, data + first, count - first);
+  ring.head.store(head + count, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring.consumerSleeping.load(std::memory_order_relaxed)) {
+    wakeFutex(&ring.head);
+  }
+  return static_cast<int>(count);
+}
+
+void SharedMemoryChannel::flushPending() {
+  if (!m_region) {
+    return;
+  }
+  // Whatever does not fit waits here; with producerSleeping set, the bot
+  // signals the eventfd once it has freed space.
+  Ring &ring = m_region->toBot;
+  while (!m_pending.isEmpty()) {
+    ring.producerSleeping.store(0, std::memory_order_relaxed);
+    int written = writeRing(m_pending.constData(), m_pending.size());
+    m_pending.remove(0, written);
+    if (written > 0 || m_pending.isEmpty()) {
+      continue;
+    }
+    // Still full after publishing the flag: the bot's next read wakes us.
+    ring.producerSleeping.store(1, std::memory_order_seq_cst);
+    quint32 head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_seq_cst) == kRingSize) {
+      break;
+    }
+  }
+}
+
+#else
+
+SharedMemoryChannel::SharedMemoryChannel(QObject *parent) : QObject(parent) {}
+
+SharedMemoryChannel::~SharedMemoryChannel() = default;
+
+bool SharedMemoryChannel::create(QString *error) {
+  if (error) {
+    *error = "The shared-memory transport needs Linux";
+  }
+  return false;
+}
+
+void SharedMemoryChannel::close() {}
+
+void SharedMemoryChannel::write(const QByteArray &bytes) { Q_UNUSED(bytes); }
+
+void SharedMemoryChannel::poll() {}
+
+void SharedMemoryChannel::setPaused(bool paused) { Q_UNUSED(paused); }
+
+void SharedMemoryChannel::inheritInChild(int fd) { Q_UNUSED(fd); }
+
+bool SharedMemoryChannel::readAvailable() { return false; }
+
+int SharedMemoryChannel::writeRing(const char *data, int size) {
+  Q_UNUSED(data);
+  Q_UNUSED(size);
+  return 0;
+}
+
+void SharedMemoryChannel::flushPending() {}
+
+#endif
+
+bool SharedMemoryChannel::isOpen() const { return m_region != nullptr; }
+
+QString SharedMemoryChannel::name() const { return m_name; }
+
+int SharedMemoryChannel::eventFd() const { return m_eventFd; }
+
+void SharedMemoryChannel::setSpinTime(int microseconds) {
+  m_spinUs = microseconds;
+}
+
+}  // namespace hadak
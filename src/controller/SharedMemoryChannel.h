@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+namespace hadak {
+
+extern const char kSharedMemoryEnv[];
+
+// The simulator's end of the shared-memory transport: a POSIX shm region
+// with one SPSC byte ring each way, carrying the same bytes as the bot's
+// stdin/stdout. The layout and wakeup rules are shared with
+// controller/sdk/hadak_shm.h. Linux only; create() fails elsewhere.
+class SharedMemoryChannel : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SharedMemoryChannel(QObject *parent = nullptr);
+  ~SharedMemoryChannel() override;
+
+  bool create(QString *error);
+  void close();
+  bool isOpen() const;
+  // The shm name the bot opens, and the eventfd it must inherit.
+  QString name() const;
+  int eventFd() const;
+
+  // How long poll() keeps spinning for more input before going back to the
+  // event loop; spinning lets a fast bot's next command skip the eventfd.
+  void setSpinTime(int microseconds);
+
+  // Clears close-on-exec on the eventfd; meant for QProcess's child
+  // process modifier, so it only touches async-signal-safe calls.
+  static void inheritInChild(int fd);
+
+  void write(const QByteArray &bytes);
+  // Drains the bot's ring. The eventfd notifier calls it on every wakeup.
+  void poll();
+  // While paused the bot's ring is left alone, so the bot blocks once it
+  // is full; replies still go out.
+  void setPaused(bool paused);
+
+ signals:
+  void received(const QByteArray &bytes);
+
+ private:
+  struct Region;
+
+  Region *m_region = nullptr;
+  int m_eventFd = -1;
+  QString m_name;
+  QSocketNotifier *m_notifier = nullptr;
+  QByteArray m_pending;
+  int m_spinUs = 20;
+  bool m_paused = false;
+
+  bool readAvailable();
+  int writeRing(const char *data, int size);
+  void flushPending();
+};
+
+}  // namespace hadak
@@ -1,19 +1,120 @@
 #include "controller/SimController.h"
 
+#include <QAbstractEventDispatcher>
 #include <algorithm>
+#include <cstring>
+
+#include "controller/BinaryProtocol.h"
+#include "controller/CommandParser.h"
+#include "controller/SessionTrace.h"
 
 namespace hadak {
 
+namespace {
+
+// Queued requests at which the bot is paused, and at which it resumes.
+const int kQueueHighWater = 1024;
+const int kQueueLowWater = 256;
+// Overlay redraws are coalesced to one per frame at this rate.
+const int kOverlayFrameMs = 16;
+
+bool isOverlay(CommandId id) {
+  switch (id) {
+    case CommandId::SetColor:
+    case CommandId::ClearColor:
+    case CommandId::ClearAllColor:
+    case CommandId::SetText:
+    case CommandId::ClearText:
+    case CommandId::ClearAllText:
+    case CommandId::SetColorGrid:
+    case CommandId::SetTextGrid:
+    case CommandId::SetColorRect:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Half-steps a moveForward or moveForwardHalf asks for. No run gets
+// further than the maze's longest side without crashing, so a longer
+// count is cut to that, which crashes in the same place and cannot
+// overflow.
+int runHalfSteps(const Command &command, const Maze *maze) {
+  int count = command.argCount > 0 ? command.args[0] : 1;
+  int span = maze ? qMax(maze->width(), maze->height()) : 1;
+  if (command.id == CommandId::MoveForward) {
+    return qMin(count, span) * 2;
+  }
+  return qMin(count, span * 2);
+}
+
+bool isMovement(CommandId id) {
+  switch (id) {
+    case CommandId::MoveForward:
+    case CommandId::MoveForwardHalf:
+    case CommandId::TurnRight:
+    case CommandId::TurnLeft:
+    case CommandId::TurnRight45:
+    case CommandId::TurnLeft45:
+    case CommandId::RunPath:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Headings in push-mode answers, indexed by SemiDirection.
+const char *const kHeadingNames[] = {"e", "ne", "n", "nw",
+                                     "w", "sw", "s", "se"};
+
+bool isHandshake(QByteArrayView line) {
+  const int size = sizeof(kBinaryHandshake) - 1;
+  return line.size() == size &&
+         std::memcmp(line.data(), kBinaryHandshake, size) == 0;
+}
+
+}  // namespace
+
 SimController::SimController(Simulation *sim, QObject *parent)
     : QObject(parent), m_sim(sim) {
   connect(m_sim, &Simulation::movementFinished, this,
           &SimController::onMovementFinished);
+  m_overlayTimer.setSingleShot(true);
+  m_overlayTimer.setInterval(kOverlayFrameMs);
+  connect(&m_overlayTimer, &QTimer::timeout, this,
+          [this]() { m_sim->releaseOverlayUpdates(); });
 }
 
-void SimController::attachBot(BotProcess *bot) { m_bot = bot; }
+SimController::~SimController() { releaseOverlayUpdates(); }
+
+void SimController::attachBot(BotChannel *bot) {
+  if (bot != m_bot) {
+    setThrottled(false);
+  }
+  m_bot = bot;
+}
+
+void SimController::setAgent(int agent) { m_agent = agent; }
+
+int SimController::agent() const { return m_agent; }
+
+void SimController::setRecorder(TraceRecorder *recorder) {
+  m_recorder = recorder;
+  if (m_recorder) {
+    m_recorder->recordPaused(m_paused);
+  }
+}
+
+void SimController::setProfiler(LatencyProfiler *profiler) {
+  m_profiler = profiler;
+}
 
 void SimController::setPaused(bool paused) {
   m_paused = paused;
+  if (m_recorder) {
+    m_recorder->recordPaused(m_paused);
+  }
+  emit pausedChanged(m_paused);
   if (!m_paused) {
     processQueue();
   }
@@ -23,375 +124,624 @@ bool SimController::isPaused() const { return m_paused; }
 
 void SimController::resetState() {
   m_queue.clear();
+  m_path.clear();
+  setThrottled(false);
   m_waitingResponse = false;
+  m_binary = false;
+  m_pushSense = false;
+  releaseOverlayUpdates();
+  if (m_recorder) {
+    m_recorder->recordControllerReset();
+  }
+  if (m_profiler) {
+    m_profiler->startRun();
+  }
 }
 
 void SimController::enqueueCommand(const QString &command) {
-  m_queue.enqueue(command.trimmed());
+  enqueueLine(command.toUtf8());
+}
+
+void SimController::enqueueLine(QByteArrayView line) {
+  line = line.trimmed();
+  if (m_recorder && !isHandshake(line)) {
+    m_recorder->recordCommand(QString::fromUtf8(line));
+  }
+  LatencyProfiler::Sample sample = receive();
+  if (m_queue.isEmpty() && !m_paused && !m_waitingResponse && m_bot) {
+    dispatch(line, sample);
+    return;
+  }
+  m_queue.enqueue(Request{line.toByteArray(), sample});
+  if (m_queue.size() >= kQueueHighWater) {
+    setThrottled(true);
+  }
   processQueue();
 }
 
+void SimController::enqueueFrame(const QByteArray &frame) {
+  if (m_recorder) {
+    // Traces hold the text form so they replay over either protocol.
+    Command command;
+    if (decodeBinaryRequest(frame.constData(), frame.size(), &command)) {
+      m_recorder->recordCommand(commandText(command));
+    }
+  }
+  m_queue.enqueue(Request{frame, receive()});
+  if (m_queue.size() >= kQueueHighWater) {
+    setThrottled(true);
+  }
+  processQueue();
+}
+
+bool SimController::isBinary() const { return m_binary; }
+
+bool SimController::isWaiting() const { return m_waitingResponse; }
+
+int SimController::queueDepth() const { return m_queue.size(); }
+
+bool SimController::isThrottled() const { return m_throttled; }
+
+bool SimController::executeDirect(const Command &command, bool *crashed,
+                                  qint32 *value, qint32 *extra,
+                                  bool *deferred) {
+  if (m_recorder) {
+    m_recorder->recordCommand(commandText(command));
+  }
+  Reply reply;
+  *deferred = false;
+  if (m_waitingResponse || command.id == CommandId::RunPath ||
+      !execute(command, &reply, deferred)) {
+    handleInvalid(commandText(command).toUtf8());
+    return false;
+  }
+  if (*deferred) {
+    m_pending = command.id;
+    m_pendingSample = LatencyProfiler::Sample();
+    m_waitingResponse = true;
+  }
+  if (m_recorder && reply.kind != Reply::None) {
+    m_recorder->recordResponse(formatReply(reply));
+  }
+  *crashed = reply.kind == Reply::Crash;
+  *value = replyValue(reply);
+  *extra = reply.extra;
+  return true;
+}
+
 void SimController::processQueue() {
   if (m_paused || m_waitingResponse || !m_bot) {
     return;
   }
 
   while (!m_queue.isEmpty() && !m_waitingResponse) {
-    QString command = m_queue.dequeue();
-    if (command.isEmpty()) {
-      continue;
-    }
-    QString response;
-    bool defer = false;
-    bool ok = processCommand(command, &response, &defer);
-    if (!ok) {
-      handleInvalid(command);
-      continue;
-    }
-    if (defer) {
-      m_waitingResponse = true;
-      break;
-    }
-    if (!response.isEmpty()) {
-      sendResponse(response);
-    }
+    Request request = m_queue.dequeue();
+    dispatch(request.bytes, request.sample);
+  }
+  if (m_queue.size() <= kQueueLowWater) {
+    setThrottled(false);
   }
 }
 
-void SimController::sendResponse(const QString &response) {
-  if (!m_bot) {
+void SimController::setThrottled(bool throttled) {
+  if (m_throttled == throttled) {
     return;
   }
-  m_bot->sendLine(response);
-}
-
-void SimController::handleInvalid(const QString &command) {
-  emit logMessage(QString("Invalid command: %1").arg(command));
+  m_throttled = throttled;
+  if (m_bot) {
+    m_bot->setReadPaused(m_throttled);
+  }
+  emit throttledChanged(m_throttled);
 }
 
-void SimController::onMovementFinished(bool crashed) {
-  if (!m_waitingResponse) {
+void SimController::holdOverlayUpdates() {
+  // The first overlay write of a frame holds the redraw and the frame
+  // timer releases it. Without an event loop nothing would, nor redraw.
+  if (m_overlayTimer.isActive() || !QAbstractEventDispatcher::instance()) {
     return;
   }
-  m_waitingResponse = false;
-  sendResponse(crashed ? "crash" : "ack");
-  processQueue();
+  m_sim->holdOverlayUpdates();
+  m_overlayTimer.start();
 }
 
-bool SimController::processCommand(const QString &command, QString *response,
-                                   bool *defer) {
-  QStringList tokens = command.split(" ", Qt::SkipEmptyParts);
-  if (tokens.isEmpty()) {
-    return false;
+void SimController::releaseOverlayUpdates() {
+  if (m_overlayTimer.isActive()) {
+    m_overlayTimer.stop();
+    m_sim->releaseOverlayUpdates();
   }
+}
 
-  QString fn = tokens.at(0);
-  if (tokens.size() > 2 && fn != "setText") {
-    return false;
+LatencyProfiler::Sample SimController::receive() {
+  if (!m_profiler) {
+    return LatencyProfiler::Sample();
   }
+  qint64 received = m_bot ? m_bot->receivedAt() : 0;
+  return m_profiler->received(received > 0 ? received
+                                           : LatencyProfiler::now());
+}
 
-  if (fn == "mazeWidth") {
-    *response = QString::number(m_sim->maze()->width());
-    return true;
-  }
-  if (fn == "mazeHeight") {
-    *response = QString::number(m_sim->maze()->height());
-    return true;
+void SimController::dispatch(QByteArrayView request,
+                             LatencyProfiler::Sample sample) {
+  if (request.isEmpty()) {
+    return;
   }
-
-  if (fn == "goalCount") {
-    *response = QString::number(m_sim->goalCells().size());
-    return true;
+  if (m_profiler) {
+    m_profiler->dispatched(&sample);
   }
-  if (fn == "goalCell") {
-    if (tokens.size() != 2) {
-      return false;
+  Command command;
+  if (m_binary) {
+    if (!decodeBinaryRequest(request.data(), static_cast<int>(request.size()),
+                             &command)) {
+      handleInvalid(request.toByteArray().toHex(' '));
+      return;
     }
-    bool okIndex = false;
-    int index = tokens.at(1).toInt(&okIndex);
-    if (!okIndex) {
-      return false;
+  } else {
+    if (isHandshake(request)) {
+      switchToBinary();
+      return;
     }
-    QList<QPair<int, int>> goals = m_sim->goalCells().values();
-    std::sort(goals.begin(), goals.end(),
-              [](const QPair<int, int> &a, const QPair<int, int> &b) {
-                if (a.second == b.second) {
-                  return a.first < b.first;
-                }
-                return a.second < b.second;
-              });
-    if (index < 0 || index >= goals.size()) {
-      return false;
+    CommandLine line;
+    if (!parseCommandLine(request.data(), static_cast<int>(request.size()),
+                          &line) ||
+        !buildCommand(line, &command)) {
+      handleInvalid(request.toByteArray());
+      return;
     }
-    const auto &cell = goals.at(index);
-    *response = QString("%1 %2").arg(cell.first).arg(cell.second);
-    return true;
   }
-  if (fn == "isGoal") {
-    QPair<int, int> cell = m_sim->mouse().position().toCell();
-    *response = m_sim->goalCells().contains(cell) ? "true" : "false";
-    return true;
+
+  Reply reply;
+  bool defer = false;
+  if (!execute(command, &reply, &defer)) {
+    handleInvalid(m_binary ? request.toByteArray().toHex(' ')
+                           : request.toByteArray());
+    return;
+  }
+  if (defer) {
+    m_pending = command.id;
+    m_pendingSample = sample;
+    m_waitingResponse = true;
+    return;
+  }
+  if (reply.kind != Reply::None) {
+    sendReply(command.id, reply);
   }
+  if (m_profiler) {
+    m_profiler->finished(command.id, sample, reply.kind != Reply::None);
+  }
+}
 
-  auto parseHalfSteps = [&](int defaultValue) -> int {
-    if (tokens.size() == 2) {
-      return tokens.at(1).toInt();
-    }
-    return defaultValue;
-  };
+void SimController::switchToBinary() {
+  if (!m_bot->setBinaryMode(true)) {
+    m_bot->sendLine("no binary");
+    return;
+  }
+  m_binary = true;
+  m_bot->sendLine(kBinaryHandshakeReply);
+  emit logMessage("Bot switched to the binary protocol");
+}
 
-  if (fn == "wallFront") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallFront(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallRight") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallRight(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallLeft") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallLeft(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallBack") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallBack(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallFrontRight") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallFrontRight(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallFrontLeft") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallFrontLeft(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallBackRight") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallBackRight(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-  if (fn == "wallBackLeft") {
-    int halfStepsAway = parseHalfSteps(1);
-    int halfStepsAhead = halfStepsAway - 1;
-    *response = m_sim->isWallBackLeft(halfStepsAhead) ? "true" : "false";
-    return true;
-  }
-
-  if (fn == "moveForward") {
-    int distance = parseHalfSteps(1);
-    int numHalfSteps = distance * 2;
-    bool ok = m_sim->requestMove(numHalfSteps);
-    if (!ok) {
-      *response = "crash";
-      return true;
-    }
-    *defer = true;
-    return true;
+void SimController::sendReply(CommandId id, Reply reply) {
+  if (!m_bot) {
+    return;
   }
-  if (fn == "moveForwardHalf") {
-    int numHalfSteps = parseHalfSteps(1);
-    bool ok = m_sim->requestMove(numHalfSteps);
-    if (!ok) {
-      *response = "crash";
-      return true;
+  reply.pose = m_pushSense && isMovement(id);
+  if (!m_binary) {
+    sendResponse(formatReply(reply));
+    return;
+  }
+  if (m_recorder) {
+    m_recorder->recordResponse(formatReply(reply));
+  }
+  bool crashed = reply.kind == Reply::Crash ||
+                 (reply.kind == Reply::Path && reply.value >= 0);
+  BinaryStatus status = crashed ? BinaryStatus::Crash : BinaryStatus::Ok;
+  qint32 extra = reply.extra;
+  if (reply.pose) {
+    QPair<int, int> cell = m_sim->position(m_agent).toCell();
+    extra = packBinaryCell(cell.first, cell.second);
+  }
+  m_bot->sendFrame(encodeBinaryResponse(id, status, replyValue(reply), extra));
+}
+
+int SimController::senseMask(int ahead) const {
+  int mask = 0;
+  mask |= m_sim->isWallFront(ahead, m_agent) ? SenseFront : 0;
+  mask |= m_sim->isWallLeft(ahead, m_agent) ? SenseLeft : 0;
+  mask |= m_sim->isWallRight(ahead, m_agent) ? SenseRight : 0;
+  mask |= m_sim->isWallBack(ahead, m_agent) ? SenseBack : 0;
+  mask |= m_sim->isWallFrontLeft(ahead, m_agent) ? SenseFrontLeft : 0;
+  mask |= m_sim->isWallFrontRight(ahead, m_agent) ? SenseFrontRight : 0;
+  mask |= m_sim->isWallBackLeft(ahead, m_agent) ? SenseBackLeft : 0;
+  mask |= m_sim->isWallBackRight(ahead, m_agent) ? SenseBackRight : 0;
+  if (m_sim->goalCells().contains(m_sim->position(m_agent).toCell())) {
+    mask |= SenseGoal;
+  }
+  mask |= m_sim->wasReset(m_agent) ? SenseReset : 0;
+  return mask;
+}
+
+qint32 SimController::replyValue(const Reply &reply) const {
+  qint32 value = reply.value;
+  if (reply.pose) {
+    // The crashed step of a runPath moves up to make room for the pose.
+    int step = reply.kind == Reply::Path ? std::max(reply.value, 0) : 0;
+    return senseMask(0) | static_cast<int>(m_sim->heading(m_agent)) << 12 |
+           step << 16;
+  }
+  if (reply.kind == Reply::Stat) {
+    const Stats &stats = m_sim->stats(m_agent);
+    StatId stat = static_cast<StatId>(reply.value);
+    float number = stats.statString(stat).isEmpty() ? -1.0f
+                                                    : stats.statValue(stat);
+    std::memcpy(&value, &number, sizeof(value));
+  }
+  return value;
+}
+
+QString SimController::formatReply(const Reply &reply) const {
+  if (reply.pose) {
+    Reply answer = reply;
+    answer.pose = false;
+    QPair<int, int> cell = m_sim->position(m_agent).toCell();
+    return QString("%1 %2 %3 %4 %5")
+        .arg(formatReply(answer))
+        .arg(senseMask(0))
+        .arg(cell.first)
+        .arg(cell.second)
+        .arg(kHeadingNames[static_cast<int>(m_sim->heading(m_agent))]);
+  }
+  switch (reply.kind) {
+    case Reply::Bool:
+      return reply.value ? QStringLiteral("true") : QStringLiteral("false");
+    case Reply::Number:
+      return QString::number(reply.value);
+    case Reply::Cell:
+      return QString("%1 %2").arg(reply.value).arg(reply.extra);
+    case Reply::Stat: {
+      QString value =
+          m_sim->stats(m_agent).statString(static_cast<StatId>(reply.value));
+      return value.isEmpty() ? QStringLiteral("-1") : value;
     }
-    *defer = true;
-    return true;
+    case Reply::Ack:
+      return QStringLiteral("ack");
+    case Reply::Crash:
+      return QStringLiteral("crash");
+    case Reply::Path:
+      return reply.value < 0 ? QStringLiteral("ack")
+                             : QString("crash %1").arg(reply.value);
+    case Reply::Heading:
+      return reply.value < 0
+                 ? QStringLiteral("none")
+                 : QString(directionToChar(static_cast<Direction>(reply.value)));
+    case Reply::None:
+      break;
   }
+  return QString();
+}
+
+void SimController::sendResponse(const QString &response) {
+  if (!m_bot) {
+    return;
+  }
+  if (m_recorder) {
+    m_recorder->recordResponse(response);
+  }
+  m_bot->sendLine(response);
+}
+
+void SimController::handleInvalid(const QByteArray &command) {
+  emit logMessage(QString("Invalid command: %1").arg(QString::fromUtf8(command)));
+}
 
-  if (fn == "turnRight" || fn == "turnRight90") {
-    m_sim->requestTurn(Movement::TurnRight90);
-    *defer = true;
-    return true;
+void SimController::onMovementFinished(int agent, bool crashed) {
+  if (agent != m_agent || !m_waitingResponse) {
+    return;
   }
-  if (fn == "turnLeft" || fn == "turnLeft90") {
-    m_sim->requestTurn(Movement::TurnLeft90);
-    *defer = true;
-    return true;
+  Reply reply;
+  if (m_pending == CommandId::RunPath) {
+    if (advancePath(&reply)) {
+      return;
+    }
+  } else {
+    reply.kind = crashed ? Reply::Crash : Reply::Ack;
   }
-  if (fn == "turnRight45") {
-    m_sim->requestTurn(Movement::TurnRight45);
-    *defer = true;
-    return true;
+  m_waitingResponse = false;
+  if (!m_bot && m_recorder) {
+    // An in-process bot learns the outcome from movementFinished itself.
+    m_recorder->recordResponse(formatReply(reply));
   }
-  if (fn == "turnLeft45") {
-    m_sim->requestTurn(Movement::TurnLeft45);
-    *defer = true;
-    return true;
+  sendReply(m_pending, reply);
+  if (m_profiler && m_bot) {
+    m_profiler->finished(m_pending, m_pendingSample, true);
   }
+  processQueue();
+}
 
-  if (fn == "setWall" || fn == "clearWall") {
-    if (tokens.size() != 4) {
-      return false;
-    }
-    bool okX = false;
-    bool okY = false;
-    int x = tokens.at(1).toInt(&okX);
-    int y = tokens.at(2).toInt(&okY);
-    if (!okX || !okY || tokens.at(3).size() != 1) {
-      return false;
-    }
-    Direction dir;
-    if (!directionFromChar(tokens.at(3).at(0), &dir)) {
-      return false;
-    }
-    m_sim->setKnownWall(x, y, dir,
-                        fn == "setWall" ? WallState::Wall : WallState::Open);
-    int nx = x;
-    int ny = y;
-    if (dir == Direction::North) {
-      ny += 1;
-    } else if (dir == Direction::East) {
-      nx += 1;
-    } else if (dir == Direction::South) {
-      ny -= 1;
-    } else if (dir == Direction::West) {
-      nx -= 1;
-    }
-    Direction opposite = rotateLeft(rotateLeft(dir));
-    if (m_sim->maze() && m_sim->maze()->inBounds(nx, ny)) {
-      m_sim->setKnownWall(nx, ny, opposite,
-                          fn == "setWall" ? WallState::Wall : WallState::Open);
-    }
-    return true;
+bool SimController::execute(const Command &command, Reply *reply,
+                            bool *defer) {
+  auto boolReply = [&](bool value) {
+    reply->kind = Reply::Bool;
+    reply->value = value ? 1 : 0;
+  };
+  auto numberReply = [&](int value) {
+    reply->kind = Reply::Number;
+    reply->value = value;
+  };
+  int halfSteps = command.argCount > 0 ? command.args[0] : 1;
+  int x = command.args[0];
+  int y = command.args[1];
+  if (isOverlay(command.id)) {
+    holdOverlayUpdates();
   }
 
-  if (fn == "setColor") {
-    if (tokens.size() != 4 || tokens.at(3).size() != 1) {
-      return false;
+  switch (command.id) {
+    case CommandId::MazeWidth:
+      numberReply(m_sim->maze()->width());
+      return true;
+    case CommandId::MazeHeight:
+      numberReply(m_sim->maze()->height());
+      return true;
+    case CommandId::GoalCount:
+      numberReply(m_sim->goalCells().size());
+      return true;
+    case CommandId::GoalCell: {
+      QList<QPair<int, int>> goals = m_sim->goalCells().values();
+      std::sort(goals.begin(), goals.end(),
+                [](const QPair<int, int> &a, const QPair<int, int> &b) {
+                  if (a.second == b.second) {
+                    return a.first < b.first;
+                  }
+                  return a.second < b.second;
+                });
+      int index = command.args[0];
+      if (index < 0 || index >= goals.size()) {
+        return false;
+      }
+      reply->kind = Reply::Cell;
+      reply->value = goals.at(index).first;
+      reply->extra = goals.at(index).second;
+      return true;
     }
-    bool okX = false;
-    bool okY = false;
-    int x = tokens.at(1).toInt(&okX);
-    int y = tokens.at(2).toInt(&okY);
-    if (!okX || !okY) {
-      return false;
+    case CommandId::IsGoal:
+      boolReply(m_sim->goalCells().contains(m_sim->position(m_agent).toCell()));
+      return true;
+
+    case CommandId::WallFront:
+      boolReply(m_sim->isWallFront(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallRight:
+      boolReply(m_sim->isWallRight(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallLeft:
+      boolReply(m_sim->isWallLeft(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallBack:
+      boolReply(m_sim->isWallBack(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallFrontRight:
+      boolReply(m_sim->isWallFrontRight(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallFrontLeft:
+      boolReply(m_sim->isWallFrontLeft(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallBackRight:
+      boolReply(m_sim->isWallBackRight(halfSteps - 1, m_agent));
+      return true;
+    case CommandId::WallBackLeft:
+      boolReply(m_sim->isWallBackLeft(halfSteps - 1, m_agent));
+      return true;
+
+    case CommandId::Sense:
+      numberReply(senseMask(halfSteps - 1));
+      return true;
+    case CommandId::PushSense:
+      m_pushSense = command.args[0] != 0;
+      boolReply(m_pushSense);
+      return true;
+
+    case CommandId::MoveForward:
+    case CommandId::MoveForwardHalf: {
+      int numHalfSteps = runHalfSteps(command, m_sim->maze());
+      if (!m_sim->requestMove(numHalfSteps, m_agent)) {
+        reply->kind = Reply::Crash;
+        return true;
+      }
+      *defer = true;
+      return true;
     }
-    m_sim->setCellColor(x, y, tokens.at(3).at(0));
-    return true;
-  }
 
-  if (fn == "clearColor") {
-    if (tokens.size() != 3) {
-      return false;
+    case CommandId::TurnRight:
+      m_sim->requestTurn(Movement::TurnRight90, m_agent);
+      *defer = true;
+      return true;
+    case CommandId::TurnLeft:
+      m_sim->requestTurn(Movement::TurnLeft90, m_agent);
+      *defer = true;
+      return true;
+    case CommandId::TurnRight45:
+      m_sim->requestTurn(Movement::TurnRight45, m_agent);
+      *defer = true;
+      return true;
+    case CommandId::TurnLeft45:
+      m_sim->requestTurn(Movement::TurnLeft45, m_agent);
+      *defer = true;
+      return true;
+    case CommandId::RunPath: {
+      QVector<Command> path;
+      if (!parsePath(command.text, command.textSize, &path)) {
+        return false;
+      }
+      startPath(path);
+      *defer = advancePath(reply);
+      return true;
     }
-    bool okX = false;
-    bool okY = false;
-    int x = tokens.at(1).toInt(&okX);
-    int y = tokens.at(2).toInt(&okY);
-    if (!okX || !okY) {
-      return false;
+
+    case CommandId::SetWall:
+    case CommandId::ClearWall: {
+      Direction dir;
+      if (!directionFromChar(command.symbol, &dir)) {
+        return false;
+      }
+      WallState state =
+          command.id == CommandId::SetWall ? WallState::Wall : WallState::Open;
+      m_sim->setKnownWall(x, y, dir, state, m_agent);
+      int nx = x;
+      int ny = y;
+      if (dir == Direction::North) {
+        ny += 1;
+      } else if (dir == Direction::East) {
+        nx += 1;
+      } else if (dir == Direction::South) {
+        ny -= 1;
+      } else if (dir == Direction::West) {
+        nx -= 1;
+      }
+      Direction opposite = rotateLeft(rotateLeft(dir));
+      if (m_sim->maze() && m_sim->maze()->inBounds(nx, ny)) {
+        m_sim->setKnownWall(nx, ny, opposite, state, m_agent);
+      }
+      return true;
     }
-    m_sim->clearCellColor(x, y);
-    return true;
-  }
 
-  if (fn == "clearAllColor") {
-    m_sim->clearAllColors();
-    return true;
-  }
+    case CommandId::SetColor:
+      m_sim->setCellColor(x, y, command.symbol, m_agent);
+      return true;
+    case CommandId::ClearColor:
+      m_sim->clearCellColor(x, y, m_agent);
+      return true;
+    case CommandId::ClearAllColor:
+      m_sim->clearAllColors(m_agent);
+      return true;
 
-  if (fn == "setText") {
-    int first = command.indexOf(' ');
-    int second = command.indexOf(' ', first + 1);
-    int third = command.indexOf(' ', second + 1);
-    if (first == -1 || second == -1 || third == -1) {
-      return false;
+    case CommandId::SetText:
+      m_sim->setCellText(
+          x, y, QString::fromUtf8(command.text, command.textSize), m_agent);
+      return true;
+    case CommandId::ClearText:
+      m_sim->clearCellText(x, y, m_agent);
+      return true;
+    case CommandId::ClearAllText:
+      m_sim->clearAllText(m_agent);
+      return true;
+
+    case CommandId::SetColorRect:
+      m_sim->fillCellColor(x, y, command.args[2], command.args[3],
+                           command.symbol, m_agent);
+      return true;
+    case CommandId::SetColorGrid: {
+      QVector<QChar> colors;
+      if (!m_sim->maze() ||
+          !decodeColorGrid(command.text, command.textSize,
+                           m_sim->maze()->width() * m_sim->maze()->height(),
+                           &colors)) {
+        return false;
+      }
+      m_sim->setColorGrid(colors, m_agent);
+      return true;
     }
-    QString xStr = command.mid(first + 1, second - first - 1);
-    QString yStr = command.mid(second + 1, third - second - 1);
-    bool okX = false;
-    bool okY = false;
-    int x = xStr.toInt(&okX);
-    int y = yStr.toInt(&okY);
-    if (!okX || !okY) {
-      return false;
+    case CommandId::SetTextGrid: {
+      QVector<QString> text;
+      if (!m_sim->maze() ||
+          !decodeTextGrid(command.text, command.textSize,
+                          m_sim->maze()->width() * m_sim->maze()->height(),
+                          &text)) {
+        return false;
+      }
+      m_sim->setTextGrid(text, m_agent);
+      return true;
     }
-    QString text = command.mid(third + 1);
-    m_sim->setCellText(x, y, text);
-    return true;
-  }
 
-  if (fn == "clearText") {
-    if (tokens.size() != 3) {
-      return false;
-    }
-    bool okX = false;
-    bool okY = false;
-    int x = tokens.at(1).toInt(&okX);
-    int y = tokens.at(2).toInt(&okY);
-    if (!okX || !okY) {
-      return false;
+    case CommandId::FloodKnown:
+      m_planner.update(*m_sim, m_agent);
+      numberReply(m_planner.distance(x, y));
+      return true;
+    case CommandId::NextMoveKnown: {
+      m_planner.update(*m_sim, m_agent);
+      QPair<int, int> cell = m_sim->position(m_agent).toCell();
+      // A mouse facing a diagonal has no way ahead to prefer; north will do.
+      Direction heading = Direction::North;
+      toCardinal(m_sim->heading(m_agent), &heading);
+      Direction next;
+      reply->kind = Reply::Heading;
+      reply->value = m_planner.nextDirection(cell.first, cell.second, heading,
+                                             &next)
+                         ? static_cast<int>(next)
+                         : -1;
+      reply->extra = m_planner.distance(cell.first, cell.second);
+      return true;
     }
-    m_sim->clearCellText(x, y);
-    return true;
-  }
 
-  if (fn == "clearAllText") {
-    m_sim->clearAllText();
-    return true;
-  }
+    case CommandId::WasReset:
+      boolReply(m_sim->wasReset(m_agent));
+      return true;
+    case CommandId::AckReset:
+      m_sim->ackReset(m_agent);
+      reply->kind = Reply::Ack;
+      return true;
 
-  if (fn == "wasReset") {
-    *response = m_sim->wasReset() ? "true" : "false";
-    return true;
-  }
+    case CommandId::GetStat:
+      reply->kind = Reply::Stat;
+      reply->value = static_cast<int>(command.stat);
+      return true;
 
-  if (fn == "ackReset") {
-    m_sim->ackReset();
-    *response = "ack";
-    return true;
+    case CommandId::Unknown:
+      break;
   }
+  return false;
+}
 
-  if (fn == "getStat") {
-    if (tokens.size() != 2) {
-      return false;
-    }
-    QString statName = tokens.at(1);
-    StatId stat;
-    if (statName == "total-distance") {
-      stat = StatId::TotalDistance;
-    } else if (statName == "total-turns") {
-      stat = StatId::TotalTurns;
-    } else if (statName == "best-run-distance") {
-      stat = StatId::BestRunDistance;
-    } else if (statName == "best-run-turns") {
-      stat = StatId::BestRunTurns;
-    } else if (statName == "current-run-distance") {
-      stat = StatId::CurrentRunDistance;
-    } else if (statName == "current-run-turns") {
-      stat = StatId::CurrentRunTurns;
-    } else if (statName == "total-effective-distance") {
-      stat = StatId::TotalEffectiveDistance;
-    } else if (statName == "best-run-effective-distance") {
-      stat = StatId::BestRunEffectiveDistance;
-    } else if (statName == "current-run-effective-distance") {
-      stat = StatId::CurrentRunEffectiveDistance;
-    } else if (statName == "score") {
-      stat = StatId::Score;
-    } else {
-      return false;
-    }
-    QString value = m_sim->stats().statString(stat);
-    if (value.isEmpty()) {
-      value = "-1";
+void SimController::startPath(QVector<Command> path) {
+  QVector<PlannedMove> moves;
+  moves.reserve(path.size());
+  for (const Command &step : path) {
+    PlannedMove move;
+    switch (step.id) {
+      case CommandId::MoveForward:
+      case CommandId::MoveForwardHalf:
+        move.movement = Movement::MoveStraight;
+        move.halfSteps = runHalfSteps(step, m_sim->maze());
+        break;
+      case CommandId::TurnRight:
+        move.movement = Movement::TurnRight90;
+        break;
+      case CommandId::TurnLeft:
+        move.movement = Movement::TurnLeft90;
+        break;
+      case CommandId::TurnRight45:
+        move.movement = Movement::TurnRight45;
+        break;
+      case CommandId::TurnLeft45:
+        move.movement = Movement::TurnLeft45;
+        break;
+      default:
+        break;
     }
-    *response = value;
-    return true;
+    moves.append(move);
+  }
+  // Like a crashing move, a crashing path stops where it hit.
+  m_pathCrash = m_sim->firstCrash(moves, m_agent);
+  if (m_pathCrash >= 0) {
+    path.resize(m_pathCrash + 1);
   }
+  m_path = path;
+  m_pathStep = 0;
+}
 
+// Starts the next step of the path and returns true, or once every step
+// has run returns false with the path's answer in *reply. Only a move
+// into a wall right ahead, always the last step, does not start.
+bool SimController::advancePath(Reply *reply) {
+  while (m_pathStep < m_path.size()) {
+    Reply step;
+    bool defer = false;
+    execute(m_path.at(m_pathStep++), &step, &defer);
+    if (defer) {
+      return true;
+    }
+  }
+  m_path.clear();
+  reply->kind = Reply::Path;
+  reply->value = m_pathCrash;
   return false;
 }
 
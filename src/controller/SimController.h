@@ -1,46 +1,133 @@
 #pragma once
 
+#include <QByteArrayView>
 #include <QObject>
 #include <QQueue>
 #include <QString>
+#include <QTimer>
+#include <QVector>
 
-#include "controller/BotProcess.h"
+#include "controller/BotChannel.h"
+#include "controller/CommandParser.h"
+#include "controller/LatencyProfiler.h"
+#include "engine/KnownMapPlanner.h"
 #include "engine/Simulation.h"
 
 namespace hadak {
 
+class TraceRecorder;
+
 class SimController : public QObject {
   Q_OBJECT
 
  public:
   explicit SimController(Simulation *sim, QObject *parent = nullptr);
+  ~SimController() override;
 
-  void attachBot(BotProcess *bot);
+  void attachBot(BotChannel *bot);
+  void setAgent(int agent);
+  int agent() const;
+  void setRecorder(TraceRecorder *recorder);
+  // Times every bot request from receipt to answer; nullptr turns it off.
+  void setProfiler(LatencyProfiler *profiler);
   void setPaused(bool paused);
   bool isPaused() const;
   void resetState();
 
+  // Requests may arrive faster than they are served. They run strictly in
+  // arrival order: a move or turn holds back everything queued behind it
+  // until it finishes, so every answer goes out in request order. The
+  // queue is bounded: past a high-water mark the bot's channel is paused
+  // until it drains, so a bot flooding overlay commands while paused or
+  // moving waits on its pipe instead of growing our memory.
   void enqueueCommand(const QString &command);
+  // The same for a raw UTF-8 line. When nothing is queued ahead, the line
+  // is parsed and run in place without being copied.
+  void enqueueLine(QByteArrayView line);
+  void enqueueFrame(const QByteArray &frame);
+  bool isBinary() const;
+
+  // Runs one command for an in-process bot, with no line or frame in
+  // between. Answers come back as in a binary response. Returns false for
+  // an invalid command, and for runPath, which only saves round trips.
+  // *deferred is set when a movement started; Simulation::movementFinished
+  // reports how it ended.
+  bool executeDirect(const Command &command, bool *crashed, qint32 *value,
+                     qint32 *extra, bool *deferred);
+  bool isWaiting() const;
+  // Requests waiting behind a movement or a pause.
+  int queueDepth() const;
+  bool isThrottled() const;
 
  signals:
   void logMessage(const QString &message);
+  void pausedChanged(bool paused);
+  void throttledChanged(bool throttled);
 
  private slots:
-  void onMovementFinished(bool crashed);
+  void onMovementFinished(int agent, bool crashed);
 
  private:
+  // A request waiting its turn, with its timings so far.
+  struct Request {
+    QByteArray bytes;
+    LatencyProfiler::Sample sample;
+  };
+
+  // The answer to one command, kept apart from its wire format.
+  struct Reply {
+    // Path: value is the index of the step that crashed, or -1.
+    // Heading: value is a Direction or -1, extra the distance to the goal.
+    enum Kind { None, Bool, Number, Cell, Stat, Ack, Crash, Path, Heading };
+    Kind kind = None;
+    int value = 0;
+    int extra = 0;
+    // The answer to a movement in push mode, which carries the new pose.
+    bool pose = false;
+  };
+
   Simulation *m_sim = nullptr;
-  BotProcess *m_bot = nullptr;
-  QQueue<QString> m_queue;
+  BotChannel *m_bot = nullptr;
+  int m_agent = 0;
+  TraceRecorder *m_recorder = nullptr;
+  LatencyProfiler *m_profiler = nullptr;
+  QQueue<Request> m_queue;
   bool m_waitingResponse = false;
   bool m_paused = false;
+  bool m_binary = false;
+  bool m_throttled = false;
+  // Set by pushSense: movement answers carry the sense mask and pose.
+  bool m_pushSense = false;
+  // Overlay writes in the current frame, whose redraw is held until it
+  // fires.
+  QTimer m_overlayTimer;
+  CommandId m_pending = CommandId::Unknown;
+  LatencyProfiler::Sample m_pendingSample;
+  // The runPath under way: its steps up to any crash, checked against the
+  // maze before the first one starts.
+  QVector<Command> m_path;
+  int m_pathStep = 0;
+  int m_pathCrash = -1;
+  // Answers floodKnown and nextMoveKnown from the bot's own walls.
+  KnownMapPlanner m_planner;
 
   void processQueue();
+  void setThrottled(bool throttled);
+  void holdOverlayUpdates();
+  void releaseOverlayUpdates();
+  LatencyProfiler::Sample receive();
+  void dispatch(QByteArrayView request, LatencyProfiler::Sample sample);
   void sendResponse(const QString &response);
-  void handleInvalid(const QString &command);
+  void sendReply(CommandId id, Reply reply);
+  QString formatReply(const Reply &reply) const;
+  qint32 replyValue(const Reply &reply) const;
+  int senseMask(int ahead) const;
+  void handleInvalid(const QByteArray &command);
+  void switchToBinary();
 
-  bool processCommand(const QString &command, QString *response,
-                      bool *defer);
+  bool execute(const Command &command, Reply *reply, bool *defer);
+  void startPath(QVector<Command> path);
+  bool advancePath(Reply *reply);
 };
 
 }  // namespace hadak
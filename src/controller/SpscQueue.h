@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace hadak {
+
+// A bounded single-producer, single-consumer queue. One thread pushes and
+// one other thread pops; neither ever takes a lock or blocks.
+template <typename T>
+class SpscQueue {
+ public:
+  // capacity is rounded up to a power of two.
+  explicit SpscQueue(std::size_t capacity) {
+    std::size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    m_slots.resize(size);
+    m_mask = size - 1;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer side. Leaves value untouched and returns false when full.
+  bool tryPush(T &value) {
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == m_slots.size()) {
+      return false;
+    }
+    m_slots[head & m_mask] = std::move(value);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool tryPop(T *value) {
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *value = std::move(m_slots[tail & m_mask]);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool isEmpty() const {
+    return m_head.load(std::memory_order_acquire) ==
+           m_tail.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::vector<T> m_slots;
+  std::size_t m_mask = 0;
+  // Producer and consumer counters on separate cache lines.
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+}  // namespace hadak
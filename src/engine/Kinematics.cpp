@@ -0,0 +1,33 @@
+#include "engine/Kinematics.h"
+
+#include <QtMath>
+
+namespace hadak {
+
+double KinematicModel::moveTime(int halfSteps, bool diagonal) const {
+  if (halfSteps <= 0 || acceleration <= 0.0) {
+    return 0.0;
+  }
+  double distance = halfSteps * cellLength / 2.0;
+  if (diagonal) {
+    distance *= qSqrt(2.0);
+  }
+  double topSpeed = diagonal ? diagonalSpeed : maxSpeed;
+  if (topSpeed <= 0.0) {
+    return 0.0;
+  }
+
+  // Accelerating to top speed and braking back to rest covers v^2 / a.
+  // Shorter segments never reach it and follow a triangular profile.
+  double rampDistance = topSpeed * topSpeed / acceleration;
+  if (distance <= rampDistance) {
+    return 2.0 * qSqrt(distance / acceleration);
+  }
+  return distance / topSpeed + topSpeed / acceleration;
+}
+
+double KinematicModel::turnTime(bool ninety) const {
+  return ninety ? turn90Time : turn45Time;
+}
+
+}  // namespace hadak
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace hadak {
+
+// Physical limits of the mouse. Segments start and end at rest and follow
+// a trapezoidal speed profile, so their durations have a closed form.
+// Lengths are metres, times seconds.
+struct KinematicModel {
+  double cellLength = 0.18;
+  double acceleration = 3.0;
+  double maxSpeed = 1.5;
+  double diagonalSpeed = 1.1;
+  double turn45Time = 0.12;
+  double turn90Time = 0.2;
+
+  double moveTime(int halfSteps, bool diagonal) const;
+  double turnTime(bool ninety) const;
+};
+
+}  // namespace hadak
@@ -0,0 +1,111 @@
+#include "engine/KnownMapPlanner.h"
+
+#include "engine/Simulation.h"
+
+namespace hadak {
+
+namespace {
+
+const int kDx[4] = {0, 1, 0, -1};
+const int kDy[4] = {1, 0, -1, 0};
+
+}  // namespace
+
+void KnownMapPlanner::update(const Simulation &sim, int agent) {
+  const Maze *maze = sim.maze();
+  if (!maze) {
+    m_width = 0;
+    m_height = 0;
+    m_distance.clear();
+    return;
+  }
+  if (agent == m_agent && sim.knownMapRevision() == m_revision &&
+      m_width == maze->width() && m_height == maze->height()) {
+    return;
+  }
+  m_agent = agent;
+  m_revision = sim.knownMapRevision();
+  m_width = maze->width();
+  m_height = maze->height();
+
+  int cells = m_width * m_height;
+  m_walls.fill(0, cells);
+  for (int x = 0; x < m_width; ++x) {
+    for (int y = 0; y < m_height; ++y) {
+      quint8 walls = 0;
+      for (int d = 0; d < 4; ++d) {
+        if (sim.knownWall(x, y, static_cast<Direction>(d), agent) ==
+            WallState::Wall) {
+          walls |= 1 << d;
+        }
+      }
+      m_walls[x * m_height + y] = walls;
+    }
+  }
+
+  // Breadth-first from every goal at once; the queue never holds a cell
+  // twice, so a plain array does.
+  m_distance.fill(-1, cells);
+  QVector<int> queue;
+  queue.reserve(cells);
+  for (const QPair<int, int> &goal : sim.goalCells()) {
+    int index = goal.first * m_height + goal.second;
+    if (maze->inBounds(goal.first, goal.second) && m_distance[index] < 0) {
+      m_distance[index] = 0;
+      queue.append(index);
+    }
+  }
+  for (int head = 0; head < queue.size(); ++head) {
+    int index = queue.at(head);
+    int x = index / m_height;
+    int y = index % m_height;
+    for (int d = 0; d < 4; ++d) {
+      int nx = x + kDx[d];
+      int ny = y + kDy[d];
+      if ((m_walls[index] & (1 << d)) || nx < 0 || ny < 0 || nx >= m_width ||
+          ny >= m_height) {
+        continue;
+      }
+      int next = nx * m_height + ny;
+      // The wall may only have been declared from the other side.
+      if (m_distance[next] >= 0 || (m_walls[next] & (1 << ((d + 2) % 4)))) {
+        continue;
+      }
+      m_distance[next] = m_distance[index] + 1;
+      queue.append(next);
+    }
+  }
+}
+
+int KnownMapPlanner::distance(int x, int y) const {
+  if (x < 0 || y < 0 || x >= m_width || y >= m_height) {
+    return -1;
+  }
+  return m_distance.at(x * m_height + y);
+}
+
+bool KnownMapPlanner::nextDirection(int x, int y, Direction heading,
+                                    Direction *dir) const {
+  int here = distance(x, y);
+  if (here <= 0) {
+    return false;
+  }
+  const Direction order[4] = {heading, rotateLeft(heading),
+                              rotateRight(heading),
+                              rotateLeft(rotateLeft(heading))};
+  for (Direction candidate : order) {
+    int d = static_cast<int>(candidate);
+    int nx = x + kDx[d];
+    int ny = y + kDy[d];
+    int next = distance(nx, ny);
+    if (!(m_walls[x * m_height + y] & (1 << d)) && next >= 0 &&
+        next == here - 1 &&
+        !(m_walls[nx * m_height + ny] & (1 << ((d + 2) % 4)))) {
+      *dir = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace hadak
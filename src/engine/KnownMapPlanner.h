@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+#include "engine/Direction.h"
+
+namespace hadak {
+
+class Simulation;
+
+// Shortest paths to the goal over a bot's own map of the maze: the walls
+// it declared with setWall and clearWall, unknown ones counting as open.
+// Only Simulation::knownWall and the goal cells are read, never the maze
+// itself, so every answer is one the bot could have worked out alone.
+class KnownMapPlanner {
+ public:
+  // Floods from the goal cells for agent. Nothing is recomputed while the
+  // known walls and goals are as they were last time.
+  void update(const Simulation &sim, int agent);
+
+  // Cells to the nearest goal, or -1 when no route is known or (x, y) is
+  // outside the maze.
+  int distance(int x, int y) const;
+  // The way out of (x, y) that gets closer to a goal, trying heading
+  // first, then the cell to its left, its right and behind it. False at a
+  // goal or with no known route.
+  bool nextDirection(int x, int y, Direction heading, Direction *dir) const;
+
+ private:
+  int m_width = 0;
+  int m_height = 0;
+  int m_agent = -1;
+  quint64 m_revision = 0;
+  QVector<int> m_distance;
+  // Bit d of a cell is set when the bot declared a wall on side d.
+  QVector<quint8> m_walls;
+};
+
+}  // namespace hadak
@@ -1,10 +1,12 @@
 #include "engine/Simulation.h"
 
 #include <QtMath>
+#include <algorithm>
+#include <cstring>
 
 namespace hadak {
 
-Simulation::Simulation(QObject *parent) : QObject(parent) {}
+Simulation::Simulation(QObject *parent) : QObject(parent) { addAgent(); }
 
 void Simulation::setMaze(std::unique_ptr<Maze> maze) {
   m_maze = std::move(maze);
@@ -20,192 +22,408 @@ void Simulation::setMaze(std::unique_ptr<Maze> maze) {
 
 Maze *Simulation::maze() const { return m_maze.get(); }
 
-void Simulation::reset() {
-  setMouseToStart();
-  m_stats.resetAll();
-  m_movement = {};
-  m_resetRequested = false;
-  m_goalReached = false;
-  m_stepCount = 0;
-  m_collisionCount = 0;
-  m_visitedCells.clear();
-  initKnowledge();
-  markVisited();
+int Simulation::agentCount() const { return m_positions.size(); }
+
+int Simulation::addAgent() {
+  int agent = agentCount();
+  m_positions.append(SemiPosition());
+  m_headings.append(SemiDirection::North);
+  m_movements.append(MovementState());
+  m_stats.append(Stats());
+  m_stats.last().setTimeScored(m_kinematic);
+  m_stepCounts.append(0);
+  m_collisionCounts.append(0);
+  m_goalReached.append(false);
+  m_resetRequested.append(false);
+  m_clocks.append(0.0);
+  m_maps.append(AgentMap());
+  resetAgent(agent);
   emit stateChanged();
+  return agent;
+}
+
+void Simulation::setAgentCount(int count) {
+  count = qMax(1, count);
+  if (count < agentCount()) {
+    m_positions.resize(count);
+    m_headings.resize(count);
+    m_movements.resize(count);
+    m_stats.resize(count);
+    m_stepCounts.resize(count);
+    m_collisionCounts.resize(count);
+    m_goalReached.resize(count);
+    m_resetRequested.resize(count);
+    m_clocks.resize(count);
+    m_maps.resize(count);
+    emit stateChanged();
+  }
+  while (agentCount() < count) {
+    addAgent();
+  }
 }
 
-void Simulation::requestReset() { m_resetRequested = true; }
-
-bool Simulation::wasReset() const { return m_resetRequested; }
+void Simulation::reset() {
+  for (int agent = 0; agent < agentCount(); ++agent) {
+    resetAgent(agent);
+  }
+  emit stateChanged();
+}
 
-void Simulation::ackReset() {
-  setMouseToStart();
-  m_movement = {};
-  m_resetRequested = false;
-  m_goalReached = false;
-  m_stats.penalizeForReset();
-  m_stats.endUnfinishedRun();
-  m_stepCount = 0;
-  logEvent("Reset acknowledged");
+void Simulation::resetAgent(int agent) {
+  setMouseToStart(agent);
+  m_stats[agent].resetAll();
+  m_movements[agent] = {};
+  m_resetRequested[agent] = false;
+  m_goalReached[agent] = false;
+  m_stepCounts[agent] = 0;
+  m_collisionCounts[agent] = 0;
+  m_clocks[agent] = 0.0;
+  m_maps[agent].visited.clear();
+  initKnowledge(agent);
+  markVisited(agent);
+}
+
+void Simulation::requestReset(int agent) { m_resetRequested[agent] = true; }
+
+bool Simulation::wasReset(int agent) const { return m_resetRequested[agent]; }
+
+void Simulation::ackReset(int agent) {
+  setMouseToStart(agent);
+  m_movements[agent] = {};
+  m_resetRequested[agent] = false;
+  m_goalReached[agent] = false;
+  m_stats[agent].penalizeForReset();
+  m_stats[agent].endUnfinishedRun();
+  m_stepCounts[agent] = 0;
+  logEvent(agent, "Reset acknowledged");
   emit stateChanged();
 }
 
-bool Simulation::requestMove(int numHalfSteps) {
+bool Simulation::requestMove(int numHalfSteps, int agent) {
   if (!m_maze) {
     return false;
   }
   if (numHalfSteps < 1) {
     return false;
   }
-  if (isWallFront(0)) {
+  if (isWallFront(0, agent)) {
     return false;
   }
 
   int allowed = 1;
   while (allowed < numHalfSteps) {
-    if (isWallFront(allowed)) {
+    if (isWallFront(allowed, agent)) {
       break;
     }
     allowed += 1;
   }
 
-  m_movement.doomed = (allowed != numHalfSteps);
-  m_movement.halfStepsRemaining = allowed;
-  m_movement.movement = isDiagonal(m_mouse.heading())
-                            ? Movement::MoveDiagonal
-                            : Movement::MoveStraight;
+  bool diagonal = isDiagonal(m_headings[agent]);
+  double duration = moveDuration(allowed, diagonal);
+  MovementState &movement = m_movements[agent];
+  movement.doomed = (allowed != numHalfSteps);
+  movement.halfStepsRemaining = allowed;
+  movement.movement = diagonal ? Movement::MoveDiagonal
+                               : Movement::MoveStraight;
+  movement.endTime = m_clocks[agent] + duration;
 
-  QPair<int, int> cell = m_mouse.position().toCell();
+  QPair<int, int> cell = m_positions[agent].toCell();
   if (cell == m_startCell) {
-    m_stats.startRun();
+    m_stats[agent].startRun();
   }
-  m_stats.addDistance(numHalfSteps);
-  logEvent(QString("Move %1 half-steps").arg(numHalfSteps));
+  m_stats[agent].addDistance(numHalfSteps);
+  m_stats[agent].addTime(static_cast<float>(duration));
+  logEvent(agent, QString("Move %1 half-steps").arg(numHalfSteps));
   emit stateChanged();
   return true;
 }
 
-void Simulation::requestTurn(Movement movement) {
+void Simulation::requestTurn(Movement movement, int agent) {
   if (movement == Movement::None || movement == Movement::MoveStraight ||
       movement == Movement::MoveDiagonal) {
     return;
   }
-  m_movement.movement = movement;
-  m_movement.halfStepsRemaining = 0;
-  m_movement.doomed = false;
-  m_stats.addTurn();
-  logEvent("Turn requested");
+  double duration = turnDuration(movement);
+  m_movements[agent].movement = movement;
+  m_movements[agent].halfStepsRemaining = 0;
+  m_movements[agent].doomed = false;
+  m_movements[agent].endTime = m_clocks[agent] + duration;
+  m_stats[agent].addTurn();
+  m_stats[agent].addTime(static_cast<float>(duration));
+  logEvent(agent, "Turn requested");
   emit stateChanged();
 }
 
-bool Simulation::isMoving() const {
-  return m_movement.movement != Movement::None;
+int Simulation::firstCrash(const QVector<PlannedMove> &moves,
+                           int agent) const {
+  SemiPosition pos = m_positions[agent];
+  SemiDirection heading = m_headings[agent];
+  for (int i = 0; i < moves.size(); ++i) {
+    const PlannedMove &move = moves.at(i);
+    switch (move.movement) {
+      case Movement::TurnLeft45:
+        heading = rotateLeft45(heading);
+        break;
+      case Movement::TurnRight45:
+        heading = rotateRight45(heading);
+        break;
+      case Movement::TurnLeft90:
+        heading = rotateLeft90(heading);
+        break;
+      case Movement::TurnRight90:
+        heading = rotateRight90(heading);
+        break;
+      case Movement::MoveStraight:
+      case Movement::MoveDiagonal: {
+        if (move.halfSteps < 1 ||
+            isWallAt(pos, heading, move.halfSteps - 1)) {
+          return i;
+        }
+        QPair<int, int> delta = deltaFor(heading);
+        pos.x += delta.first * move.halfSteps;
+        pos.y += delta.second * move.halfSteps;
+        break;
+      }
+      case Movement::None:
+        break;
+    }
+  }
+  return -1;
+}
+
+bool Simulation::isMoving(int agent) const {
+  return m_movements[agent].movement != Movement::None;
+}
+
+bool Simulation::anyMoving() const {
+  for (const MovementState &movement : m_movements) {
+    if (movement.movement != Movement::None) {
+      return true;
+    }
+  }
+  return false;
 }
 
 void Simulation::advanceOneTick() {
   if (!m_maze) {
     return;
   }
-  if (m_movement.movement == Movement::None) {
-    return;
+
+  bool changed = false;
+  for (int agent = 0; agent < agentCount(); ++agent) {
+    if (m_movements[agent].movement == Movement::None) {
+      continue;
+    }
+    changed = true;
+    stepAgent(agent);
+  }
+
+  if (changed) {
+    emit stateChanged();
   }
+}
 
-  if (m_movement.movement == Movement::TurnLeft45 ||
-      m_movement.movement == Movement::TurnRight45 ||
-      m_movement.movement == Movement::TurnLeft90 ||
-      m_movement.movement == Movement::TurnRight90) {
-    SemiDirection heading = m_mouse.heading();
-    if (m_movement.movement == Movement::TurnLeft45) {
+int Simulation::advanceToNextEvent() {
+  if (!m_maze) {
+    return 0;
+  }
+
+  int next = -1;
+  for (int agent = 0; agent < agentCount(); ++agent) {
+    const MovementState &movement = m_movements[agent];
+    if (movement.movement == Movement::None) {
+      continue;
+    }
+    if (next < 0 || movement.endTime < m_movements[next].endTime) {
+      next = agent;
+    }
+  }
+  if (next < 0) {
+    return 0;
+  }
+
+  // Jump straight to the segment's last half-step, marking each cell it
+  // crosses, and let stepAgent() take that one so the crash check and
+  // movementFinished() happen once, exactly as the tick loop would do them.
+  MovementState &movement = m_movements[next];
+  int ticks = qMax(1, movement.halfStepsRemaining);
+  int skipped = movement.halfStepsRemaining - 1;
+  if (skipped > 0) {
+    QPair<int, int> delta = deltaFor(m_headings[next]);
+    SemiPosition &pos = m_positions[next];
+    QPair<int, int> cell = pos.toCell();
+    for (int i = 0; i < skipped; ++i) {
+      SemiPosition crossed = pos;
+      crossed.x += delta.first * (i + 1);
+      crossed.y += delta.second * (i + 1);
+      if (crossed.toCell() != cell) {
+        cell = crossed.toCell();
+        markVisited(next, cell);
+      }
+    }
+    pos.x += delta.first * skipped;
+    pos.y += delta.second * skipped;
+    movement.halfStepsRemaining = 1;
+    m_stepCounts[next] += skipped;
+  }
+  stepAgent(next);
+  emit stateChanged();
+  return ticks;
+}
+
+void Simulation::stepAgent(int agent) {
+  MovementState &movement = m_movements[agent];
+  if (movement.movement == Movement::TurnLeft45 ||
+      movement.movement == Movement::TurnRight45 ||
+      movement.movement == Movement::TurnLeft90 ||
+      movement.movement == Movement::TurnRight90) {
+    SemiDirection heading = m_headings[agent];
+    if (movement.movement == Movement::TurnLeft45) {
       heading = rotateLeft45(heading);
-    } else if (m_movement.movement == Movement::TurnRight45) {
+    } else if (movement.movement == Movement::TurnRight45) {
       heading = rotateRight45(heading);
-    } else if (m_movement.movement == Movement::TurnLeft90) {
+    } else if (movement.movement == Movement::TurnLeft90) {
       heading = rotateLeft90(heading);
-    } else if (m_movement.movement == Movement::TurnRight90) {
+    } else if (movement.movement == Movement::TurnRight90) {
       heading = rotateRight90(heading);
     }
-    m_mouse.setHeading(heading);
-    m_movement.movement = Movement::None;
-    emit movementFinished(false);
-    emit stateChanged();
+    m_headings[agent] = heading;
+    m_clocks[agent] = movement.endTime;
+    movement = {};
+    emit movementFinished(agent, false);
     return;
   }
 
-  if (m_movement.halfStepsRemaining > 0) {
-    QPair<int, int> delta = deltaFor(m_mouse.heading());
-    SemiPosition pos = m_mouse.position();
-    pos.x += delta.first;
-    pos.y += delta.second;
-    m_mouse.setPosition(pos);
-    m_movement.halfStepsRemaining -= 1;
-    m_stepCount += 1;
-    markVisited();
+  if (movement.halfStepsRemaining > 0) {
+    QPair<int, int> delta = deltaFor(m_headings[agent]);
+    m_positions[agent].x += delta.first;
+    m_positions[agent].y += delta.second;
+    movement.halfStepsRemaining -= 1;
+    m_stepCounts[agent] += 1;
+    markVisited(agent);
   }
 
-  if (m_movement.halfStepsRemaining == 0) {
-    bool crashed = m_movement.doomed;
+  if (movement.halfStepsRemaining == 0) {
+    bool crashed = movement.doomed;
     if (crashed) {
-      m_collisionCount += 1;
-      logEvent("Collision");
+      m_collisionCounts[agent] += 1;
+      logEvent(agent, "Collision");
     }
-    m_movement = {};
-    emit movementFinished(crashed);
+    m_clocks[agent] = movement.endTime;
+    movement = {};
+    emit movementFinished(agent, crashed);
   }
+}
 
-  emit stateChanged();
+void Simulation::setKinematicEnabled(bool enabled) {
+  m_kinematic = enabled;
+  for (Stats &stats : m_stats) {
+    stats.setTimeScored(enabled);
+  }
 }
 
-bool Simulation::isWallFront(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(), m_mouse.heading(), halfStepsAhead);
+bool Simulation::kinematicEnabled() const { return m_kinematic; }
+
+void Simulation::setKinematicModel(const KinematicModel &model) {
+  m_kinematics = model;
+}
+
+const KinematicModel &Simulation::kinematicModel() const {
+  return m_kinematics;
 }
 
-bool Simulation::isWallLeft(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(), rotateLeft90(m_mouse.heading()),
+double Simulation::simTime(int agent) const { return m_clocks[agent]; }
+
+double Simulation::moveDuration(int halfSteps, bool diagonal) const {
+  if (!m_kinematic) {
+    return halfSteps;
+  }
+  return m_kinematics.moveTime(halfSteps, diagonal);
+}
+
+double Simulation::turnDuration(Movement movement) const {
+  if (!m_kinematic) {
+    return 1.0;
+  }
+  return m_kinematics.turnTime(movement == Movement::TurnLeft90 ||
+                               movement == Movement::TurnRight90);
+}
+
+bool Simulation::isWallFront(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent], m_headings[agent], halfStepsAhead);
+}
+
+bool Simulation::isWallLeft(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent], rotateLeft90(m_headings[agent]),
                   halfStepsAhead);
 }
 
-bool Simulation::isWallRight(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(), rotateRight90(m_mouse.heading()),
+bool Simulation::isWallRight(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent], rotateRight90(m_headings[agent]),
                   halfStepsAhead);
 }
 
-bool Simulation::isWallBack(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(), rotate180(m_mouse.heading()),
+bool Simulation::isWallBack(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent], rotate180(m_headings[agent]),
                   halfStepsAhead);
 }
 
-bool Simulation::isWallFrontLeft(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(), rotateLeft45(m_mouse.heading()),
+bool Simulation::isWallFrontLeft(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent], rotateLeft45(m_headings[agent]),
                   halfStepsAhead);
 }
 
-bool Simulation::isWallFrontRight(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(), rotateRight45(m_mouse.heading()),
+bool Simulation::isWallFrontRight(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent], rotateRight45(m_headings[agent]),
                   halfStepsAhead);
 }
 
-bool Simulation::isWallBackLeft(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(),
-                  rotateLeft90(rotateLeft45(m_mouse.heading())),
+bool Simulation::isWallBackLeft(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent],
+                  rotateLeft90(rotateLeft45(m_headings[agent])),
                   halfStepsAhead);
 }
 
-bool Simulation::isWallBackRight(int halfStepsAhead) const {
-  return isWallAt(m_mouse.position(),
-                  rotateRight90(rotateRight45(m_mouse.heading())),
+bool Simulation::isWallBackRight(int halfStepsAhead, int agent) const {
+  return isWallAt(m_positions[agent],
+                  rotateRight90(rotateRight45(m_headings[agent])),
                   halfStepsAhead);
 }
 
-const Mouse &Simulation::mouse() const { return m_mouse; }
-Mouse &Simulation::mouse() { return m_mouse; }
+Mouse Simulation::mouse(int agent) const {
+  Mouse mouse;
+  mouse.setPosition(m_positions[agent]);
+  mouse.setHeading(m_headings[agent]);
+  return mouse;
+}
 
-const Stats &Simulation::stats() const { return m_stats; }
-Stats &Simulation::stats() { return m_stats; }
+const SemiPosition &Simulation::position(int agent) const {
+  return m_positions[agent];
+}
 
-int Simulation::collisionCount() const { return m_collisionCount; }
-int Simulation::stepCount() const { return m_stepCount; }
+SemiDirection Simulation::heading(int agent) const {
+  return m_headings[agent];
+}
+
+const Stats &Simulation::stats(int agent) const { return m_stats[agent]; }
+Stats &Simulation::stats(int agent) { return m_stats[agent]; }
+
+int Simulation::collisionCount(int agent) const {
+  return m_collisionCounts[agent];
+}
+
+int Simulation::stepCount(int agent) const { return m_stepCounts[agent]; }
 
-bool Simulation::goalReached() const { return m_goalReached; }
+bool Simulation::goalReached(int agent) const { return m_goalReached[agent]; }
+
+bool Simulation::allGoalsReached() const {
+  for (bool reached : m_goalReached) {
+    if (!reached) {
+      return false;
+    }
+  }
+  return true;
+}
 
 QPair<int, int> Simulation::startCell() const { return m_startCell; }
 
@@ -216,15 +434,18 @@ void Simulation::setStartCell(int x, int y) {
     return;
   }
   m_startCell = {x, y};
-  setMouseToStart();
-  m_movement = {};
-  m_stepCount = 0;
-  m_collisionCount = 0;
-  m_goalReached = false;
-  m_stats.resetAll();
-  m_visitedCells.clear();
-  markVisited();
-  logEvent(QString("Start set to %1,%2").arg(x).arg(y));
+  for (int agent = 0; agent < agentCount(); ++agent) {
+    setMouseToStart(agent);
+    m_movements[agent] = {};
+    m_stepCounts[agent] = 0;
+    m_collisionCounts[agent] = 0;
+    m_clocks[agent] = 0.0;
+    m_goalReached[agent] = false;
+    m_stats[agent].resetAll();
+    m_maps[agent].visited.clear();
+    markVisited(agent);
+  }
+  emit eventLogged(QString("Start set to %1,%2").arg(x).arg(y));
   emit stateChanged();
 }
 
@@ -234,128 +455,353 @@ void Simulation::setGoalCell(int x, int y) {
   }
   m_goalCells.clear();
   m_goalCells.insert({x, y});
-  m_goalReached = false;
-  markVisited();
-  logEvent(QString("Goal set to %1,%2").arg(x).arg(y));
+  m_knownRevision += 1;
+  for (int agent = 0; agent < agentCount(); ++agent) {
+    m_goalReached[agent] = false;
+    markVisited(agent);
+  }
+  emit eventLogged(QString("Goal set to %1,%2").arg(x).arg(y));
+  emit stateChanged();
+}
+
+void Simulation::setGoalCells(const QSet<QPair<int, int>> &cells) {
+  if (!m_maze) {
+    return;
+  }
+  m_goalCells.clear();
+  for (const auto &cell : cells) {
+    if (m_maze->inBounds(cell.first, cell.second)) {
+      m_goalCells.insert(cell);
+    }
+  }
+  m_knownRevision += 1;
+  for (int agent = 0; agent < agentCount(); ++agent) {
+    m_goalReached[agent] = false;
+    markVisited(agent);
+  }
   emit stateChanged();
 }
 
-WallState Simulation::knownWall(int x, int y, Direction dir) const {
+WallState Simulation::knownWall(int x, int y, Direction dir, int agent) const {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return WallState::Unknown;
   }
-  return m_knownWalls[x][y][static_cast<int>(dir)];
+  return m_maps[agent].knownWalls[x][y][static_cast<int>(dir)];
 }
 
-void Simulation::setKnownWall(int x, int y, Direction dir, WallState state) {
+void Simulation::setKnownWall(int x, int y, Direction dir, WallState state,
+                              int agent) {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return;
   }
-  m_knownWalls[x][y][static_cast<int>(dir)] = state;
+  WallState &known = m_maps[agent].knownWalls[x][y][static_cast<int>(dir)];
+  if (known != state) {
+    known = state;
+    m_knownRevision += 1;
+  }
   emit stateChanged();
 }
 
-bool Simulation::cellVisited(int x, int y) const {
-  return m_visitedCells.contains({x, y});
+quint64 Simulation::knownMapRevision() const { return m_knownRevision; }
+
+bool Simulation::cellVisited(int x, int y, int agent) const {
+  return m_maps[agent].visited.contains({x, y});
 }
 
-const QSet<QPair<int, int>> &Simulation::visitedCells() const {
-  return m_visitedCells;
+const QSet<QPair<int, int>> &Simulation::visitedCells(int agent) const {
+  return m_maps[agent].visited;
 }
 
-QChar Simulation::cellColor(int x, int y) const {
+QChar Simulation::cellColor(int x, int y, int agent) const {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return QChar();
   }
-  return m_cellColors[x][y];
+  return m_maps[agent].colors[x][y];
 }
 
-void Simulation::setCellColor(int x, int y, QChar color) {
+void Simulation::setCellColor(int x, int y, QChar color, int agent) {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return;
   }
-  m_cellColors[x][y] = color;
-  emit stateChanged();
+  m_maps[agent].colors[x][y] = color;
+  overlayChanged();
 }
 
-void Simulation::clearCellColor(int x, int y) {
+void Simulation::clearCellColor(int x, int y, int agent) {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return;
   }
-  m_cellColors[x][y] = QChar();
-  emit stateChanged();
+  m_maps[agent].colors[x][y] = QChar();
+  overlayChanged();
 }
 
-void Simulation::clearAllColors() {
+void Simulation::clearAllColors(int agent) {
   if (!m_maze) {
     return;
   }
   for (int x = 0; x < m_maze->width(); ++x) {
     for (int y = 0; y < m_maze->height(); ++y) {
-      m_cellColors[x][y] = QChar();
+      m_maps[agent].colors[x][y] = QChar();
     }
   }
-  emit stateChanged();
+  overlayChanged();
 }
 
-QString Simulation::cellText(int x, int y) const {
+QString Simulation::cellText(int x, int y, int agent) const {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return QString();
   }
-  return m_cellText[x][y];
+  return m_maps[agent].text[x][y];
 }
 
-void Simulation::setCellText(int x, int y, const QString &text) {
+void Simulation::setCellText(int x, int y, const QString &text, int agent) {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return;
   }
-  m_cellText[x][y] = text;
-  emit stateChanged();
+  m_maps[agent].text[x][y] = text;
+  overlayChanged();
 }
 
-void Simulation::clearCellText(int x, int y) {
+void Simulation::clearCellText(int x, int y, int agent) {
   if (!m_maze || !m_maze->inBounds(x, y)) {
     return;
   }
-  m_cellText[x][y].clear();
-  emit stateChanged();
+  m_maps[agent].text[x][y].clear();
+  overlayChanged();
 }
 
-void Simulation::clearAllText() {
+void Simulation::clearAllText(int agent) {
   if (!m_maze) {
     return;
   }
   for (int x = 0; x < m_maze->width(); ++x) {
     for (int y = 0; y < m_maze->height(); ++y) {
-      m_cellText[x][y].clear();
+      m_maps[agent].text[x][y].clear();
+    }
+  }
+  overlayChanged();
+}
+
+void Simulation::setColorGrid(const QVector<QChar> &colors, int agent) {
+  if (!m_maze || colors.size() != m_maze->width() * m_maze->height()) {
+    return;
+  }
+  AgentMap &map = m_maps[agent];
+  int i = 0;
+  for (int y = 0; y < m_maze->height(); ++y) {
+    for (int x = 0; x < m_maze->width(); ++x) {
+      map.colors[x][y] = colors.at(i++);
+    }
+  }
+  overlayChanged();
+}
+
+void Simulation::setTextGrid(const QVector<QString> &text, int agent) {
+  if (!m_maze || text.size() != m_maze->width() * m_maze->height()) {
+    return;
+  }
+  AgentMap &map = m_maps[agent];
+  int i = 0;
+  for (int y = 0; y < m_maze->height(); ++y) {
+    for (int x = 0; x < m_maze->width(); ++x) {
+      map.text[x][y] = text.at(i++);
     }
   }
+  overlayChanged();
+}
+
+void Simulation::fillCellColor(int x0, int y0, int x1, int y1, QChar color,
+                               int agent) {
+  if (!m_maze) {
+    return;
+  }
+  int left = qMax(0, qMin(x0, x1));
+  int right = qMin(m_maze->width() - 1, qMax(x0, x1));
+  int bottom = qMax(0, qMin(y0, y1));
+  int top = qMin(m_maze->height() - 1, qMax(y0, y1));
+  if (left > right || bottom > top) {
+    return;
+  }
+  AgentMap &map = m_maps[agent];
+  for (int x = left; x <= right; ++x) {
+    std::fill(map.colors[x].begin() + bottom, map.colors[x].begin() + top + 1,
+              color);
+  }
+  overlayChanged();
+}
+
+void Simulation::holdOverlayUpdates() { ++m_overlayHolds; }
+
+void Simulation::releaseOverlayUpdates() {
+  if (m_overlayHolds == 0 || --m_overlayHolds > 0) {
+    return;
+  }
+  if (m_overlayChanged) {
+    m_overlayChanged = false;
+    emit stateChanged();
+  }
+}
+
+void Simulation::overlayChanged() {
+  if (m_overlayHolds > 0) {
+    m_overlayChanged = true;
+    return;
+  }
   emit stateChanged();
 }
 
-void Simulation::initKnowledge() {
+quint64 Simulation::stateHash(int agent) const {
+  // FNV-1a over everything a bot can observe or change. Visited cells are
+  // walked in grid order because QSet iteration order is per-process.
+  quint64 hash = 1469598103934665603ULL;
+  auto mix = [&hash](quint64 value) {
+    for (int i = 0; i < 8; ++i) {
+      hash ^= (value >> (i * 8)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  };
+
+  const MovementState &movement = m_movements[agent];
+  mix(static_cast<quint64>(m_positions[agent].x));
+  mix(static_cast<quint64>(m_positions[agent].y));
+  mix(static_cast<quint64>(m_headings[agent]));
+  mix(static_cast<quint64>(movement.movement));
+  mix(static_cast<quint64>(movement.halfStepsRemaining));
+  mix(movement.doomed ? 1 : 0);
+  mix(static_cast<quint64>(m_stepCounts[agent]));
+  mix(static_cast<quint64>(m_collisionCounts[agent]));
+  mix(m_goalReached[agent] ? 1 : 0);
+  mix(m_resetRequested[agent] ? 1 : 0);
+  for (int stat = 0; stat <= static_cast<int>(StatId::Score); ++stat) {
+    float value = m_stats[agent].statValue(static_cast<StatId>(stat));
+    quint32 bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    mix(bits);
+  }
+
+  if (!m_maze) {
+    return hash;
+  }
+  const AgentMap &map = m_maps[agent];
+  for (int x = 0; x < m_maze->width(); ++x) {
+    for (int y = 0; y < m_maze->height(); ++y) {
+      for (int d = 0; d < 4; ++d) {
+        mix(static_cast<quint64>(map.knownWalls[x][y][d]));
+      }
+      mix(map.visited.contains({x, y}) ? 1 : 0);
+      mix(map.colors[x][y].unicode());
+      const QString &text = map.text[x][y];
+      mix(static_cast<quint64>(text.size()));
+      for (QChar c : text) {
+        mix(c.unicode());
+      }
+    }
+  }
+  return hash;
+}
+
+SimSnapshot Simulation::snapshot(int agent) const {
+  SimSnapshot snap;
+  snap.position = m_positions[agent];
+  snap.heading = m_headings[agent];
+  snap.movement = m_movements[agent];
+  snap.stats = m_stats[agent].saveState();
+  snap.resetRequested = m_resetRequested[agent];
+  snap.goalReached = m_goalReached[agent];
+  snap.stepCount = m_stepCounts[agent];
+  snap.collisionCount = m_collisionCounts[agent];
+  snap.clock = m_clocks[agent];
+  if (!m_maze) {
+    return snap;
+  }
+
+  const AgentMap &map = m_maps[agent];
+  int height = m_maze->height();
+  int count = m_maze->width() * height;
+  snap.knownWalls.resize(count);
+  snap.visited.resize(count);
+  snap.colors.resize(count);
+  snap.text.resize(count);
+  for (int x = 0; x < m_maze->width(); ++x) {
+    for (int y = 0; y < height; ++y) {
+      int index = x * height + y;
+      quint8 walls = 0;
+      for (int d = 0; d < 4; ++d) {
+        walls |= static_cast<quint8>(map.knownWalls[x][y][d]) << (d * 2);
+      }
+      snap.knownWalls[index] = walls;
+      snap.visited[index] = map.visited.contains({x, y});
+      snap.colors[index] = map.colors[x][y];
+      snap.text[index] = map.text[x][y];
+    }
+  }
+  return snap;
+}
+
+void Simulation::restore(const SimSnapshot &snapshot, int agent) {
+  m_positions[agent] = snapshot.position;
+  m_headings[agent] = snapshot.heading;
+  m_movements[agent] = snapshot.movement;
+  m_stats[agent].restoreState(snapshot.stats);
+  m_resetRequested[agent] = snapshot.resetRequested;
+  m_goalReached[agent] = snapshot.goalReached;
+  m_stepCounts[agent] = snapshot.stepCount;
+  m_collisionCounts[agent] = snapshot.collisionCount;
+  m_clocks[agent] = snapshot.clock;
+
+  if (m_maze &&
+      snapshot.knownWalls.size() == m_maze->width() * m_maze->height()) {
+    AgentMap &map = m_maps[agent];
+    int height = m_maze->height();
+    m_knownRevision += 1;
+    map.visited.clear();
+    for (int x = 0; x < m_maze->width(); ++x) {
+      for (int y = 0; y < height; ++y) {
+        int index = x * height + y;
+        quint8 walls = snapshot.knownWalls[index];
+        for (int d = 0; d < 4; ++d) {
+          map.knownWalls[x][y][d] = static_cast<WallState>((walls >> (d * 2)) & 3);
+        }
+        if (snapshot.visited[index]) {
+          map.visited.insert({x, y});
+        }
+        map.colors[x][y] = snapshot.colors[index];
+        map.text[x][y] = snapshot.text[index];
+      }
+    }
+  }
+  emit stateChanged();
+}
+
+void Simulation::initKnowledge(int agent) {
   if (!m_maze) {
     return;
   }
-  m_knownWalls.resize(m_maze->width());
-  m_cellColors.resize(m_maze->width());
-  m_cellText.resize(m_maze->width());
+  AgentMap &map = m_maps[agent];
+  m_knownRevision += 1;
+  map.knownWalls.resize(m_maze->width());
+  map.colors.resize(m_maze->width());
+  map.text.resize(m_maze->width());
   for (int x = 0; x < m_maze->width(); ++x) {
-    m_knownWalls[x].resize(m_maze->height());
-    m_cellColors[x].resize(m_maze->height());
-    m_cellText[x].resize(m_maze->height());
+    map.knownWalls[x].resize(m_maze->height());
+    map.colors[x].resize(m_maze->height());
+    map.text[x].resize(m_maze->height());
     for (int y = 0; y < m_maze->height(); ++y) {
-      m_knownWalls[x][y].resize(4);
+      map.knownWalls[x][y].resize(4);
       for (int d = 0; d < 4; ++d) {
-        m_knownWalls[x][y][d] = WallState::Unknown;
+        map.knownWalls[x][y][d] = WallState::Unknown;
       }
-      m_cellColors[x][y] = QChar();
-      m_cellText[x][y].clear();
+      map.colors[x][y] = QChar();
+      map.text[x][y].clear();
     }
   }
 }
 
-void Simulation::logEvent(const QString &message) {
+void Simulation::logEvent(int agent, const QString &message) {
+  if (agentCount() > 1) {
+    emit eventLogged(QString("Mouse %1: %2").arg(agent + 1).arg(message));
+    return;
+  }
   emit eventLogged(message);
 }
 
@@ -477,35 +923,38 @@ bool Simulation::isWallAt(const SemiPosition &pos, SemiDirection dir,
   return false;
 }
 
-void Simulation::markVisited() {
+void Simulation::markVisited(int agent) {
+  markVisited(agent, m_positions[agent].toCell());
+}
+
+void Simulation::markVisited(int agent, QPair<int, int> cell) {
   if (!m_maze) {
     return;
   }
-  QPair<int, int> cell = m_mouse.position().toCell();
   if (!m_maze->inBounds(cell.first, cell.second)) {
     return;
   }
-  m_visitedCells.insert(cell);
+  m_maps[agent].visited.insert(cell);
   if (m_goalCells.contains(cell)) {
-    if (!m_goalReached) {
-      m_goalReached = true;
-      m_stats.finishRun();
-      logEvent("Goal reached");
+    if (!m_goalReached[agent]) {
+      m_goalReached[agent] = true;
+      m_stats[agent].finishRun();
+      logEvent(agent, "Goal reached");
     }
   } else if (cell == m_startCell) {
-    m_stats.endUnfinishedRun();
+    m_stats[agent].endUnfinishedRun();
   }
 }
 
-void Simulation::setMouseToStart() {
+void Simulation::setMouseToStart(int agent) {
   if (!m_maze || !m_maze->inBounds(m_startCell.first, m_startCell.second)) {
     m_startCell = {0, 0};
   }
   SemiPosition pos;
   pos.x = m_startCell.first * 2 + 1;
   pos.y = m_startCell.second * 2 + 1;
-  m_mouse.setPosition(pos);
-  m_mouse.setHeading(SemiDirection::North);
+  m_positions[agent] = pos;
+  m_headings[agent] = SemiDirection::North;
 }
 
 }  // namespace hadak
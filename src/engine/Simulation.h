@@ -7,6 +7,7 @@
 #include <memory>
 
 #include "engine/Direction.h"
+#include "engine/Kinematics.h"
 #include "engine/Maze.h"
 #include "engine/Mouse.h"
 #include "engine/Stats.h"
@@ -29,8 +30,45 @@ struct MovementState {
   Movement movement = Movement::None;
   int halfStepsRemaining = 0;
   bool doomed = false;
+  double endTime = 0.0;
 };
 
+// A movement planned ahead: a move of halfSteps along whatever the heading
+// is by then, or a turn.
+struct PlannedMove {
+  Movement movement = Movement::None;
+  int halfSteps = 0;
+};
+
+// Everything a run changes, with per-cell data flattened to x * height + y.
+// The maze, start and goal cells are not part of it.
+struct SimSnapshot {
+  SemiPosition position;
+  SemiDirection heading = SemiDirection::North;
+  MovementState movement;
+  StatsState stats;
+  bool resetRequested = false;
+  bool goalReached = false;
+  int stepCount = 0;
+  int collisionCount = 0;
+  double clock = 0.0;
+  QVector<quint8> knownWalls;
+  QVector<bool> visited;
+  QVector<QChar> colors;
+  QVector<QString> text;
+};
+
+// Several mice can share one maze. Per-mouse state is kept as parallel
+// arrays indexed by agent so a tick walks each field in one pass; every
+// per-mouse accessor takes a trailing agent index that defaults to the
+// first mouse.
+//
+// Each mouse also keeps its own simulated clock. Every segment is given an
+// end time when it is requested: its length in ticks by default, or its
+// duration in seconds under the kinematic model. advanceOneTick() animates
+// segments a half-step at a time; advanceToNextEvent() completes the
+// segment that ends first in one call, so headless runs cost the same
+// whatever the time resolution.
 class Simulation : public QObject {
   Q_OBJECT
 
@@ -40,89 +78,151 @@ class Simulation : public QObject {
   void setMaze(std::unique_ptr<Maze> maze);
   Maze *maze() const;
 
-  void reset();
-  void requestReset();
-  bool wasReset() const;
-  void ackReset();
-
-  bool requestMove(int numHalfSteps);
-  void requestTurn(Movement movement);
+  int agentCount() const;
+  int addAgent();
+  void setAgentCount(int count);
 
-  bool isMoving() const;
+  void reset();
+  void requestReset(int agent = 0);
+  bool wasReset(int agent = 0) const;
+  void ackReset(int agent = 0);
+
+  bool requestMove(int numHalfSteps, int agent = 0);
+  void requestTurn(Movement movement, int agent = 0);
+  // The index of the first of moves, made in turn from where the mouse
+  // stands, that would hit a wall by requestMove's rules, or -1.
+  int firstCrash(const QVector<PlannedMove> &moves, int agent = 0) const;
+
+  bool isMoving(int agent = 0) const;
+  bool anyMoving() const;
   void advanceOneTick();
-
-  bool isWallFront(int halfStepsAhead) const;
-  bool isWallLeft(int halfStepsAhead) const;
-  bool isWallRight(int halfStepsAhead) const;
-  bool isWallBack(int halfStepsAhead) const;
-  bool isWallFrontLeft(int halfStepsAhead) const;
-  bool isWallFrontRight(int halfStepsAhead) const;
-  bool isWallBackLeft(int halfStepsAhead) const;
-  bool isWallBackRight(int halfStepsAhead) const;
-
-  const Mouse &mouse() const;
-  Mouse &mouse();
-
-  const Stats &stats() const;
-  Stats &stats();
-
-  int collisionCount() const;
-  int stepCount() const;
-  bool goalReached() const;
+  int advanceToNextEvent();
+
+  void setKinematicEnabled(bool enabled);
+  bool kinematicEnabled() const;
+  void setKinematicModel(const KinematicModel &model);
+  const KinematicModel &kinematicModel() const;
+  double simTime(int agent = 0) const;
+
+  bool isWallFront(int halfStepsAhead, int agent = 0) const;
+  bool isWallLeft(int halfStepsAhead, int agent = 0) const;
+  bool isWallRight(int halfStepsAhead, int agent = 0) const;
+  bool isWallBack(int halfStepsAhead, int agent = 0) const;
+  bool isWallFrontLeft(int halfStepsAhead, int agent = 0) const;
+  bool isWallFrontRight(int halfStepsAhead, int agent = 0) const;
+  bool isWallBackLeft(int halfStepsAhead, int agent = 0) const;
+  bool isWallBackRight(int halfStepsAhead, int agent = 0) const;
+
+  Mouse mouse(int agent = 0) const;
+  const SemiPosition &position(int agent = 0) const;
+  SemiDirection heading(int agent = 0) const;
+
+  const Stats &stats(int agent = 0) const;
+  Stats &stats(int agent = 0);
+
+  int collisionCount(int agent = 0) const;
+  int stepCount(int agent = 0) const;
+  bool goalReached(int agent = 0) const;
+  bool allGoalsReached() const;
 
   QPair<int, int> startCell() const;
   QSet<QPair<int, int>> goalCells() const;
   void setStartCell(int x, int y);
   void setGoalCell(int x, int y);
-
-  WallState knownWall(int x, int y, Direction dir) const;
-  void setKnownWall(int x, int y, Direction dir, WallState state);
-
-  bool cellVisited(int x, int y) const;
-  const QSet<QPair<int, int>> &visitedCells() const;
-
-  QChar cellColor(int x, int y) const;
-  void setCellColor(int x, int y, QChar color);
-  void clearCellColor(int x, int y);
-  void clearAllColors();
-
-  QString cellText(int x, int y) const;
-  void setCellText(int x, int y, const QString &text);
-  void clearCellText(int x, int y);
-  void clearAllText();
+  void setGoalCells(const QSet<QPair<int, int>> &cells);
+
+  WallState knownWall(int x, int y, Direction dir, int agent = 0) const;
+  void setKnownWall(int x, int y, Direction dir, WallState state,
+                    int agent = 0);
+  // Changes whenever any mouse's known walls or the goal cells do, so
+  // KnownMapPlanner can tell when to flood again.
+  quint64 knownMapRevision() const;
+
+  bool cellVisited(int x, int y, int agent = 0) const;
+  const QSet<QPair<int, int>> &visitedCells(int agent = 0) const;
+
+  QChar cellColor(int x, int y, int agent = 0) const;
+  void setCellColor(int x, int y, QChar color, int agent = 0);
+  void clearCellColor(int x, int y, int agent = 0);
+  void clearAllColors(int agent = 0);
+
+  QString cellText(int x, int y, int agent = 0) const;
+  void setCellText(int x, int y, const QString &text, int agent = 0);
+  void clearCellText(int x, int y, int agent = 0);
+  void clearAllText(int agent = 0);
+  // Bulk overlay writes, each one pass with one stateChanged(). Grids hold
+  // a value per cell row by row, y = 0 first, and must cover the whole
+  // maze; a null color or empty text clears the cell. The rectangle takes
+  // two opposite corners in either order and is clipped to the maze.
+  void setColorGrid(const QVector<QChar> &colors, int agent = 0);
+  void setTextGrid(const QVector<QString> &text, int agent = 0);
+  void fillCellColor(int x0, int y0, int x1, int y1, QChar color,
+                     int agent = 0);
+  // Overlay writes only change what is drawn. While held they skip
+  // stateChanged(), and the last release sends one for all of them, so a
+  // bot repainting a cell many times in a frame costs one redraw. Holds
+  // nest.
+  void holdOverlayUpdates();
+  void releaseOverlayUpdates();
+
+  quint64 stateHash(int agent = 0) const;
+
+  SimSnapshot snapshot(int agent = 0) const;
+  void restore(const SimSnapshot &snapshot, int agent = 0);
 
  signals:
   void stateChanged();
-  void movementFinished(bool crashed);
+  void movementFinished(int agent, bool crashed);
   void eventLogged(const QString &message);
 
  private:
+  // What a mouse's bot has written or uncovered: known walls, visited
+  // cells and the color/text overlays.
+  struct AgentMap {
+    QVector<QVector<QVector<WallState>>> knownWalls;
+    QSet<QPair<int, int>> visited;
+    QVector<QVector<QChar>> colors;
+    QVector<QVector<QString>> text;
+  };
+
   std::unique_ptr<Maze> m_maze;
-  Mouse m_mouse;
-  Stats m_stats;
-  MovementState m_movement;
-  bool m_resetRequested = false;
-  bool m_goalReached = false;
-  int m_stepCount = 0;
-  int m_collisionCount = 0;
-
-  QVector<QVector<QVector<WallState>>> m_knownWalls;
-  QSet<QPair<int, int>> m_visitedCells;
-  QVector<QVector<QChar>> m_cellColors;
-  QVector<QVector<QString>> m_cellText;
+
+  QVector<SemiPosition> m_positions;
+  QVector<SemiDirection> m_headings;
+  QVector<MovementState> m_movements;
+  QVector<Stats> m_stats;
+  QVector<int> m_stepCounts;
+  QVector<int> m_collisionCounts;
+  QVector<bool> m_goalReached;
+  QVector<bool> m_resetRequested;
+  QVector<double> m_clocks;
+  QVector<AgentMap> m_maps;
+
+  bool m_kinematic = false;
+  KinematicModel m_kinematics;
+
+  quint64 m_knownRevision = 0;
+  int m_overlayHolds = 0;
+  bool m_overlayChanged = false;
 
   QPair<int, int> m_startCell = {0, 0};
   QSet<QPair<int, int>> m_goalCells;
 
-  void initKnowledge();
-  void logEvent(const QString &message);
+  void resetAgent(int agent);
+  void initKnowledge(int agent);
+  void logEvent(int agent, const QString &message);
+  void stepAgent(int agent);
+  double moveDuration(int halfSteps, bool diagonal) const;
+  double turnDuration(Movement movement) const;
 
   bool isWallAt(const SemiPosition &pos, SemiDirection dir) const;
   bool isWallAt(const SemiPosition &pos, SemiDirection dir,
                 int halfStepsAhead) const;
 
-  void markVisited();
-  void setMouseToStart();
+  void markVisited(int agent);
+  void markVisited(int agent, QPair<int, int> cell);
+  void overlayChanged();
+  void setMouseToStart(int agent);
 };
 
 }  // namespace hadak
@@ -4,6 +4,20 @@
 
 namespace hadak {
 
+bool StatsState::operator==(const StatsState &other) const {
+  for (int i = 0; i < kStatCount; ++i) {
+    if (values[i] != other.values[i]) {
+      return false;
+    }
+  }
+  return started == other.started && solved == other.solved &&
+         penalty == other.penalty;
+}
+
+bool StatsState::operator!=(const StatsState &other) const {
+  return !(*this == other);
+}
+
 Stats::Stats() { resetAll(); }
 
 void Stats::resetAll() {
@@ -18,10 +32,13 @@ void Stats::resetAll() {
   setStat(StatId::CurrentRunTurns, 0.0f);
   setStat(StatId::TotalEffectiveDistance, 0.0f);
   setStat(StatId::CurrentRunEffectiveDistance, 0.0f);
+  setStat(StatId::TotalTime, 0.0f);
+  setStat(StatId::CurrentRunTime, 0.0f);
 
   m_values[StatId::BestRunTurns] = std::numeric_limits<float>::max();
   m_values[StatId::BestRunDistance] = 0.0f;
   m_values[StatId::BestRunEffectiveDistance] = 0.0f;
+  m_values[StatId::BestRunTime] = 0.0f;
   updateScore();
 }
 
@@ -44,10 +61,19 @@ void Stats::addTurn() {
   updateScore();
 }
 
+void Stats::addTime(float time) {
+  increment(StatId::TotalTime, time);
+  if (m_started) {
+    increment(StatId::CurrentRunTime, time);
+  }
+  updateScore();
+}
+
 void Stats::startRun() {
   setStat(StatId::CurrentRunDistance, 0.0f);
   setStat(StatId::CurrentRunTurns, 0.0f);
   setStat(StatId::CurrentRunEffectiveDistance, 0.0f);
+  setStat(StatId::CurrentRunTime, 0.0f);
   if (m_penalty > 0.0f) {
     increment(StatId::CurrentRunEffectiveDistance, m_penalty);
     increment(StatId::TotalEffectiveDistance, m_penalty);
@@ -66,12 +92,21 @@ void Stats::finishRun() {
   float bestScore = m_values.value(StatId::BestRunTurns) +
                     m_values.value(StatId::BestRunEffectiveDistance);
 
-  if (currentScore < bestScore) {
+  bool better = currentScore < bestScore;
+  if (m_timeScored) {
+    better = m_values.value(StatId::BestRunTurns) ==
+                 std::numeric_limits<float>::max() ||
+             m_values.value(StatId::CurrentRunTime) <
+                 m_values.value(StatId::BestRunTime);
+  }
+
+  if (better) {
     setStat(StatId::BestRunTurns, m_values.value(StatId::CurrentRunTurns));
     setStat(StatId::BestRunDistance,
             m_values.value(StatId::CurrentRunDistance));
     setStat(StatId::BestRunEffectiveDistance,
             m_values.value(StatId::CurrentRunEffectiveDistance));
+    setStat(StatId::BestRunTime, m_values.value(StatId::CurrentRunTime));
   }
   updateScore();
 }
@@ -83,6 +118,13 @@ void Stats::endUnfinishedRun() {
 
 void Stats::penalizeForReset() { m_penalty = 15.0f; }
 
+void Stats::setTimeScored(bool timeScored) {
+  m_timeScored = timeScored;
+  updateScore();
+}
+
+bool Stats::timeScored() const { return m_timeScored; }
+
 float Stats::effectiveDistance(int distance) const {
   if (distance > 2) {
     return distance / 2.0f + 1.0f;
@@ -101,7 +143,8 @@ QString Stats::statString(StatId stat) const {
           std::numeric_limits<float>::max()) {
     return "";
   }
-  if (stat == StatId::BestRunEffectiveDistance &&
+  if ((stat == StatId::BestRunEffectiveDistance ||
+       stat == StatId::BestRunTime) &&
       m_values.value(StatId::BestRunTurns) ==
           std::numeric_limits<float>::max()) {
     return "";
@@ -120,6 +163,27 @@ QString Stats::statString(StatId stat) const {
 
 float Stats::statValue(StatId stat) const { return m_values.value(stat); }
 
+StatsState Stats::saveState() const {
+  StatsState state;
+  for (int i = 0; i < kStatCount; ++i) {
+    state.values[i] = m_values.value(static_cast<StatId>(i));
+  }
+  state.started = m_started;
+  state.solved = m_solved;
+  state.penalty = m_penalty;
+  return state;
+}
+
+void Stats::restoreState(const StatsState &state) {
+  m_values.clear();
+  for (int i = 0; i < kStatCount; ++i) {
+    m_values[static_cast<StatId>(i)] = state.values[i];
+  }
+  m_started = state.started;
+  m_solved = state.solved;
+  m_penalty = state.penalty;
+}
+
 void Stats::setStat(StatId stat, float value) { m_values[stat] = value; }
 
 void Stats::increment(StatId stat, float amount) {
@@ -135,7 +199,10 @@ bool Stats::isIntegerStat(StatId stat) const {
 
 void Stats::updateScore() {
   float score = 2000.0f;
-  if (m_solved) {
+  if (m_solved && m_timeScored) {
+    score = m_values.value(StatId::BestRunTime) +
+            0.1f * m_values.value(StatId::TotalTime);
+  } else if (m_solved) {
     score = m_values.value(StatId::BestRunEffectiveDistance) +
             m_values.value(StatId::BestRunTurns) +
             0.1f * (m_values.value(StatId::TotalEffectiveDistance) +
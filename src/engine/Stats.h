@@ -15,9 +15,25 @@ enum class StatId {
   TotalEffectiveDistance,
   BestRunEffectiveDistance,
   CurrentRunEffectiveDistance,
+  TotalTime,
+  BestRunTime,
+  CurrentRunTime,
   Score
 };
 
+const int kStatCount = static_cast<int>(StatId::Score) + 1;
+
+// Plain copy of a Stats object, small enough to keep one per timeline frame.
+struct StatsState {
+  float values[kStatCount] = {};
+  bool started = false;
+  bool solved = false;
+  float penalty = 0.0f;
+
+  bool operator==(const StatsState &other) const;
+  bool operator!=(const StatsState &other) const;
+};
+
 class Stats {
  public:
   Stats();
@@ -25,20 +41,31 @@ class Stats {
   void resetAll();
   void addDistance(int distance);
   void addTurn();
+  void addTime(float time);
 
   void startRun();
   void finishRun();
   void endUnfinishedRun();
   void penalizeForReset();
 
+  // Scores by time rather than turns and distance, as kinematic runs do: the
+  // best run is the fastest one and Score is its time plus a tenth of all
+  // time spent. This is configuration, so resetAll() leaves it alone.
+  void setTimeScored(bool timeScored);
+  bool timeScored() const;
+
   QString statString(StatId stat) const;
   float statValue(StatId stat) const;
 
+  StatsState saveState() const;
+  void restoreState(const StatsState &state);
+
  private:
   QMap<StatId, float> m_values;
   bool m_started = false;
   bool m_solved = false;
   float m_penalty = 0.0f;
+  bool m_timeScored = false;
 
   void setStat(StatId stat, float value);
   void increment(StatId stat, float amount);
@@ -0,0 +1,252 @@
+#include "engine/Timeline.h"
+
+#include <algorithm>
+
+namespace hadak {
+
+namespace {
+
+const int kInitialInterval = 64;
+const int kMaxInterval = 2048;
+
+qint64 snapshotBytes(const QVector<SimSnapshot> &agents) {
+  qint64 bytes = 0;
+  for (const SimSnapshot &snap : agents) {
+    bytes += sizeof(SimSnapshot);
+    bytes += snap.knownWalls.size() *
+             (sizeof(quint8) + sizeof(bool) + sizeof(QChar) + sizeof(QString));
+    for (const QString &text : snap.text) {
+      bytes += text.size() * sizeof(QChar);
+    }
+  }
+  return bytes;
+}
+
+qint64 frameBytes(const QVector<TimelineDelta> &frame) {
+  qint64 bytes = sizeof(QVector<TimelineDelta>);
+  for (const TimelineDelta &delta : frame) {
+    bytes += sizeof(TimelineDelta);
+    bytes += delta.cells.size() * sizeof(TimelineCell);
+    for (const TimelineCell &cell : delta.cells) {
+      bytes += cell.text.size() * sizeof(QChar);
+    }
+  }
+  return bytes;
+}
+
+bool sameMovement(const MovementState &a, const MovementState &b) {
+  return a.movement == b.movement &&
+         a.halfStepsRemaining == b.halfStepsRemaining &&
+         a.doomed == b.doomed && a.endTime == b.endTime;
+}
+
+bool sameScalars(const SimSnapshot &a, const SimSnapshot &b) {
+  return a.position.x == b.position.x && a.position.y == b.position.y &&
+         a.heading == b.heading &&
+         sameMovement(a.movement, b.movement) &&
+         a.resetRequested == b.resetRequested &&
+         a.goalReached == b.goalReached && a.stepCount == b.stepCount &&
+         a.collisionCount == b.collisionCount && a.clock == b.clock;
+}
+
+bool diffAgent(const SimSnapshot &before, const SimSnapshot &after,
+               TimelineDelta *delta) {
+  delta->position = after.position;
+  delta->heading = after.heading;
+  delta->movement = after.movement;
+  delta->resetRequested = after.resetRequested;
+  delta->goalReached = after.goalReached;
+  delta->stepCount = after.stepCount;
+  delta->collisionCount = after.collisionCount;
+  delta->clock = after.clock;
+  if (after.stats != before.stats) {
+    delta->statsChanged = true;
+    delta->stats = after.stats;
+  }
+  for (int i = 0; i < after.knownWalls.size(); ++i) {
+    if (after.knownWalls[i] != before.knownWalls[i] ||
+        after.visited[i] != before.visited[i] ||
+        after.colors[i] != before.colors[i] ||
+        after.text[i] != before.text[i]) {
+      delta->cells.append({i, after.knownWalls[i], after.visited[i],
+                           after.colors[i], after.text[i]});
+    }
+  }
+  return delta->statsChanged || !delta->cells.isEmpty() ||
+         !sameScalars(before, after);
+}
+
+void applyDelta(const TimelineDelta &delta, SimSnapshot *snap) {
+  snap->position = delta.position;
+  snap->heading = delta.heading;
+  snap->movement = delta.movement;
+  snap->resetRequested = delta.resetRequested;
+  snap->goalReached = delta.goalReached;
+  snap->stepCount = delta.stepCount;
+  snap->collisionCount = delta.collisionCount;
+  snap->clock = delta.clock;
+  if (delta.statsChanged) {
+    snap->stats = delta.stats;
+  }
+  for (const TimelineCell &cell : delta.cells) {
+    snap->knownWalls[cell.index] = cell.knownWalls;
+    snap->visited[cell.index] = cell.visited;
+    snap->colors[cell.index] = cell.color;
+    snap->text[cell.index] = cell.text;
+  }
+}
+
+}  // namespace
+
+SimTimeline::SimTimeline(qint64 memoryBudget) : m_budget(memoryBudget) {
+  clear();
+}
+
+void SimTimeline::clear() {
+  m_memory = 0;
+  m_checkpointMemory = 0;
+  m_interval = kInitialInterval;
+  m_firstFrame = 0;
+  m_lastFrame = -1;
+  m_checkpoints.clear();
+  m_frames.clear();
+  m_last.clear();
+}
+
+bool SimTimeline::record(const Simulation &sim) {
+  QVector<SimSnapshot> current;
+  for (int agent = 0; agent < sim.agentCount(); ++agent) {
+    current.append(sim.snapshot(agent));
+  }
+  if (m_lastFrame >= 0 &&
+      (current.size() != m_last.size() ||
+       current[0].knownWalls.size() != m_last[0].knownWalls.size())) {
+    clear();
+  }
+  if (m_lastFrame < 0) {
+    m_lastFrame = 0;
+    addCheckpoint(0, current);
+    m_last = current;
+    return true;
+  }
+
+  QVector<TimelineDelta> frame;
+  for (int agent = 0; agent < current.size(); ++agent) {
+    TimelineDelta delta;
+    delta.agent = agent;
+    if (diffAgent(m_last[agent], current[agent], &delta)) {
+      frame.append(delta);
+    }
+  }
+  if (frame.isEmpty()) {
+    return false;
+  }
+
+  m_memory += frameBytes(frame);
+  m_frames.append(frame);
+  ++m_lastFrame;
+  if (m_lastFrame % m_interval == 0) {
+    addCheckpoint(m_lastFrame, current);
+  }
+  m_last = current;
+  enforceBudget();
+  return true;
+}
+
+bool SimTimeline::seek(int frame, Simulation *sim) const {
+  if (!sim || frame < m_firstFrame || frame > m_lastFrame ||
+      sim->agentCount() != m_last.size()) {
+    return false;
+  }
+  QVector<SimSnapshot> state;
+  if (frame == m_lastFrame) {
+    state = m_last;
+  } else {
+    auto it = std::upper_bound(
+        m_checkpoints.begin(), m_checkpoints.end(), frame,
+        [](int value, const Checkpoint &cp) { return value < cp.frame; });
+    if (it == m_checkpoints.begin()) {
+      return false;
+    }
+    --it;
+    state = it->agents;
+    for (int f = it->frame + 1; f <= frame; ++f) {
+      for (const TimelineDelta &delta : m_frames[f - m_firstFrame - 1]) {
+        applyDelta(delta, &state[delta.agent]);
+      }
+    }
+  }
+  for (int agent = 0; agent < state.size(); ++agent) {
+    sim->restore(state[agent], agent);
+  }
+  return true;
+}
+
+bool SimTimeline::isEmpty() const { return m_lastFrame < 0; }
+
+int SimTimeline::firstFrame() const { return m_firstFrame; }
+
+int SimTimeline::lastFrame() const { return std::max(m_lastFrame, 0); }
+
+int SimTimeline::checkpointInterval() const { return m_interval; }
+
+int SimTimeline::checkpointCount() const { return m_checkpoints.size(); }
+
+qint64 SimTimeline::memoryUsage() const { return m_memory; }
+
+qint64 SimTimeline::memoryBudget() const { return m_budget; }
+
+void SimTimeline::addCheckpoint(int frame,
+                                const QVector<SimSnapshot> &agents) {
+  qint64 bytes = snapshotBytes(agents);
+  m_memory += bytes;
+  m_checkpointMemory += bytes;
+  m_checkpoints.append({frame, agents});
+}
+
+void SimTimeline::enforceBudget() {
+  while (m_memory > m_budget) {
+    // Sparser checkpoints only pay off while they are a real share of the
+    // budget; otherwise the deltas dominate and old frames have to go.
+    if (m_checkpointMemory > m_budget / 4 && m_interval < kMaxInterval &&
+        m_checkpoints.size() > 2) {
+      m_interval *= 2;
+      QVector<Checkpoint> kept;
+      for (int i = 0; i < m_checkpoints.size(); ++i) {
+        const Checkpoint &cp = m_checkpoints[i];
+        if (i == 0 || cp.frame % m_interval == 0) {
+          kept.append(cp);
+        } else {
+          qint64 bytes = snapshotBytes(cp.agents);
+          m_memory -= bytes;
+          m_checkpointMemory -= bytes;
+        }
+      }
+      m_checkpoints = kept;
+      continue;
+    }
+    if (!dropOldest()) {
+      break;
+    }
+  }
+}
+
+bool SimTimeline::dropOldest() {
+  if (m_checkpoints.size() < 2) {
+    return false;
+  }
+  int newFirst = m_checkpoints[1].frame;
+  int dropped = newFirst - m_firstFrame;
+  for (int i = 0; i < dropped; ++i) {
+    m_memory -= frameBytes(m_frames[i]);
+  }
+  m_frames.remove(0, dropped);
+  qint64 bytes = snapshotBytes(m_checkpoints[0].agents);
+  m_memory -= bytes;
+  m_checkpointMemory -= bytes;
+  m_checkpoints.removeFirst();
+  m_firstFrame = newFirst;
+  return true;
+}
+
+}  // namespace hadak
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QVector>
+
+#include "engine/Simulation.h"
+
+namespace hadak {
+
+struct TimelineCell {
+  int index = 0;
+  quint8 knownWalls = 0;
+  bool visited = false;
+  QChar color;
+  QString text;
+};
+
+// Changes to one mouse from one frame to the next. Scalars are stored
+// whole, cells only when something in them changed.
+struct TimelineDelta {
+  int agent = 0;
+  SemiPosition position;
+  SemiDirection heading = SemiDirection::North;
+  MovementState movement;
+  bool resetRequested = false;
+  bool goalReached = false;
+  int stepCount = 0;
+  int collisionCount = 0;
+  double clock = 0.0;
+  bool statsChanged = false;
+  StatsState stats;
+  QVector<TimelineCell> cells;
+};
+
+// Run history for scrubbing: full snapshots of every mouse each
+// checkpointInterval() frames with deltas in between. Seeking restores the nearest
+// checkpoint at or before the frame and replays deltas forward. When the
+// history outgrows the memory budget the interval doubles (dropping the
+// checkpoints that no longer line up) or, when the deltas dominate, the
+// oldest frames are discarded.
+class SimTimeline {
+ public:
+  explicit SimTimeline(qint64 memoryBudget = 64 * 1024 * 1024);
+
+  void clear();
+  bool record(const Simulation &sim);
+  bool seek(int frame, Simulation *sim) const;
+
+  bool isEmpty() const;
+  int firstFrame() const;
+  int lastFrame() const;
+  int checkpointInterval() const;
+  int checkpointCount() const;
+  qint64 memoryUsage() const;
+  qint64 memoryBudget() const;
+
+ private:
+  struct Checkpoint {
+    int frame = 0;
+    QVector<SimSnapshot> agents;
+  };
+
+  qint64 m_budget = 0;
+  qint64 m_memory = 0;
+  qint64 m_checkpointMemory = 0;
+  int m_interval = 0;
+  int m_firstFrame = 0;
+  int m_lastFrame = -1;
+  QVector<Checkpoint> m_checkpoints;
+  QVector<QVector<TimelineDelta>> m_frames;
+  QVector<SimSnapshot> m_last;
+
+  void addCheckpoint(int frame, const QVector<SimSnapshot> &agents);
+  void enforceBudget();
+  bool dropOldest();
+};
+
+}  // namespace hadak
@@ -1,7 +1,7 @@
-QT += core gui widgets
+QT += core gui widgets network
 
 TEMPLATE = app
-CONFIG += c++17
+CONFIG += c++20
 CONFIG += debug
 CONFIG += qt
 CONFIG += object_parallel_to_source
@@ -11,6 +11,9 @@ HEADERS += $$files($$PWD/*.h, true)
 
 INCLUDEPATH += $$PWD
 
+# shm_open lives in librt on glibc before 2.34.
+linux: LIBS += -lrt
+
 DESTDIR     = ../bin
 MOC_DIR     = ../build/moc
 OBJECTS_DIR = ../build/obj
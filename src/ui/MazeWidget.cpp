@@ -43,6 +43,26 @@ void MazeWidget::setEditAction(EditAction action) {
   update();
 }
 
+void MazeWidget::setFocusAgent(int agent) {
+  m_focusAgent = agent;
+  update();
+}
+
+int MazeWidget::focusAgent() const {
+  if (!m_sim || m_focusAgent < 0 || m_focusAgent >= m_sim->agentCount()) {
+    return 0;
+  }
+  return m_focusAgent;
+}
+
+QColor MazeWidget::agentColor(int agent) {
+  static const QColor colors[] = {
+      QColor(224, 122, 95), QColor(61, 90, 128), QColor(129, 178, 154),
+      QColor(242, 204, 143), QColor(155, 89, 182), QColor(52, 73, 94),
+  };
+  return colors[agent % 6];
+}
+
 void MazeWidget::paintEvent(QPaintEvent *event) {
   Q_UNUSED(event);
   QPainter painter(this);
@@ -68,7 +88,13 @@ void MazeWidget::paintEvent(QPaintEvent *event) {
 
   drawOverlays(&painter, bounds);
   drawMaze(&painter, bounds);
-  drawMouse(&painter, bounds);
+  // The focused mouse is drawn last so it stays on top.
+  for (int agent = 0; agent < m_sim->agentCount(); ++agent) {
+    if (agent != focusAgent()) {
+      drawMouse(&painter, bounds, agent);
+    }
+  }
+  drawMouse(&painter, bounds, focusAgent());
 }
 
 void MazeWidget::drawOverlays(QPainter *painter, const QRectF &bounds) {
@@ -79,10 +105,11 @@ void MazeWidget::drawOverlays(QPainter *painter, const QRectF &bounds) {
   int width = m_sim->maze()->width();
   int height = m_sim->maze()->height();
   qreal cellSize = bounds.width() / width;
+  int agent = focusAgent();
 
   if (m_showVisited) {
     QColor visited(224, 239, 230, 200);
-    for (const auto &pos : m_sim->visitedCells()) {
+    for (const auto &pos : m_sim->visitedCells(agent)) {
       QRectF cell(bounds.left() + pos.first * cellSize,
                   bounds.bottom() - (pos.second + 1) * cellSize, cellSize,
                   cellSize);
@@ -108,7 +135,7 @@ void MazeWidget::drawOverlays(QPainter *painter, const QRectF &bounds) {
     for (int y = 0; y < height; ++y) {
       QRectF cell(bounds.left() + x * cellSize,
                   bounds.bottom() - (y + 1) * cellSize, cellSize, cellSize);
-      QChar color = m_sim->cellColor(x, y);
+      QChar color = m_sim->cellColor(x, y, agent);
       if (!color.isNull()) {
         QColor fill = cellColorFromChar(color);
         if (fill.isValid()) {
@@ -116,7 +143,7 @@ void MazeWidget::drawOverlays(QPainter *painter, const QRectF &bounds) {
         }
       }
 
-      QString text = m_sim->cellText(x, y);
+      QString text = m_sim->cellText(x, y, agent);
       if (!text.isEmpty()) {
         painter->setPen(QColor(60, 60, 60));
         painter->drawText(cell, Qt::AlignCenter, text);
@@ -191,6 +218,7 @@ void MazeWidget::drawMaze(QPainter *painter, const QRectF &bounds) {
   }
 
   if (m_showKnownWalls) {
+    int agent = focusAgent();
     QPen pen;
     pen.setWidth(2);
     pen.setStyle(Qt::DashLine);
@@ -202,7 +230,8 @@ void MazeWidget::drawMaze(QPainter *painter, const QRectF &bounds) {
         qreal top = bottom - cellSize;
 
         for (int d = 0; d < 4; ++d) {
-          WallState state = m_sim->knownWall(x, y, static_cast<Direction>(d));
+          WallState state =
+              m_sim->knownWall(x, y, static_cast<Direction>(d), agent);
           if (state == WallState::Unknown) {
             continue;
           }
@@ -227,14 +256,16 @@ void MazeWidget::drawMaze(QPainter *painter, const QRectF &bounds) {
   }
 }
 
-void MazeWidget::drawMouse(QPainter *painter, const QRectF &bounds) {
+void MazeWidget::drawMouse(QPainter *painter, const QRectF &bounds,
+                           int agent) {
   if (!m_sim || !m_sim->maze()) {
     return;
   }
   int width = m_sim->maze()->width();
   qreal cellSize = bounds.width() / width;
 
-  SemiPosition pos = m_sim->mouse().position();
+  SemiPosition pos = m_sim->position(agent);
+  SemiDirection heading = m_sim->heading(agent);
   qreal cx = bounds.left() + (pos.x / 2.0) * cellSize;
   qreal cy = bounds.bottom() - (pos.y / 2.0) * cellSize;
 
@@ -246,7 +277,7 @@ void MazeWidget::drawMouse(QPainter *painter, const QRectF &bounds) {
   QTransform transform;
   transform.translate(cx, cy);
   qreal angle = 0.0;
-  switch (m_sim->mouse().heading()) {
+  switch (heading) {
     case SemiDirection::North:
       angle = 0;
       break;
@@ -280,23 +311,23 @@ void MazeWidget::drawMouse(QPainter *painter, const QRectF &bounds) {
   }
 
   painter->setPen(Qt::NoPen);
-  painter->setBrush(QColor(224, 122, 95));
+  painter->setBrush(agentColor(agent));
   painter->drawPolygon(rotated);
 
-  if (m_showSensors) {
-    painter->setPen(QPen(QColor(224, 122, 95, 180), 2));
-    QPair<int, int> delta = deltaFor(m_sim->mouse().heading());
+  if (m_showSensors && agent == focusAgent()) {
+    QColor ray = agentColor(agent);
+    ray.setAlpha(180);
+    painter->setPen(QPen(ray, 2));
+    QPair<int, int> delta = deltaFor(heading);
     QPointF front(cx + delta.first * cellSize, cy - delta.second * cellSize);
     painter->drawLine(QPointF(cx, cy), front);
 
-    QPair<int, int> leftDelta =
-        deltaFor(rotateLeft90(m_sim->mouse().heading()));
+    QPair<int, int> leftDelta = deltaFor(rotateLeft90(heading));
     QPointF left(cx + leftDelta.first * cellSize,
                  cy - leftDelta.second * cellSize);
     painter->drawLine(QPointF(cx, cy), left);
 
-    QPair<int, int> rightDelta =
-        deltaFor(rotateRight90(m_sim->mouse().heading()));
+    QPair<int, int> rightDelta = deltaFor(rotateRight90(heading));
     QPointF right(cx + rightDelta.first * cellSize,
                   cy - rightDelta.second * cellSize);
     painter->drawLine(QPointF(cx, cy), right);
@@ -21,6 +21,9 @@ class MazeWidget : public QWidget {
   void setShowDistances(bool enabled);
   void setShowSensors(bool enabled);
   void setEditAction(EditAction action);
+  void setFocusAgent(int agent);
+  int focusAgent() const;
+  static QColor agentColor(int agent);
 
  signals:
   void logMessage(const QString &message);
@@ -37,13 +40,14 @@ class MazeWidget : public QWidget {
   bool m_showDistances = false;
   bool m_showSensors = false;
   EditAction m_editAction = EditAction::None;
+  int m_focusAgent = 0;
 
   QColor wallColor() const;
   QColor knownWallColor(WallState state) const;
   QColor cellColorFromChar(QChar color) const;
 
   void drawMaze(QPainter *painter, const QRectF &bounds);
-  void drawMouse(QPainter *painter, const QRectF &bounds);
+  void drawMouse(QPainter *painter, const QRectF &bounds, int agent);
   void drawOverlays(QPainter *painter, const QRectF &bounds);
 
   bool pickCellAndWall(const QPointF &pos, int *cellX, int *cellY,
@@ -1,13 +1,83 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonObject>
+#include <QPointer>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include <QtMath>
+#include <csignal>
+#include <functional>
 #include <iostream>
 
+#include "controller/BinaryProtocol.h"
+#include "controller/BotPool.h"
+#include "controller/BotProcess.h"
+#include "controller/CommandParser.h"
+#include "controller/CoroutineBot.h"
+#include "controller/HeadlessRunner.h"
+#include "controller/LatencyProfiler.h"
+#include "controller/LineBuffer.h"
+#include "controller/PluginBot.h"
+#include "controller/SessionTrace.h"
+#include "controller/SharedMemoryChannel.h"
+#include "controller/SimController.h"
+#include "controller/SpscQueue.h"
 #include "engine/Maze.h"
 #include "engine/MazeGenerator.h"
 #include "engine/Simulation.h"
+#include "engine/Timeline.h"
+#include "../controller/sdk/hadak_shm.h"
 
+using hadak::BotChannel;
 using hadak::Direction;
+using hadak::KinematicModel;
 using hadak::Maze;
+using hadak::Movement;
 using hadak::MazeGenerator;
+using hadak::ReplayResult;
+using hadak::SimController;
+using hadak::SimTimeline;
 using hadak::Simulation;
+using hadak::TraceRecorder;
+using hadak::TraceReplayer;
+
+class ScriptChannel : public BotChannel {
+ public:
+  void sendLine(const QString &line) override { lines.append(line); }
+
+  QStringList lines;
+};
+
+class FrameChannel : public ScriptChannel {
+ public:
+  bool setBinaryMode(bool enabled) override {
+    binary = enabled;
+    return true;
+  }
+  void sendFrame(const QByteArray &frame) override { frames.append(frame); }
+
+  bool binary = false;
+  QVector<QByteArray> frames;
+};
+
+// Sends one command and ticks the simulation until it is answered.
+static QString ask(SimController *controller, ScriptChannel *channel,
+                   Simulation *sim, TraceRecorder *trace,
+                   const QString &command) {
+  int before = channel->lines.size();
+  controller->enqueueCommand(command);
+  while (channel->lines.size() == before && sim->isMoving()) {
+    sim->advanceOneTick();
+    trace->recordTick(*sim);
+  }
+  return channel->lines.size() > before ? channel->lines.last() : QString();
+}
 
 static bool testNumParsing() {
   QStringList lines = {
@@ -85,7 +155,1196 @@ static bool testGeneratedMazeValid() {
   return true;
 }
 
-int main() {
+// Records a wall-following session and replays the trace.
+static bool recordAndReplay(bool kinematic) {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 7)));
+  if (kinematic) {
+    KinematicModel model;
+    model.maxSpeed = 2.0;
+    model.turn90Time = 0.25;
+    sim.setKinematicModel(model);
+    sim.setKinematicEnabled(true);
+  }
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+
+  TraceRecorder trace;
+  QString path = QDir(QDir::tempPath()).filePath("hadak_trace_test.htrace");
+  QString error;
+  if (!trace.begin(path, sim, &error)) {
+    std::cerr << "Trace begin failed: " << error.toStdString() << "\n";
+    return false;
+  }
+  controller.setRecorder(&trace);
+
+  ask(&controller, &channel, &sim, &trace, "mazeWidth");
+  for (int step = 0; step < 150 && !sim.goalReached(); ++step) {
+    QPair<int, int> cell = sim.position().toCell();
+    controller.enqueueCommand(
+        QString("setText %1 %2 %3").arg(cell.first).arg(cell.second).arg(step));
+    if (ask(&controller, &channel, &sim, &trace, "wallLeft") == "false") {
+      ask(&controller, &channel, &sim, &trace, "turnLeft");
+    } else {
+      for (int turns = 0; turns < 4; ++turns) {
+        if (ask(&controller, &channel, &sim, &trace, "wallFront") == "false") {
+          break;
+        }
+        ask(&controller, &channel, &sim, &trace, "turnRight");
+      }
+    }
+    ask(&controller, &channel, &sim, &trace, "moveForward");
+  }
+  trace.end(sim);
+
+  TraceReplayer replayer;
+  bool loaded = replayer.load(path, &error);
+  QFile::remove(path);
+  if (!loaded) {
+    std::cerr << "Trace load failed: " << error.toStdString() << "\n";
+    return false;
+  }
+  ReplayResult result = replayer.run();
+  if (!result.ok) {
+    std::cerr << "Replay failed" << (kinematic ? " (kinematic)" : "")
+              << ": " << result.error.toStdString() << "\n";
+    return false;
+  }
+  if (result.ticks == 0 || result.responses != channel.lines.size()) {
+    std::cerr << "Replay did not cover the recorded session\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testTraceReplay() {
+  return recordAndReplay(false) && recordAndReplay(true);
+}
+
+static bool testTimelineSeek() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(16, 16, 7)));
+  // Small budget so the interval grows and old frames get trimmed.
+  SimTimeline timeline(64 * 1024);
+  QVector<quint64> hashes;
+  timeline.record(sim);
+  hashes.append(sim.stateHash());
+
+  for (int i = 0; i < 1200; ++i) {
+    sim.setCellText(i % 16, (i / 16) % 16, QString::number(i));
+    if (i % 3 == 0) {
+      sim.requestTurn(i % 2 == 0 ? Movement::TurnLeft90 : Movement::TurnRight45);
+    }
+    do {
+      if (timeline.record(sim)) {
+        hashes.append(sim.stateHash());
+      }
+      if (sim.isMoving()) {
+        sim.advanceOneTick();
+      }
+    } while (sim.isMoving());
+  }
+  if (timeline.record(sim)) {
+    hashes.append(sim.stateHash());
+  }
+  quint64 live = sim.stateHash();
+
+  if (timeline.lastFrame() != hashes.size() - 1) {
+    std::cerr << "Timeline frame count mismatch\n";
+    return false;
+  }
+  if (timeline.firstFrame() == 0 || timeline.checkpointInterval() <= 64 ||
+      timeline.memoryUsage() > timeline.memoryBudget()) {
+    std::cerr << "Timeline did not adapt to its memory budget\n";
+    return false;
+  }
+  for (int frame = timeline.lastFrame(); frame >= timeline.firstFrame();
+       frame -= 7) {
+    if (!timeline.seek(frame, &sim) || sim.stateHash() != hashes[frame]) {
+      std::cerr << "Timeline seek mismatch at frame " << frame << "\n";
+      return false;
+    }
+  }
+  if (timeline.seek(timeline.firstFrame() - 1, &sim)) {
+    std::cerr << "Seek before the retained history should fail\n";
+    return false;
+  }
+  timeline.seek(timeline.lastFrame(), &sim);
+  if (sim.stateHash() != live) {
+    std::cerr << "Timeline did not return to the live frame\n";
+    return false;
+  }
+  return true;
+}
+
+// Left-wall follower that tags each cell it leaves; used to drive one agent.
+static void followLeftWall(SimController *controller, ScriptChannel *channel,
+                           Simulation *sim, int agent, int steps,
+                           bool events = false) {
+  auto send = [&](const QString &command) {
+    int before = channel->lines.size();
+    controller->enqueueCommand(command);
+    while (channel->lines.size() == before && sim->isMoving(agent)) {
+      if (events) {
+        sim->advanceToNextEvent();
+      } else {
+        sim->advanceOneTick();
+      }
+    }
+    return channel->lines.size() > before ? channel->lines.last() : QString();
+  };
+  for (int step = 0; step < steps && !sim->goalReached(agent); ++step) {
+    QPair<int, int> cell = sim->position(agent).toCell();
+    controller->enqueueCommand(
+        QString("setColor %1 %2 G").arg(cell.first).arg(cell.second));
+    if (send("wallLeft") == "false") {
+      send("turnLeft");
+    } else {
+      while (send("wallFront") == "true") {
+        send("turnRight");
+      }
+    }
+    send("moveForward");
+  }
+}
+
+static bool testMultiAgentIndependent() {
+  Simulation solo;
+  solo.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 11)));
+  SimController soloController(&solo);
+  ScriptChannel soloChannel;
+  soloController.attachBot(&soloChannel);
+  followLeftWall(&soloController, &soloChannel, &solo, 0, 40);
+
+  Simulation race;
+  race.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 11)));
+  int agent = race.addAgent();
+  SimController idle(&race);
+  SimController racer(&race);
+  racer.setAgent(agent);
+  ScriptChannel idleChannel;
+  ScriptChannel racerChannel;
+  idle.attachBot(&idleChannel);
+  racer.attachBot(&racerChannel);
+  idle.enqueueCommand("setColor 0 0 R");
+  followLeftWall(&racer, &racerChannel, &race, agent, 40);
+
+  if (race.agentCount() != 2 || agent != 1) {
+    std::cerr << "Expected a second agent\n";
+    return false;
+  }
+  if (race.stateHash(agent) != solo.stateHash() ||
+      racerChannel.lines != soloChannel.lines) {
+    std::cerr << "Racing agent diverged from the solo run\n";
+    return false;
+  }
+  if (race.stepCount(0) != 0 || race.cellColor(0, 0, 0) != QChar('R') ||
+      race.cellColor(0, 0, agent) != QChar('G')) {
+    std::cerr << "Agents leaked state into each other\n";
+    return false;
+  }
+  race.setAgentCount(1);
+  if (race.agentCount() != 1) {
+    std::cerr << "setAgentCount did not drop the racer\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testEventScheduler() {
+  KinematicModel model;
+  if (qAbs(model.moveTime(32, false) - 2.42) > 1e-6 ||
+      qAbs(model.moveTime(2, false) - 2.0 * qSqrt(0.06)) > 1e-6) {
+    std::cerr << "Unexpected trapezoidal segment durations\n";
+    return false;
+  }
+
+  Simulation ticked;
+  Simulation evented;
+  QVector<Simulation *> sims = {&ticked, &evented};
+  for (Simulation *sim : sims) {
+    sim->setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 11)));
+    sim->setKinematicEnabled(true);
+  }
+  SimController tickController(&ticked);
+  SimController eventController(&evented);
+  ScriptChannel tickChannel;
+  ScriptChannel eventChannel;
+  tickController.attachBot(&tickChannel);
+  eventController.attachBot(&eventChannel);
+  followLeftWall(&tickController, &tickChannel, &ticked, 0, 40);
+  followLeftWall(&eventController, &eventChannel, &evented, 0, 40, true);
+
+  if (evented.stateHash() != ticked.stateHash() ||
+      eventChannel.lines != tickChannel.lines) {
+    std::cerr << "Event scheduler diverged from ticking\n";
+    return false;
+  }
+  if (ticked.simTime() <= 0.0 || evented.simTime() != ticked.simTime()) {
+    std::cerr << "Simulated time mismatch\n";
+    return false;
+  }
+
+  // A fresh mouse starts its clock at zero, so its turn completes first.
+  evented.requestTurn(Movement::TurnLeft90);
+  int racer = evented.addAgent();
+  evented.requestTurn(Movement::TurnLeft45, racer);
+  if (evented.advanceToNextEvent() != 1 || evented.isMoving(racer) ||
+      !evented.isMoving(0)) {
+    std::cerr << "Scheduler did not pick the earliest event\n";
+    return false;
+  }
+
+  // Kinematic runs are scored by time: the fastest run plus a tenth of all.
+  hadak::Stats stats;
+  stats.setTimeScored(true);
+  stats.startRun();
+  stats.addDistance(30);
+  stats.addTime(4.0f);
+  stats.finishRun();
+  stats.startRun();
+  stats.addDistance(2);
+  stats.addTime(6.0f);
+  stats.finishRun();
+  if (stats.statValue(hadak::StatId::BestRunTime) != 4.0f ||
+      qAbs(stats.statValue(hadak::StatId::Score) - 5.0f) > 1e-5f) {
+    std::cerr << "Kinematic score ignored time\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testCommandParser() {
+  QByteArray text = "setText  3 4 two  words";
+  hadak::CommandLine line;
+  if (!hadak::parseCommandLine(text.constData(), text.size(), &line) ||
+      line.id != hadak::CommandId::SetText || line.argCount() != 3) {
+    std::cerr << "setText did not tokenize\n";
+    return false;
+  }
+  hadak::CommandToken rest = line.rest(3);
+  if (QByteArray(rest.data, rest.size) != "two  words") {
+    std::cerr << "setText lost its free-form text\n";
+    return false;
+  }
+
+  QByteArray unknown = "wallfront";
+  hadak::StatId stat;
+  int value = 0;
+  if (hadak::parseCommandLine(unknown.constData(), unknown.size(), &line) ||
+      !hadak::statFromName({"best-run-time", 13}, &stat) ||
+      stat != hadak::StatId::BestRunTime ||
+      hadak::statFromName({"scores", 6}, &stat)) {
+    std::cerr << "Name lookup accepted or missed a name\n";
+    return false;
+  }
+  if (!hadak::parseCommandInt({"-2147483648", 11}, &value) ||
+      value != -2147483647 - 1 ||
+      hadak::parseCommandInt({"2147483648", 10}, &value) ||
+      hadak::parseCommandInt({"1x", 2}, &value) ||
+      hadak::parseCommandInt({"-", 1}, &value)) {
+    std::cerr << "Integer parsing is off\n";
+    return false;
+  }
+
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 3)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+  controller.enqueueCommand("setWall 1 1 n");
+  controller.enqueueCommand("setColor 2 2 B");
+  controller.enqueueCommand("getStat  total-turns");
+  controller.enqueueCommand("wallFront 1 2");
+  if (sim.knownWall(1, 2, Direction::South) != hadak::WallState::Wall ||
+      sim.cellColor(2, 2) != QChar('B') ||
+      channel.lines != QStringList({"0"})) {
+    std::cerr << "Controller dispatch mismatch\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testBinaryProtocol() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 5)));
+  SimController controller(&sim);
+  FrameChannel channel;
+  controller.attachBot(&channel);
+
+  controller.enqueueCommand("wallLeft");
+  controller.enqueueCommand(hadak::kBinaryHandshake);
+  if (!channel.binary || !controller.isBinary() || channel.lines.size() != 2 ||
+      channel.lines.at(1) != hadak::kBinaryHandshakeReply) {
+    std::cerr << "Binary handshake failed\n";
+    return false;
+  }
+
+  using hadak::CommandId;
+  QByteArray text = "hi";
+  QByteArray batch =
+      hadak::encodeBinaryRequest(CommandId::WallLeft, 0, 1) +
+      hadak::encodeBinaryRequest(CommandId::SetColor, 'Y', 3, 4) +
+      hadak::encodeBinaryRequest(CommandId::SetText, text.size(), 5, 6) +
+      text + hadak::encodeBinaryRequest(CommandId::MazeWidth, 0, 0);
+  int offset = 0;
+  while (offset < batch.size()) {
+    int size = hadak::binaryRequestSize(batch.constData() + offset,
+                                        batch.size() - offset);
+    controller.enqueueFrame(batch.mid(offset, size));
+    offset += size;
+  }
+
+  auto value = [&](int index) {
+    return qFromLittleEndian<qint32>(channel.frames.at(index).constData() + 4);
+  };
+  bool wallLeft = channel.lines.at(0) == "true";
+  if (channel.frames.size() != 2 || value(0) != (wallLeft ? 1 : 0) ||
+      value(1) != 8 || sim.cellColor(3, 4) != QChar('Y') ||
+      sim.cellText(5, 6) != "hi") {
+    std::cerr << "Binary frames answered differently from text\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testSenseMask() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 9)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+
+  const char *probes[] = {"wallFront",      "wallLeft",      "wallRight",
+                          "wallBack",       "wallFrontLeft", "wallFrontRight",
+                          "wallBackLeft",   "wallBackRight", "isGoal",
+                          "wasReset"};
+  for (int distance = 1; distance <= 2; ++distance) {
+    QString suffix = distance == 1 ? QString() : " " + QString::number(distance);
+    int expected = 0;
+    for (int bit = 0; bit < 10; ++bit) {
+      QString probe = probes[bit];
+      controller.enqueueCommand(bit < 8 ? probe + suffix : probe);
+      if (channel.lines.last() == "true") {
+        expected |= 1 << bit;
+      }
+    }
+    controller.enqueueCommand("sense" + suffix);
+    if (channel.lines.last().toInt() != expected) {
+      std::cerr << "Sense mask " << channel.lines.last().toStdString()
+                << " does not match probes " << expected << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool testPipelinedCommands() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(16, 16, 11)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+
+  controller.enqueueCommand("goalCell 0");
+  const QString goal = channel.lines.takeLast();
+
+  // The whole burst goes in before a single tick runs, as if a bot wrote
+  // it in one go. Each round answers seven lines; setColor answers none.
+  const int rounds = 1000;
+  for (int i = 0; i < rounds; ++i) {
+    controller.enqueueCommand("wallFront");
+    controller.enqueueCommand("moveForward");
+    controller.enqueueCommand(
+        QString("setColor %1 %2 G").arg(i % 16).arg(i / 16 % 16));
+    controller.enqueueCommand("mazeWidth");
+    controller.enqueueCommand(i % 3 == 0 ? "turnRight" : "turnLeft");
+    controller.enqueueCommand("getStat total-turns");
+    controller.enqueueCommand("sense");
+    controller.enqueueCommand("goalCell 0");
+  }
+  int ticks = 0;
+  while (channel.lines.size() < rounds * 7 && ticks < rounds * 100) {
+    sim.advanceOneTick();
+    ++ticks;
+  }
+  if (channel.lines.size() != rounds * 7) {
+    std::cerr << "Pipelined burst answered " << channel.lines.size()
+              << " of " << rounds * 7 << " commands\n";
+    return false;
+  }
+
+  // Answers depend on the state left by the commands before them, so any
+  // reordering shows up as a mismatch.
+  for (int i = 0; i < rounds; ++i) {
+    const QStringList round = channel.lines.mid(i * 7, 7);
+    bool blocked = round.at(0) == "true";
+    if (round.at(1) != (blocked ? "crash" : "ack") || round.at(2) != "16" ||
+        round.at(3) != "ack" || round.at(4) != QString::number(i + 1) ||
+        (round.at(5).toInt() & hadak::SenseFront) !=
+            (i + 1 < rounds && channel.lines.at((i + 1) * 7) == "true") ||
+        round.at(6) != goal) {
+      std::cerr << "Pipelined answers out of order in round " << i << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool testSharedMemoryRing() {
+  hadak::SharedMemoryChannel channel;
+  QString error;
+  if (!channel.create(&error)) {
+    std::cerr << "Shared memory unavailable, skipping: "
+              << error.toStdString() << "\n";
+    return true;
+  }
+  channel.setSpinTime(0);
+  qputenv(hadak::kSharedMemoryEnv, channel.name().toUtf8());
+  if (!hadak_shm_get()) {
+    std::cerr << "Bot side could not map the shared-memory region\n";
+    return false;
+  }
+
+  // Both ends run on this thread: the C client plays the bot and poll()
+  // stands in for the eventfd wakeup. Enough traffic to wrap both rings.
+  QByteArray received;
+  QObject::connect(&channel, &hadak::SharedMemoryChannel::received,
+                   [&](const QByteArray &bytes) { received += bytes; });
+  for (int i = 0; i < 20000; ++i) {
+    QByteArray command = "wallFront " + QByteArray::number(i) + "\n";
+    hadak_shm_write(command.constData(), command.size());
+    channel.poll();
+    if (received != command) {
+      std::cerr << "Shared-memory request " << i << " arrived garbled\n";
+      return false;
+    }
+    received.clear();
+    channel.write(QByteArray::number(i) + "\n");
+    char line[32];
+    if (!hadak_shm_read_line(line, sizeof(line)) ||
+        QByteArray(line) != QByteArray::number(i)) {
+      std::cerr << "Shared-memory reply " << i << " arrived garbled\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool testDirectExecution() {
+  // A plugin's calls must see exactly what a text bot sees.
+  Simulation textSim;
+  textSim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 5)));
+  SimController textController(&textSim);
+  ScriptChannel channel;
+  textController.attachBot(&channel);
+  Simulation directSim;
+  directSim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 5)));
+  SimController directController(&directSim);
+
+  auto direct = [&](hadak::CommandId id, qint32 *value, bool *deferred) {
+    hadak::Command command;
+    bool crashed = false;
+    qint32 extra = 0;
+    return hadak::buildBinaryCommand(static_cast<quint16>(id), 0, 1, 0,
+                                     nullptr, &command) &&
+           directController.executeDirect(command, &crashed, value, &extra,
+                                          deferred);
+  };
+  for (int i = 0; i < 200; ++i) {
+    qint32 walls = 0;
+    bool deferred = false;
+    textController.enqueueCommand("sense");
+    if (!direct(hadak::CommandId::Sense, &walls, &deferred) ||
+        QString::number(walls) != channel.lines.last()) {
+      std::cerr << "Direct sense differs at step " << i << "\n";
+      return false;
+    }
+    bool open = !(walls & hadak::SenseFront);
+    textController.enqueueCommand(open ? "moveForward" : "turnRight");
+    qint32 value = 0;
+    if (!direct(open ? hadak::CommandId::MoveForward
+                     : hadak::CommandId::TurnRight,
+                &value, &deferred) ||
+        !deferred) {
+      std::cerr << "Direct movement did not start at step " << i << "\n";
+      return false;
+    }
+    if (direct(hadak::CommandId::MazeWidth, &value, &deferred)) {
+      std::cerr << "Direct call accepted during a movement\n";
+      return false;
+    }
+    while (textSim.isMoving()) {
+      textSim.advanceToNextEvent();
+    }
+    while (directSim.isMoving()) {
+      directSim.advanceToNextEvent();
+    }
+    if (directController.isWaiting()) {
+      std::cerr << "Direct movement never finished\n";
+      return false;
+    }
+  }
+  if (textSim.position(0).toCell() != directSim.position(0).toCell() ||
+      textSim.stepCount() != directSim.stepCount()) {
+    std::cerr << "Direct run ended somewhere else\n";
+    return false;
+  }
+  return true;
+}
+
+static hadak::BotTask leftWallWalker(hadak::BotMouse &mouse, int *moves) {
+  for (int i = 0; i < 300 && !mouse.isGoal(); ++i) {
+    if (!(mouse.sense() & hadak::SenseLeft)) {
+      co_await mouse.turnLeft();
+    } else {
+      while (mouse.wallFront()) {
+        co_await mouse.turnRight();
+      }
+    }
+    if (!co_await mouse.moveForward()) {
+      co_return;
+    }
+    ++*moves;
+  }
+}
+
+static bool testCoroutineBot() {
+  // Driven tick by tick as in the window: the bot resumes from inside
+  // advanceOneTick whenever its movement ends.
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 21)));
+  SimController controller(&sim);
+  hadak::CoroutineBot bot(&sim, &controller);
+  int moves = 0;
+  bot.start([&](hadak::BotMouse &mouse) {
+    return leftWallWalker(mouse, &moves);
+  });
+  int ticks = 0;
+  while (bot.isRunning() && ticks < 1000000) {
+    sim.advanceOneTick();
+    ++ticks;
+  }
+  if (bot.isRunning() || bot.failed() || moves == 0 ||
+      sim.stepCount() != moves * 2 || sim.collisionCount() != 0) {
+    std::cerr << "Coroutine bot made " << moves << " moves but the mouse took "
+              << sim.stepCount() << " half-steps\n";
+    return false;
+  }
+
+  // Headless, with no event loop at all.
+  hadak::HeadlessRunner runner;
+  int headlessMoves = 0;
+  hadak::MatchResult result = runner.run(
+      *sim.maze(), [&](hadak::BotMouse &mouse) {
+        return leftWallWalker(mouse, &headlessMoves);
+      });
+  if (headlessMoves != moves || result.steps != moves * 2 ||
+      result.commands == 0 || result.status == "tick-limit") {
+    std::cerr << "Headless coroutine run differs: " << headlessMoves
+              << " moves, status " << result.status.toStdString() << "\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testSpscQueue() {
+  // A small queue so the producer keeps running into a full one.
+  hadak::SpscQueue<QByteArray> queue(64);
+  const int count = 200000;
+  QThread *producer = QThread::create([&queue]() {
+    for (int i = 0; i < count; ++i) {
+      QByteArray item = QByteArray::number(i);
+      while (!queue.tryPush(item)) {
+        QThread::yieldCurrentThread();
+      }
+    }
+  });
+  producer->start();
+  QByteArray item;
+  for (int i = 0; i < count; ++i) {
+    while (!queue.tryPop(&item)) {
+      QThread::yieldCurrentThread();
+    }
+    if (item != QByteArray::number(i)) {
+      std::cerr << "SPSC queue returned " << item.constData() << " for " << i
+                << "\n";
+      producer->wait();
+      delete producer;
+      return false;
+    }
+  }
+  producer->wait();
+  delete producer;
+  return queue.isEmpty();
+}
+
+static bool testLineBuffer() {
+  hadak::LineBuffer buffer;
+  buffer.append("moveForward\r\nwall", 17);
+  buffer.append("Front\nstate\n", 12);
+  buffer.append("partial", 7);
+  QByteArray block = buffer.takeLines();
+  QByteArrayView view(block);
+  QByteArrayView line;
+  QList<QByteArray> lines;
+  while (hadak::LineBuffer::splitLine(&view, &line)) {
+    lines.append(line.toByteArray());
+  }
+  QList<QByteArray> expected = {"moveForward", "wallFront", "state"};
+  if (lines != expected) {
+    std::cerr << "Line buffer split " << lines.size() << " lines\n";
+    return false;
+  }
+  buffer.append("\n", 1);
+  if (!buffer.nextLine(&line) || line.toByteArray() != "partial" ||
+      !buffer.isEmpty()) {
+    std::cerr << "Line buffer lost a line split across reads\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testLatencyProfiler() {
+  hadak::LatencyHistogram histogram;
+  for (int i = 1; i <= 1000; ++i) {
+    histogram.add(i * 1000);
+  }
+  qint64 p50 = histogram.percentile(0.5);
+  qint64 p99 = histogram.percentile(0.99);
+  if (qAbs(p50 - 500000) > 500000 / 16 || qAbs(p99 - 990000) > 990000 / 16) {
+    std::cerr << "Latency percentiles off: " << p50 << " " << p99 << "\n";
+    return false;
+  }
+
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 3)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+  hadak::LatencyProfiler profiler;
+  controller.setProfiler(&profiler);
+  controller.enqueueCommand("mazeWidth");
+  controller.enqueueCommand("wallFront");
+  controller.enqueueCommand("wallFront");
+  controller.enqueueCommand("setColor 0 0 R");
+  controller.enqueueCommand("bogus");
+  QJsonObject json = profiler.toJson();
+  if (json.value("wallFront").toObject().value("count").toInt() != 2 ||
+      !json.contains("mazeWidth") || !json.contains("setColor") ||
+      json.contains("bogus")) {
+    std::cerr << "Latency profile missed commands\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testQueueBackpressure() {
+  class PausingChannel : public ScriptChannel {
+   public:
+    void setReadPaused(bool value) override {
+      paused = value;
+      changes += 1;
+    }
+
+    bool paused = false;
+    int changes = 0;
+  };
+
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 5)));
+  SimController controller(&sim);
+  PausingChannel channel;
+  controller.attachBot(&channel);
+  int updates = 0;
+  QObject::connect(&sim, &Simulation::stateChanged, [&updates]() {
+    updates += 1;
+  });
+
+  // A paused run queues everything; the bot is held well before the
+  // queue grows without bound.
+  controller.setPaused(true);
+  for (int i = 0; i < 2000 && !channel.paused; ++i) {
+    controller.enqueueCommand(QString("setText 1 1 %1").arg(i));
+  }
+  if (!channel.paused || !controller.isThrottled() ||
+      controller.queueDepth() > 1024) {
+    std::cerr << "Queue not throttled at depth " << controller.queueDepth()
+              << "\n";
+    return false;
+  }
+  controller.enqueueCommand("mazeWidth");
+
+  // Overlay writes in one batch redraw once and keep the last value.
+  sim.holdOverlayUpdates();
+  controller.setPaused(false);
+  sim.releaseOverlayUpdates();
+  if (channel.paused || channel.changes != 2 || controller.queueDepth() != 0 ||
+      channel.lines.value(0) != "8" || updates != 1 ||
+      sim.cellText(1, 1) != QString::number(1023)) {
+    std::cerr << "Queue did not drain and resume the bot\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testBulkOverlay() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(4, 4, 9)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+  int updates = 0;
+  QObject::connect(&sim, &Simulation::stateChanged, [&updates]() {
+    updates += 1;
+  });
+
+  controller.enqueueCommand("setColorGrid 4. 2R 2G 4. 3B B");
+  controller.enqueueCommand("setTextGrid 3 2 1 0 2*. x 9*.");
+  controller.enqueueCommand("setColorRect 3 3 2 -5 Y");
+  // Short, long and malformed grids change nothing.
+  controller.enqueueCommand("setColorGrid 15R");
+  controller.enqueueCommand("setTextGrid 17*a");
+  controller.enqueueCommand("setColorGrid 16 R");
+  if (updates != 3 || sim.cellColor(0, 1) != 'R' ||
+      sim.cellColor(1, 1) != 'R' || !sim.cellColor(0, 2).isNull() ||
+      sim.cellColor(0, 3) != 'B' ||
+      sim.cellColor(2, 0) != 'Y' || sim.cellColor(3, 3) != 'Y' ||
+      sim.cellColor(1, 3) != 'B' || sim.cellText(0, 0) != "3" ||
+      sim.cellText(3, 0) != "0" || !sim.cellText(1, 1).isEmpty() ||
+      sim.cellText(2, 1) != "x" || !channel.lines.isEmpty()) {
+    std::cerr << "Bulk overlay commands applied wrongly\n";
+    return false;
+  }
+
+  // Grid colors are any setColor takes, several UTF-8 bytes included, but
+  // a character cut short is not one.
+  QVector<QChar> colors;
+  const char utf8[] = "2\xc3\xa9 \xe2\x96\x88 .";
+  const char cut[] = "3\xe2\x96 .";
+  if (!hadak::decodeColorGrid(utf8, sizeof(utf8) - 1, 4, &colors) ||
+      colors.value(1) != QChar(0xe9) || colors.value(2) != QChar(0x2588) ||
+      !colors.value(3).isNull() ||
+      hadak::decodeColorGrid(cut, sizeof(cut) - 1, 4, &colors)) {
+    std::cerr << "Color grid decoded non-ASCII colors wrongly\n";
+    return false;
+  }
+
+  hadak::Command rect;
+  QByteArray frame = hadak::encodeBinaryRequest(
+      hadak::CommandId::SetColorRect, 'K', hadak::packBinaryCell(1, 2),
+      hadak::packBinaryCell(-1, 0));
+  if (!hadak::decodeBinaryRequest(frame.constData(), frame.size(), &rect) ||
+      rect.args[0] != 1 || rect.args[1] != 2 || rect.args[2] != -1 ||
+      rect.args[3] != 0 ||
+      hadak::commandText(rect) != "setColorRect 1 2 -1 0 K") {
+    std::cerr << "setColorRect frame did not round-trip\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testRunPath() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(16, 16, 21)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+  auto run = [&](const QString &command) {
+    int before = channel.lines.size();
+    controller.enqueueCommand(command);
+    for (int ticks = 0; channel.lines.size() == before && ticks < 1000;
+         ++ticks) {
+      sim.advanceOneTick();
+    }
+    return channel.lines.size() > before ? channel.lines.last() : QString();
+  };
+
+  bool blocked = sim.isWallFront(1);
+  hadak::SemiDirection heading = sim.heading();
+  QString first = run("runPath F1");
+  QString turns = run("runPath L45 R45 L R R90 L90");
+  // Four turns put the mouse back on its heading; no maze is 50 cells
+  // long, so the move crashes.
+  QString crash = run("runPath R R R R F50 L F1");
+  // Counts whose half-steps overflow an int crash like any other.
+  QString far = run("runPath F2000000000 D2147483647");
+  QString invalid = run("runPath F0 R30");
+  if (first != (blocked ? "crash 0" : "ack") || turns != "ack" ||
+      crash != "crash 4" || far != "crash 0" || !invalid.isEmpty() ||
+      sim.heading() != heading || sim.isMoving()) {
+    std::cerr << "runPath answered " << first.toStdString() << ", "
+              << turns.toStdString() << ", " << crash.toStdString() << ", "
+              << far.toStdString() << "\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testKnownPlanner() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(16, 16, 22)));
+  sim.setGoalCell(7, 7);
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+  auto ask = [&](const QString &command) {
+    int before = channel.lines.size();
+    controller.enqueueCommand(command);
+    return channel.lines.size() > before ? channel.lines.last() : QString();
+  };
+
+  // Nothing declared yet: the real maze is not consulted.
+  QString open = ask("floodKnown 0 0");
+  QString ahead = ask("nextMoveKnown");
+  controller.enqueueCommand("setWall 0 0 n");
+  QString around = ask("nextMoveKnown");
+  QString detour = ask("floodKnown 0 0");
+  QString goal = ask("floodKnown 7 7");
+  controller.enqueueCommand("setWall 15 15 w");
+  controller.enqueueCommand("setWall 15 14 n");
+  QString cut = ask("floodKnown 15 15");
+  if (open != "14" || ahead != "n" || around != "e" || detour != "14" ||
+      goal != "0" || cut != "-1") {
+    std::cerr << "Planner answered " << open.toStdString() << ", "
+              << ahead.toStdString() << ", " << around.toStdString() << ", "
+              << detour.toStdString() << ", " << goal.toStdString() << ", "
+              << cut.toStdString() << "\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testPushSense() {
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(16, 16, 23)));
+  SimController controller(&sim);
+  ScriptChannel channel;
+  controller.attachBot(&channel);
+  auto run = [&](const QString &command) {
+    int before = channel.lines.size();
+    controller.enqueueCommand(command);
+    for (int ticks = 0; channel.lines.size() == before && ticks < 1000;
+         ++ticks) {
+      sim.advanceOneTick();
+    }
+    return channel.lines.size() > before ? channel.lines.last() : QString();
+  };
+
+  QString on = run("pushSense 1");
+  QStringList turned = run("turnRight").split(' ');
+  QString sensed = run("sense");
+  QString path = run("runPath L");
+  run("pushSense 0");
+  QString plain = run("turnLeft");
+  if (on != "true" || turned.size() != 5 || turned[0] != "ack" ||
+      turned[1] != sensed || turned.mid(2) != QStringList({"0", "0", "e"}) ||
+      !path.startsWith("ack ") || !path.endsWith(" 0 0 n") ||
+      plain != "ack") {
+    std::cerr << "Push mode answered " << turned.join(' ').toStdString()
+              << ", " << path.toStdString() << ", " << plain.toStdString()
+              << "\n";
+    return false;
+  }
+  return true;
+}
+
+static bool testBotExitReasons() {
+#ifdef Q_OS_UNIX
+  std::unique_ptr<Maze> maze(MazeGenerator::generate(8, 8, 1));
+  hadak::MatchLimits limits;
+  limits.timeoutMs = 10000;
+  limits.memoryBytes = 256LL * 1024 * 1024;
+  hadak::HeadlessRunner runner;
+  runner.setLimits(limits);
+
+  // Dies on its first allocation, long before memory is sampled.
+  hadak::MatchResult greedy = runner.run(
+      *maze, "python3 -c \"bytearray(1 << 30)\"", QDir::currentPath());
+  if (greedy.status != "memory-limit") {
+    std::cerr << "Over-limit allocation ended as "
+              << greedy.status.toStdString() << " ("
+              << greedy.reason.toStdString() << ")\n";
+    return false;
+  }
+  hadak::MatchResult failed = runner.run(
+      *maze, "python3 -c \"raise SystemExit(3)\"", QDir::currentPath());
+  if (failed.status != "exited" || !failed.reason.contains("code 3")) {
+    std::cerr << "Bad exit ended as " << failed.status.toStdString() << " ("
+              << failed.reason.toStdString() << ")\n";
+    return false;
+  }
+  hadak::MatchResult killed = runner.run(
+      *maze, "python3 -c \"import os; os.abort()\"", QDir::currentPath());
+  if (killed.status != "exited" ||
+      !killed.reason.contains(QString("signal %1").arg(SIGABRT))) {
+    std::cerr << "Crash ended as " << killed.status.toStdString() << " ("
+              << killed.reason.toStdString() << ")\n";
+    return false;
+  }
+#endif
+  return true;
+}
+
+// A bot that never reads its stdin while it writes a flood of requests:
+// its replies back up behind it, and neither the simulator nor the bot
+// may stall on that.
+static bool testBotFlood() {
+#ifdef Q_OS_UNIX
+  std::unique_ptr<Maze> maze(MazeGenerator::generate(8, 8, 1));
+  hadak::MatchLimits limits;
+  limits.timeoutMs = 30000;
+  hadak::HeadlessRunner runner;
+  runner.setLimits(limits);
+  const int requests = 200000;
+  hadak::MatchResult result = runner.run(
+      *maze,
+      QString("python3 -c \"import sys; "
+              "sys.stdout.write('mazeWidth\\n' * %1)\"")
+          .arg(requests),
+      QDir::currentPath());
+  if (result.status != "exited" || result.commands != requests) {
+    std::cerr << "Flooding bot ended as " << result.status.toStdString()
+              << " after " << result.commands << " of " << requests
+              << " requests\n";
+    return false;
+  }
+#endif
+  return true;
+}
+
+// Turns the event loop until done() holds, for up to five seconds.
+static bool turnEventLoopUntil(const std::function<bool()> &done) {
+  QElapsedTimer clock;
+  clock.start();
+  while (!done() && clock.elapsed() < 5000) {
+    QCoreApplication::processEvents();
+    QThread::msleep(5);
+  }
+  return done();
+}
+
+static bool testBotPool() {
+#ifdef Q_OS_UNIX
+  hadak::BotPool pool;
+  pool.setSize(2);
+  hadak::BotLaunch launch;
+  launch.command = "sleep 30";
+  launch.workingDir = QDir::currentPath();
+  QString error;
+
+  // The first run has nothing to take; the spares follow it.
+  hadak::BotSpawn first;
+  if (!pool.take(launch, &first, &error) || pool.idleCount() != 0 ||
+      !turnEventLoopUntil([&]() { return pool.idleCount() == 2; })) {
+    std::cerr << "Pool did not refill behind its first run: "
+              << error.toStdString() << "\n";
+    return false;
+  }
+
+  // An idle process still belongs to the pool when it is handed out.
+  hadak::BotSpawn second;
+  if (!pool.take(launch, &second, &error) ||
+      second.process->parent() != &pool ||
+      second.process->state() != QProcess::Running ||
+      pool.idleCount() != 1 ||
+      !turnEventLoopUntil([&]() { return pool.idleCount() == 2; })) {
+    std::cerr << "Pool did not hand out a started spare\n";
+    return false;
+  }
+
+  // Retiring returns at once and the process is reaped from the loop.
+  QPointer<QProcess> retired = second.process;
+  qint64 pid = retired->processId();
+  QElapsedTimer clock;
+  clock.start();
+  hadak::BotPool::retire(&second);
+  if (clock.elapsed() > 100 || retired.isNull() || second.process ||
+      !turnEventLoopUntil([&]() { return retired.isNull(); }) ||
+      ::kill(static_cast<pid_t>(pid), 0) == 0) {
+    std::cerr << "Retiring a bot blocked or did not reap it\n";
+    return false;
+  }
+
+  // A different launch discards the spares of the old one.
+  QList<QPointer<QProcess>> stale;
+  for (QProcess *process : pool.findChildren<QProcess *>()) {
+    stale.append(process);
+  }
+  launch.command = "sleep 31";
+  hadak::BotSpawn third;
+  bool took = pool.take(launch, &third, &error);
+  bool fresh = took && third.process->parent() == nullptr;
+  bool discarded = turnEventLoopUntil([&]() {
+    for (const QPointer<QProcess> &process : stale) {
+      if (!process.isNull()) {
+        return false;
+      }
+    }
+    return true;
+  });
+  hadak::BotPool::retire(&first);
+  hadak::BotPool::retire(&third);
+  if (stale.size() != 2 || !fresh || !discarded) {
+    std::cerr << "Pool kept " << stale.size()
+              << " spares of an old launch\n";
+    return false;
+  }
+#endif
+  return true;
+}
+
+// A bot server for two runs that takes its time over each "ready".
+const char kTwoRunServer[] = R"(
+import socket, sys, time
+server = socket.socket(socket.AF_UNIX)
+server.bind(sys.argv[1])
+server.listen(1)
+for run in range(2):
+    conn, _ = server.accept()
+    stream = conn.makefile('rb')
+    if stream.readline() != b'newRun\n':
+        sys.exit(1)
+    time.sleep(0.3)
+    conn.sendall(b'ready\nmazeWidth\n')
+    stream.readline()
+    stream.close()
+    conn.close()
+)";
+
+static bool testBotServer() {
+#ifdef Q_OS_UNIX
+  QTemporaryDir dir;
+  QString path = dir.filePath("bot.sock");
+  QProcess server;
+  server.start("python3", {"-c", kTwoRunServer, path});
+  if (!server.waitForStarted()) {
+    std::cerr << "No python3; skipping the bot server test\n";
+    return true;
+  }
+  for (int i = 0; i < 500 && !QFile::exists(path); ++i) {
+    QThread::msleep(10);
+  }
+  QString command = QString(hadak::kBotSocketPrefix) + path;
+
+  std::unique_ptr<Maze> maze(MazeGenerator::generate(8, 8, 1));
+  hadak::MatchResult result =
+      hadak::HeadlessRunner().run(*maze, command, QDir::currentPath());
+  if (result.status != "exited" || result.commands != 1) {
+    std::cerr << "First server run ended as " << result.status.toStdString()
+              << ": " << result.reason.toStdString() << "\n";
+    return false;
+  }
+
+  // The second run on the same server, watched from start() on: it must
+  // come back before the server is ready, with the request to follow.
+  hadak::BotProcess bot;
+  QEventLoop loop;
+  QByteArray request;
+  QObject::connect(&bot, &hadak::BotProcess::commandReceived, &loop,
+                   [&](QByteArrayView line) {
+                     request = line.toByteArray();
+                     bot.sendLine("8");
+                   });
+  QObject::connect(&bot, &hadak::BotProcess::finished, &loop,
+                   &QEventLoop::quit);
+  QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+  QElapsedTimer clock;
+  clock.start();
+  bool started = bot.start(command, QDir::currentPath());
+  qint64 startMs = clock.elapsed();
+  if (started) {
+    loop.exec();
+  }
+  bot.stop();
+  bool served = server.waitForFinished(5000) && server.exitCode() == 0;
+  server.kill();
+  if (!started || startMs >= 300 || request != "mazeWidth" || !served) {
+    std::cerr << "Second server run: started " << started << " in "
+              << startMs << " ms, got '" << request.constData()
+              << "', server done " << served << "\n";
+    return false;
+  }
+#endif
+  return true;
+}
+
+// Just enough of hadak_plugin.h to try both ways of sending a grid.
+const char kPayloadPlugin[] = R"(
+#include <stdint.h>
+#include <stdio.h>
+
+struct hadak_api {
+  uint32_t abi;
+  void *sim;
+  int (*call)(void *, uint16_t, uint16_t, int32_t, int32_t, int32_t *,
+              int32_t *);
+  int (*set_text)(void *, int32_t, int32_t, const char *);
+  int (*last_move)(void *);
+  void (*log)(void *, const char *);
+  int (*call_payload)(void *, uint16_t, int32_t, int32_t, const char *,
+                      uint16_t, int32_t *, int32_t *);
+};
+
+uint32_t hadak_bot_abi(void) { return 2; }
+void *hadak_bot_create(const struct hadak_api *api) { return api->sim; }
+void hadak_bot_destroy(void *ctx) { (void)ctx; }
+
+int hadak_bot_step(void *ctx, const struct hadak_api *api) {
+  char results[32];
+  int framed = api->call(api->sim, 32, 3, 0, 0, NULL, NULL);
+  int sent = api->call_payload(api->sim, 32, 0, 0, "64R", 3, NULL, NULL);
+  (void)ctx;
+  snprintf(results, sizeof(results), "%d %d", framed, sent);
+  api->log(api->sim, results);
+  return 1;
+}
+)";
+
+static bool testPluginPayloads() {
+#ifdef Q_OS_LINUX
+  QTemporaryDir dir;
+  QFile source(dir.filePath("payload.c"));
+  if (!dir.isValid() || !source.open(QIODevice::WriteOnly)) {
+    std::cerr << "No room to build a test plugin\n";
+    return false;
+  }
+  source.write(kPayloadPlugin);
+  source.close();
+  QString library = dir.filePath("payload.so");
+  int built = QProcess::execute(
+      "cc", {"-shared", "-fPIC", "-o", library, source.fileName()});
+  if (built == -2) {
+    std::cerr << "No C compiler; plugin payloads not tested\n";
+    return true;
+  }
+  hadak::PluginBot plugin;
+  QString error;
+  if (built != 0 || !plugin.load(library, &error)) {
+    std::cerr << "Test plugin did not build or load: "
+              << error.toStdString() << "\n";
+    return false;
+  }
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(8, 8, 3)));
+  SimController controller(&sim);
+  plugin.attach(&sim, &controller);
+  QStringList log;
+  QObject::connect(&plugin, &hadak::PluginBot::logReceived,
+                   [&log](const QString &line) { log.append(line); });
+  // call() refuses the grid whose bytes it has no way to find.
+  if (plugin.step() || log != QStringList{"4 0"} ||
+      sim.cellColor(0, 0) != 'R' || sim.cellColor(7, 7) != 'R') {
+    std::cerr << "Plugin grid calls answered "
+              << log.join(", ").toStdString() << "\n";
+    return false;
+  }
+#endif
+  return true;
+}
+
+int main(int argc, char *argv[]) {
   int failures = 0;
   if (!testNumParsing()) {
     failures++;
@@ -99,6 +1358,81 @@ int main() {
   if (!testGeneratedMazeValid()) {
     failures++;
   }
+  if (!testTraceReplay()) {
+    failures++;
+  }
+  if (!testTimelineSeek()) {
+    failures++;
+  }
+  if (!testMultiAgentIndependent()) {
+    failures++;
+  }
+  if (!testEventScheduler()) {
+    failures++;
+  }
+  if (!testCommandParser()) {
+    failures++;
+  }
+  if (!testBinaryProtocol()) {
+    failures++;
+  }
+  if (!testSenseMask()) {
+    failures++;
+  }
+  if (!testPipelinedCommands()) {
+    failures++;
+  }
+  if (!testSharedMemoryRing()) {
+    failures++;
+  }
+  if (!testDirectExecution()) {
+    failures++;
+  }
+  if (!testCoroutineBot()) {
+    failures++;
+  }
+  if (!testSpscQueue()) {
+    failures++;
+  }
+  if (!testLineBuffer()) {
+    failures++;
+  }
+  if (!testLatencyProfiler()) {
+    failures++;
+  }
+  if (!testQueueBackpressure()) {
+    failures++;
+  }
+  if (!testBulkOverlay()) {
+    failures++;
+  }
+  if (!testRunPath()) {
+    failures++;
+  }
+  if (!testKnownPlanner()) {
+    failures++;
+  }
+  if (!testPushSense()) {
+    failures++;
+  }
+
+  // Bot processes need an event loop, which the tests above must not have.
+  QCoreApplication app(argc, argv);
+  if (!testBotExitReasons()) {
+    failures++;
+  }
+  if (!testBotFlood()) {
+    failures++;
+  }
+  if (!testBotServer()) {
+    failures++;
+  }
+  if (!testBotPool()) {
+    failures++;
+  }
+  if (!testPluginPayloads()) {
+    failures++;
+  }
 
   if (failures == 0) {
     std::cout << "All tests passed\n";
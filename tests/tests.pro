@@ -1,6 +1,6 @@
-QT += core
+QT += core network
 TEMPLATE = app
-CONFIG += c++17 console
+CONFIG += c++20 console
 CONFIG -= app_bundle
 
 SOURCES += $$files($$PWD/*.cpp)
@@ -9,9 +9,14 @@ HEADERS += $$files($$PWD/*.h)
 INCLUDEPATH += $$PWD/../src
 INCLUDEPATH += $$PWD/../src/engine
 
-# Pull engine sources directly into the test binary.
+# Pull engine and controller sources directly into the test binary.
 SOURCES += $$files($$PWD/../src/engine/*.cpp)
 HEADERS += $$files($$PWD/../src/engine/*.h)
+SOURCES += $$files($$PWD/../src/controller/*.cpp)
+HEADERS += $$files($$PWD/../src/controller/*.h)
+
+# shm_open lives in librt on glibc before 2.34.
+linux: LIBS += -lrt
 
 DESTDIR = ../bin
 OBJECTS_DIR = ../build/tests-obj
@@ -0,0 +1,21 @@
+QT += core network
+TEMPLATE = app
+CONFIG += c++20 console
+CONFIG -= app_bundle
+TARGET = dispatchbench
+
+SOURCES += $$PWD/main.cpp
+
+INCLUDEPATH += $$PWD/../../src
+
+SOURCES += $$files($$PWD/../../src/engine/*.cpp)
+HEADERS += $$files($$PWD/../../src/engine/*.h)
+SOURCES += $$files($$PWD/../../src/controller/*.cpp)
+HEADERS += $$files($$PWD/../../src/controller/*.h)
+
+# shm_open lives in librt on glibc before 2.34.
+linux: LIBS += -lrt
+
+DESTDIR = ../../bin
+OBJECTS_DIR = ../../build/dispatchbench-obj
+MOC_DIR = ../../build/dispatchbench-moc
@@ -0,0 +1,191 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <iostream>
+#include <memory>
+
+#include "controller/BotChannel.h"
+#include "controller/CommandParser.h"
+#include "controller/SimController.h"
+#include "engine/MazeGenerator.h"
+#include "engine/Simulation.h"
+
+using hadak::BotChannel;
+using hadak::CommandLine;
+using hadak::Maze;
+using hadak::MazeGenerator;
+using hadak::SimController;
+using hadak::Simulation;
+using hadak::StatId;
+
+namespace {
+
+class CountingChannel : public BotChannel {
+ public:
+  void sendLine(const QString &line) override { bytes += line.size(); }
+
+  qint64 bytes = 0;
+};
+
+// The mix a sensor-heavy bot sends between moves: wall probes, overlay
+// writes and the odd stat query. None of them start a movement, so every
+// line is answered straight away.
+QStringList commandCorpus() {
+  QStringList corpus;
+  for (int i = 0; i < 64; ++i) {
+    int x = i % 16;
+    int y = (i / 4) % 16;
+    corpus << "wallFront" << QString("wallLeft %1").arg(1 + i % 3)
+           << "wallRight" << QString("wallFrontLeft %1").arg(1 + i % 2)
+           << QString("setColor %1 %2 G").arg(x).arg(y)
+           << QString("setText %1 %2 %3").arg(x).arg(y).arg(i)
+           << QString("setWall %1 %2 n").arg(x).arg(y)
+           << "getStat score" << "isGoal" << "mazeWidth";
+  }
+  return corpus;
+}
+
+const QStringList kLegacyCommands = {
+    "mazeWidth",      "mazeHeight",    "goalCount",      "goalCell",
+    "isGoal",         "wallFront",     "wallRight",      "wallLeft",
+    "wallBack",       "wallFrontRight", "wallFrontLeft", "wallBackRight",
+    "wallBackLeft",   "moveForward",   "moveForwardHalf", "turnRight",
+    "turnRight90",    "turnLeft",      "turnLeft90",     "turnRight45",
+    "turnLeft45",     "setWall",       "clearWall",      "setColor",
+    "clearColor",     "clearAllColor", "setText",        "clearText",
+    "clearAllText",   "wasReset",      "ackReset",       "getStat",
+};
+
+const QStringList kLegacyStats = {
+    "total-distance",           "total-turns",
+    "best-run-distance",        "best-run-turns",
+    "current-run-distance",     "current-run-turns",
+    "total-effective-distance", "best-run-effective-distance",
+    "current-run-effective-distance", "total-time",
+    "best-run-time",            "current-run-time",
+    "score",
+};
+
+// What processCommand used to do before touching the simulation: split
+// into a QStringList, walk the == chain and toInt every argument.
+qint64 legacyParse(const QString &command) {
+  QStringList tokens = command.split(" ", Qt::SkipEmptyParts);
+  if (tokens.isEmpty()) {
+    return 0;
+  }
+  qint64 sum = 0;
+  for (int i = 0; i < kLegacyCommands.size(); ++i) {
+    if (tokens.at(0) == kLegacyCommands.at(i)) {
+      sum += i + 1;
+      break;
+    }
+  }
+  if (tokens.at(0) == "getStat" && tokens.size() == 2) {
+    for (int i = 0; i < kLegacyStats.size(); ++i) {
+      if (tokens.at(1) == kLegacyStats.at(i)) {
+        sum += i;
+        break;
+      }
+    }
+  } else {
+    for (int i = 1; i < tokens.size(); ++i) {
+      sum += tokens.at(i).toInt();
+    }
+  }
+  return sum;
+}
+
+qint64 currentParse(const QByteArray &command) {
+  CommandLine line;
+  if (!hadak::parseCommandLine(command.constData(), command.size(), &line)) {
+    return 0;
+  }
+  qint64 sum = static_cast<int>(line.id);
+  if (line.id == hadak::CommandId::GetStat && line.argCount() == 1) {
+    StatId stat;
+    if (hadak::statFromName(line.arg(0), &stat)) {
+      sum += static_cast<int>(stat);
+    }
+  } else {
+    for (int i = 0; i < line.argCount() && i + 1 < hadak::kMaxCommandTokens;
+         ++i) {
+      int value = 0;
+      if (hadak::parseCommandInt(line.arg(i), &value)) {
+        sum += value;
+      }
+    }
+  }
+  return sum;
+}
+
+void report(const char *label, qint64 commands, qint64 elapsedNs) {
+  double seconds = elapsedNs / 1e9;
+  std::cout << label << ": " << commands << " commands in " << seconds
+            << " s (" << (seconds > 0.0 ? commands / seconds : 0.0)
+            << " commands/s)\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QStringList args = app.arguments();
+  int rounds = 2000;
+  if (args.size() > 1) {
+    rounds = qMax(1, args.at(1).toInt());
+  }
+
+  QStringList corpus = commandCorpus();
+  QVector<QByteArray> corpusBytes;
+  for (const QString &command : corpus) {
+    corpusBytes.append(command.toUtf8());
+  }
+  qint64 commands = static_cast<qint64>(corpus.size()) * rounds;
+  QElapsedTimer timer;
+
+  // The checksums keep the compiler from discarding either loop.
+  qint64 legacySum = 0;
+  timer.start();
+  for (int round = 0; round < rounds; ++round) {
+    for (const QString &command : corpus) {
+      legacySum += legacyParse(command);
+    }
+  }
+  report("parse, split + compare chain", commands, timer.nsecsElapsed());
+
+  qint64 currentSum = 0;
+  timer.restart();
+  for (int round = 0; round < rounds; ++round) {
+    for (const QByteArray &command : corpusBytes) {
+      currentSum += currentParse(command);
+    }
+  }
+  report("parse, in-place + perfect hash", commands, timer.nsecsElapsed());
+
+  Simulation sim;
+  sim.setMaze(std::unique_ptr<Maze>(MazeGenerator::generate(16, 16, 1)));
+  SimController controller(&sim);
+  CountingChannel channel;
+  controller.attachBot(&channel);
+  timer.restart();
+  for (int round = 0; round < rounds; ++round) {
+    for (const QString &command : corpus) {
+      controller.enqueueCommand(command);
+    }
+  }
+  report("dispatch, SimController end to end", commands,
+         timer.nsecsElapsed());
+
+  timer.restart();
+  for (int round = 0; round < rounds; ++round) {
+    for (const QByteArray &command : corpusBytes) {
+      controller.enqueueLine(command);
+    }
+  }
+  report("dispatch, SimController from bot bytes", commands,
+         timer.nsecsElapsed());
+
+  std::cout << "checksums " << legacySum << " " << currentSum << " "
+            << channel.bytes << "\n";
+  return 0;
+}
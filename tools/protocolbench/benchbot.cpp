@@ -0,0 +1,114 @@
+// The bot protocolbench drives: a fixed mix of sensor queries, overlay
+// writes and movements, each answered command timed from send to answer.
+//
+//   benchbot ROUNDS REPORT [--text]
+//
+// On exit it writes one line to REPORT: the answered commands, the round
+// trip p50, p90, p99 and maximum in ns, then its own user and system CPU
+// time in microseconds.
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hadak_client.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Cell ahead for each SemiDirection the mouse can face after 90 degree
+// turns.
+const int kAheadX[] = {1, 0, 0, 0, -1, 0, 0, 0};
+const int kAheadY[] = {0, 0, 1, 0, 0, 0, -1, 0};
+
+long long micros(const timeval &time) {
+  return static_cast<long long>(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::fprintf(stderr, "usage: benchbot ROUNDS REPORT [--text]\n");
+    return 2;
+  }
+  int rounds = std::max(1, std::atoi(argv[1]));
+  bool binary = !(argc > 3 && std::strcmp(argv[3], "--text") == 0);
+  hadak::BotClient mouse(binary);
+
+  std::vector<long long> samples;
+  samples.reserve(static_cast<size_t>(rounds) * 5 + 16);
+  auto timed = [&](auto &&request) {
+    Clock::time_point sent = Clock::now();
+    hadak::BotAnswer answer = request();
+    samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          Clock::now() - sent)
+                          .count());
+    return answer;
+  };
+
+  int width = mouse.mazeWidth().value;
+  int height = mouse.mazeHeight().value;
+  // The mouse never enters a goal, which would end the match early.
+  std::set<std::pair<int, int>> goals;
+  int goalCount = mouse.goalCount().value;
+  for (int i = 0; i < goalCount; ++i) {
+    hadak::BotAnswer goal = mouse.goalCell(i);
+    goals.insert({goal.value, goal.extra});
+  }
+  mouse.pushSense(true);
+
+  int x = 0;
+  int y = 0;
+  int heading = 2;
+  int walls = timed([&] { return mouse.sense(); }).value;
+  for (int round = 0; round < rounds; ++round) {
+    timed([&] { return mouse.wallLeft(); });
+    timed([&] { return mouse.wallRight(2); });
+    timed([&] { return mouse.isGoal(); });
+    mouse.setColor(x, y, round % 2 ? 'G' : 'B');
+    mouse.setText(x, y, std::to_string(round % 100));
+
+    int ax = x + kAheadX[heading];
+    int ay = y + kAheadY[heading];
+    bool open = !(walls & HADAK_SENSE_FRONT) && ax >= 0 && ay >= 0 &&
+                ax < width && ay < height && !goals.count({ax, ay});
+    hadak::BotAnswer moved = timed([&] {
+      return open ? mouse.moveForward() : mouse.turnRight();
+    });
+    walls = moved.value & ((1 << HADAK_PUSH_HEADING_SHIFT) - 1);
+    heading = (moved.value >> HADAK_PUSH_HEADING_SHIFT) & 7;
+    x = moved.extra & 0xffff;
+    y = moved.extra >> 16;
+    if (round % 8 == 7) {
+      walls = timed([&] { return mouse.sense(); }).value;
+    }
+  }
+  mouse.flush();
+
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&](double fraction) {
+    size_t index = static_cast<size_t>(fraction * (samples.size() - 1));
+    return samples[index];
+  };
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  FILE *report = std::fopen(argv[2], "w");
+  if (!report) {
+    return 1;
+  }
+  std::fprintf(report, "%zu %lld %lld %lld %lld %lld %lld\n", samples.size(),
+               percentile(0.5), percentile(0.9), percentile(0.99),
+               samples.back(), micros(usage.ru_utime),
+               micros(usage.ru_stime));
+  std::fclose(report);
+  return 0;
+}
@@ -0,0 +1,14 @@
+# A plain C++ bot on controller/sdk/hadak_client.hpp; no Qt.
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= app_bundle qt
+TARGET = benchbot
+
+SOURCES += $$PWD/benchbot.cpp
+
+INCLUDEPATH += $$PWD/../../controller/sdk
+
+linux: LIBS += -lrt
+
+DESTDIR = ../../bin
+OBJECTS_DIR = ../../build/benchbot-obj
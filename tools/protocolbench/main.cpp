@@ -0,0 +1,149 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <sys/resource.h>
+
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include "controller/HeadlessRunner.h"
+#include "engine/Maze.h"
+#include "engine/MazeGenerator.h"
+
+using hadak::HeadlessRunner;
+using hadak::MatchLimits;
+using hadak::MatchResult;
+using hadak::Maze;
+using hadak::MazeGenerator;
+
+namespace {
+
+// What benchbot writes when it is done.
+struct BotReport {
+  qint64 answered = 0;
+  qint64 p50 = 0;
+  qint64 p90 = 0;
+  qint64 p99 = 0;
+  qint64 max = 0;
+  qint64 userUs = 0;
+  qint64 systemUs = 0;
+};
+
+bool readReport(const QString &path, BotReport *report) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QStringList fields =
+      QString::fromUtf8(file.readAll()).split(' ', Qt::SkipEmptyParts);
+  if (fields.size() != 7) {
+    return false;
+  }
+  qint64 *targets[] = {&report->answered, &report->p50,    &report->p90,
+                       &report->p99,      &report->max,    &report->userUs,
+                       &report->systemUs};
+  for (int i = 0; i < fields.size(); ++i) {
+    *targets[i] = fields.at(i).trimmed().toLongLong();
+  }
+  return true;
+}
+
+qint64 micros(const timeval &time) {
+  return static_cast<qint64>(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+// CPU time of this process: the simulator side, I/O thread included.
+qint64 cpuMicros() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return micros(usage.ru_utime) + micros(usage.ru_stime);
+}
+
+struct BenchCase {
+  const char *label;
+  bool text;
+  bool sharedMemory;
+};
+
+const BenchCase kCases[] = {
+    {"text, pipes", true, false},
+    {"binary, pipes", false, false},
+    {"text, shared memory", true, true},
+    {"binary, shared memory", false, true},
+};
+
+bool runCase(const BenchCase &bench, int rounds, const Maze &maze,
+             const QString &botPath, const QString &reportPath) {
+  MatchLimits limits;
+  limits.timeoutMs = 600000;
+  limits.maxTicks = std::numeric_limits<qint64>::max();
+  HeadlessRunner runner;
+  runner.setLimits(limits);
+  runner.setSharedMemory(bench.sharedMemory);
+
+  QFile::remove(reportPath);
+  QString command = QString("\"%1\" %2 \"%3\"")
+                        .arg(botPath)
+                        .arg(rounds)
+                        .arg(reportPath);
+  if (bench.text) {
+    command += " --text";
+  }
+  qint64 cpuBefore = cpuMicros();
+  MatchResult result = runner.run(maze, command, QDir::currentPath());
+  qint64 simCpuUs = cpuMicros() - cpuBefore;
+
+  BotReport bot;
+  if (result.status != "exited" || !readReport(reportPath, &bot)) {
+    std::cerr << bench.label << ": bot run failed ("
+              << result.status.toStdString() << " "
+              << result.reason.toStdString() << ")\n";
+    return false;
+  }
+  double seconds = qMax<qint64>(1, result.elapsedMs) / 1000.0;
+  double botCpu = (bot.userUs + bot.systemUs) / 1e6;
+  std::cout << bench.label << ": " << result.commands
+            << " commands in " << seconds << " s ("
+            << result.commands / seconds << " commands/s)\n"
+            << "  round trip us: p50 " << bot.p50 / 1000.0 << ", p90 "
+            << bot.p90 / 1000.0 << ", p99 " << bot.p99 / 1000.0 << ", max "
+            << bot.max / 1000.0 << " (" << bot.answered << " answered)\n"
+            << "  cpu s: simulator " << simCpuUs / 1e6 << " ("
+            << 100.0 * simCpuUs / 1e6 / seconds << "%), bot " << botCpu
+            << " (" << 100.0 * botCpu / seconds << "%)\n";
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QStringList args = app.arguments();
+  int rounds = 20000;
+  if (args.size() > 1) {
+    rounds = qMax(1, args.at(1).toInt());
+  }
+
+  QString botPath = QDir(app.applicationDirPath()).filePath("benchbot");
+  if (!QFile::exists(botPath)) {
+    std::cerr << "benchbot not found next to protocolbench\n";
+    return 1;
+  }
+  QTemporaryDir scratch;
+  if (!scratch.isValid()) {
+    std::cerr << "No temporary directory for the bot's report\n";
+    return 1;
+  }
+  QString reportPath = scratch.filePath("benchbot.report");
+  std::unique_ptr<Maze> maze(MazeGenerator::generate(16, 16, 1));
+
+  std::cout << rounds << " rounds of benchbot's mix per transport\n";
+  bool ok = true;
+  for (const BenchCase &bench : kCases) {
+    ok = runCase(bench, rounds, *maze, botPath, reportPath) && ok;
+  }
+  return ok ? 0 : 1;
+}
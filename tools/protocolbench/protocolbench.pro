@@ -0,0 +1,22 @@
+QT += core network
+TEMPLATE = app
+CONFIG += c++20 console
+CONFIG -= app_bundle
+TARGET = protocolbench
+
+SOURCES += $$PWD/main.cpp
+
+INCLUDEPATH += $$PWD/../../src
+
+# The whole stack: BotProcess, SimController and Simulation, headless.
+SOURCES += $$files($$PWD/../../src/engine/*.cpp)
+HEADERS += $$files($$PWD/../../src/engine/*.h)
+SOURCES += $$files($$PWD/../../src/controller/*.cpp)
+HEADERS += $$files($$PWD/../../src/controller/*.h)
+
+# shm_open lives in librt on glibc before 2.34.
+linux: LIBS += -lrt
+
+DESTDIR = ../../bin
+OBJECTS_DIR = ../../build/protocolbench-obj
+MOC_DIR = ../../build/protocolbench-moc
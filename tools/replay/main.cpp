@@ -0,0 +1,51 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <iostream>
+
+#include "controller/SessionTrace.h"
+
+using hadak::ReplayResult;
+using hadak::TraceReplayer;
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QStringList args = app.arguments();
+  if (args.size() < 2) {
+    std::cerr << "Usage: replay <session.htrace> [repeat]\n";
+    return 2;
+  }
+  int repeat = 1;
+  if (args.size() > 2) {
+    repeat = qMax(1, args.at(2).toInt());
+  }
+
+  TraceReplayer replayer;
+  QString error;
+  if (!replayer.load(args.at(1), &error)) {
+    std::cerr << "Load failed: " << error.toStdString() << "\n";
+    return 1;
+  }
+
+  qint64 commands = 0;
+  qint64 ticks = 0;
+  qint64 hashes = 0;
+  qint64 elapsedNs = 0;
+  for (int i = 0; i < repeat; ++i) {
+    ReplayResult result = replayer.run();
+    if (!result.ok) {
+      std::cerr << "Replay failed: " << result.error.toStdString() << "\n";
+      return 1;
+    }
+    commands += result.commands;
+    ticks += result.ticks;
+    hashes += result.hashesChecked;
+    elapsedNs += result.elapsedNs;
+  }
+
+  double seconds = qMax<qint64>(elapsedNs, 1) / 1e9;
+  std::cout << "Replayed " << commands << " commands and " << ticks
+            << " ticks in " << seconds * 1000.0 << " ms ("
+            << static_cast<qint64>(commands / seconds) << " commands/sec)\n";
+  std::cout << hashes << " state hashes matched\n";
+  return 0;
+}
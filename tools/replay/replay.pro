@@ -0,0 +1,22 @@
+QT += core network
+TEMPLATE = app
+CONFIG += c++20 console
+CONFIG -= app_bundle
+TARGET = replay
+
+SOURCES += $$PWD/main.cpp
+
+INCLUDEPATH += $$PWD/../../src
+
+# Replay runs the real engine and controller, minus the bot process.
+SOURCES += $$files($$PWD/../../src/engine/*.cpp)
+HEADERS += $$files($$PWD/../../src/engine/*.h)
+SOURCES += $$files($$PWD/../../src/controller/*.cpp)
+HEADERS += $$files($$PWD/../../src/controller/*.h)
+
+# shm_open lives in librt on glibc before 2.34.
+linux: LIBS += -lrt
+
+DESTDIR = ../../bin
+OBJECTS_DIR = ../../build/replay-obj
+MOC_DIR = ../../build/replay-moc
@@ -0,0 +1,65 @@
+#include "WorkStealingPool.h"
+
+#include <QThread>
+
+namespace hadak {
+
+WorkStealingPool::WorkStealingPool(int workers) {
+  for (int i = 0; i < qMax(1, workers); ++i) {
+    m_queues.push_back(std::make_unique<JobQueue>());
+  }
+}
+
+int WorkStealingPool::workerCount() const {
+  return static_cast<int>(m_queues.size());
+}
+
+void WorkStealingPool::submit(std::function<void()> job) {
+  JobQueue &queue = *m_queues[m_nextQueue];
+  m_nextQueue = (m_nextQueue + 1) % workerCount();
+  QMutexLocker locker(&queue.mutex);
+  queue.jobs.push_back(std::move(job));
+}
+
+void WorkStealingPool::run() {
+  std::vector<QThread *> threads;
+  for (int worker = 0; worker < workerCount(); ++worker) {
+    threads.push_back(QThread::create([this, worker]() {
+      std::function<void()> job;
+      while (take(worker, &job)) {
+        job();
+      }
+    }));
+    threads.back()->start();
+  }
+  for (QThread *thread : threads) {
+    thread->wait();
+    delete thread;
+  }
+}
+
+bool WorkStealingPool::take(int worker, std::function<void()> *job) {
+  {
+    JobQueue &own = *m_queues[worker];
+    QMutexLocker locker(&own.mutex);
+    if (!own.jobs.empty()) {
+      *job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      return true;
+    }
+  }
+  // No job spawns further jobs, so once every deque is empty the pool is
+  // drained and the worker can exit.
+  for (int offset = 1; offset < workerCount(); ++offset) {
+    JobQueue &victim = *m_queues[(worker + offset) % workerCount()];
+    QMutexLocker locker(&victim.mutex);
+    if (!victim.jobs.empty()) {
+      *job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace hadak
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QMutex>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace hadak {
+
+// Fixed set of worker threads, each with its own job deque. Workers take
+// from the back of their own deque and, once it is empty, steal from the
+// front of the others', so long matches on one worker do not leave the
+// rest idle. Jobs are submitted up front and run() blocks until all of
+// them have finished.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(int workers);
+
+  int workerCount() const;
+  void submit(std::function<void()> job);
+  void run();
+
+ private:
+  struct JobQueue {
+    QMutex mutex;
+    std::deque<std::function<void()>> jobs;
+  };
+
+  std::vector<std::unique_ptr<JobQueue>> m_queues;
+  int m_nextQueue = 0;
+
+  bool take(int worker, std::function<void()> *job);
+};
+
+}  // namespace hadak
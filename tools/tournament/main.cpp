@@ -0,0 +1,572 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+#include "WorkStealingPool.h"
+#include "controller/HeadlessRunner.h"
+#include "engine/Maze.h"
+#include "engine/MazeGenerator.h"
+
+using hadak::HeadlessRunner;
+using hadak::LatencyProfiler;
+using hadak::MatchLimits;
+using hadak::MatchResult;
+using hadak::Maze;
+using hadak::MazeGenerator;
+using hadak::StatId;
+using hadak::WorkStealingPool;
+
+namespace {
+
+struct BotEntry {
+  QString name;
+  QString command;
+};
+
+struct MazeEntry {
+  QString name;
+  std::shared_ptr<const Maze> maze;
+};
+
+struct ResultRow {
+  QString bot;
+  QString maze;
+  QString status;
+  bool solved = false;
+  double score = 0.0;
+  int steps = 0;
+  int collisions = 0;
+  QString bestRunDistance;
+  QString bestRunTurns;
+  QString bestRunTime;
+  QString totalDistance;
+  QString totalTurns;
+  qint64 ticks = 0;
+  qint64 commands = 0;
+  qint64 elapsedMs = 0;
+  QString reason;
+};
+
+const QStringList kResultColumns = {
+    "bot",           "maze",           "status",         "solved",
+    "score",         "steps",          "collisions",     "best_run_distance",
+    "best_run_turns", "best_run_time", "total_distance", "total_turns",
+    "ticks",         "commands",       "elapsed_ms",     "reason",
+};
+
+QString csvField(const QString &value) {
+  if (!value.contains(',') && !value.contains('"')) {
+    return value;
+  }
+  QString quoted = value;
+  quoted.replace("\"", "\"\"");
+  return "\"" + quoted + "\"";
+}
+
+QStringList parseCsvLine(const QString &line) {
+  QStringList fields;
+  QString field;
+  bool quoted = false;
+  for (int i = 0; i < line.size(); ++i) {
+    QChar c = line.at(i);
+    if (quoted) {
+      if (c == '"' && i + 1 < line.size() && line.at(i + 1) == '"') {
+        field += '"';
+        ++i;
+      } else if (c == '"') {
+        quoted = false;
+      } else {
+        field += c;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.append(field);
+      field.clear();
+    } else {
+      field += c;
+    }
+  }
+  fields.append(field);
+  return fields;
+}
+
+QString rowToCsv(const ResultRow &row) {
+  QStringList fields = {
+      csvField(row.bot),
+      csvField(row.maze),
+      row.status,
+      row.solved ? "1" : "0",
+      QString::number(row.score),
+      QString::number(row.steps),
+      QString::number(row.collisions),
+      row.bestRunDistance,
+      row.bestRunTurns,
+      row.bestRunTime,
+      row.totalDistance,
+      row.totalTurns,
+      QString::number(row.ticks),
+      QString::number(row.commands),
+      QString::number(row.elapsedMs),
+      csvField(row.reason),
+  };
+  return fields.join(",");
+}
+
+bool rowFromCsv(const QString &line, ResultRow *row) {
+  QStringList fields = parseCsvLine(line);
+  // Files from before the reason column still resume.
+  if ((fields.size() != kResultColumns.size() &&
+       fields.size() != kResultColumns.size() - 1) ||
+      fields.at(0) == "bot") {
+    return false;
+  }
+  bool ok = false;
+  row->bot = fields.at(0);
+  row->maze = fields.at(1);
+  row->status = fields.at(2);
+  row->solved = fields.at(3) == "1";
+  row->score = fields.at(4).toDouble(&ok);
+  if (!ok || row->status.isEmpty()) {
+    return false;
+  }
+  row->steps = fields.at(5).toInt();
+  row->collisions = fields.at(6).toInt();
+  row->bestRunDistance = fields.at(7);
+  row->bestRunTurns = fields.at(8);
+  row->bestRunTime = fields.at(9);
+  row->totalDistance = fields.at(10);
+  row->totalTurns = fields.at(11);
+  row->ticks = fields.at(12).toLongLong();
+  row->commands = fields.at(13).toLongLong();
+  row->elapsedMs = fields.at(14).toLongLong(&ok);
+  row->reason = fields.value(15);
+  return ok;
+}
+
+ResultRow rowFromMatch(const BotEntry &bot, const MazeEntry &maze,
+                       const MatchResult &result) {
+  ResultRow row;
+  row.bot = bot.name;
+  row.maze = maze.name;
+  row.status = result.status;
+  row.solved = result.solved;
+  row.score = result.stats.statValue(StatId::Score);
+  row.steps = result.steps;
+  row.collisions = result.collisions;
+  row.bestRunDistance = result.stats.statString(StatId::BestRunDistance);
+  row.bestRunTurns = result.stats.statString(StatId::BestRunTurns);
+  row.bestRunTime = result.stats.statString(StatId::BestRunTime);
+  row.totalDistance = result.stats.statString(StatId::TotalDistance);
+  row.totalTurns = result.stats.statString(StatId::TotalTurns);
+  row.ticks = result.ticks;
+  row.commands = result.commands;
+  row.elapsedMs = result.elapsedMs;
+  row.reason = result.reason;
+  return row;
+}
+
+// Rows from an earlier, possibly interrupted run. A torn last line simply
+// fails to parse and that match is played again.
+QVector<ResultRow> loadResults(const QString &path) {
+  QVector<ResultRow> rows;
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly | QFile::Text)) {
+    return rows;
+  }
+  QTextStream stream(&file);
+  while (!stream.atEnd()) {
+    ResultRow row;
+    if (rowFromCsv(stream.readLine(), &row)) {
+      rows.append(row);
+    }
+  }
+  return rows;
+}
+
+bool addBotDir(const QString &path, QVector<BotEntry> *bots, QString *error) {
+  QDir dir(path);
+  if (!dir.exists()) {
+    *error = QString("Bot directory not found: %1").arg(path);
+    return false;
+  }
+  for (const QString &file :
+       dir.entryList(QStringList() << "*.py", QDir::Files, QDir::Name)) {
+    bots->append(
+        BotEntry{QFileInfo(file).baseName(),
+                 QString("python3 -u %1").arg(dir.absoluteFilePath(file))});
+  }
+  return true;
+}
+
+bool loadMazeDir(const QString &path, QVector<MazeEntry> *mazes,
+                 QString *error) {
+  QDir dir(path);
+  if (!dir.exists()) {
+    *error = QString("Maze directory not found: %1").arg(path);
+    return false;
+  }
+  for (const QString &file : dir.entryList(QStringList() << "*.map" << "*.num",
+                                           QDir::Files, QDir::Name)) {
+    QString mazeError;
+    Maze *maze = Maze::fromFile(dir.filePath(file), &mazeError);
+    if (!maze) {
+      std::cerr << "Skipping " << file.toStdString() << ": "
+                << mazeError.toStdString() << "\n";
+      continue;
+    }
+    mazes->append(MazeEntry{file, std::shared_ptr<const Maze>(maze)});
+  }
+  return true;
+}
+
+struct Standing {
+  QString bot;
+  int matches = 0;
+  int solved = 0;
+  int collisions = 0;
+  double totalScore = 0.0;
+  qint64 solvedSteps = 0;
+  double solvedTime = 0.0;
+
+  double meanScore() const { return matches > 0 ? totalScore / matches : 0.0; }
+  double meanSteps() const {
+    return solved > 0 ? static_cast<double>(solvedSteps) / solved : 0.0;
+  }
+  double meanRunTime() const { return solved > 0 ? solvedTime / solved : 0.0; }
+};
+
+// Lower Stats scores are better and an unsolved maze scores 2000, so bots
+// are ranked by their mean score over every maze.
+QVector<Standing> rankBots(const QVector<ResultRow> &rows) {
+  QHash<QString, Standing> byBot;
+  for (const ResultRow &row : rows) {
+    Standing &standing = byBot[row.bot];
+    standing.bot = row.bot;
+    standing.matches += 1;
+    standing.collisions += row.collisions;
+    standing.totalScore += row.score;
+    if (row.solved) {
+      standing.solved += 1;
+      standing.solvedSteps += row.steps;
+      standing.solvedTime += row.bestRunTime.toDouble();
+    }
+  }
+  QVector<Standing> standings = byBot.values();
+  std::sort(standings.begin(), standings.end(),
+            [](const Standing &a, const Standing &b) {
+              if (a.meanScore() != b.meanScore()) {
+                return a.meanScore() < b.meanScore();
+              }
+              return a.bot < b.bot;
+            });
+  return standings;
+}
+
+bool writeLeaderboard(const QString &path, const QVector<ResultRow> &rows,
+                      QString *error) {
+  QVector<Standing> standings = rankBots(rows);
+  QFile file(path);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+    *error = QString("Unable to write %1").arg(path);
+    return false;
+  }
+
+  if (path.endsWith(".json", Qt::CaseInsensitive)) {
+    QJsonArray bots;
+    for (int i = 0; i < standings.size(); ++i) {
+      const Standing &s = standings.at(i);
+      QJsonObject entry;
+      entry.insert("rank", i + 1);
+      entry.insert("bot", s.bot);
+      entry.insert("matches", s.matches);
+      entry.insert("solved", s.solved);
+      entry.insert("meanScore", s.meanScore());
+      entry.insert("collisions", s.collisions);
+      entry.insert("meanStepsSolved", s.meanSteps());
+      entry.insert("meanBestRunTime", s.meanRunTime());
+      bots.append(entry);
+    }
+    QJsonObject root;
+    root.insert("matches", static_cast<int>(rows.size()));
+    root.insert("bots", bots);
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return true;
+  }
+
+  QTextStream stream(&file);
+  stream << "rank,bot,matches,solved,mean_score,collisions,mean_steps_solved,"
+            "mean_best_run_time\n";
+  for (int i = 0; i < standings.size(); ++i) {
+    const Standing &s = standings.at(i);
+    stream << i + 1 << "," << csvField(s.bot) << "," << s.matches << ","
+           << s.solved << "," << s.meanScore() << "," << s.collisions << ","
+           << s.meanSteps() << "," << s.meanRunTime() << "\n";
+  }
+  return true;
+}
+
+// Latency of the matches played in this invocation only; rows resumed
+// from the results CSV carry none.
+bool writeLatency(const QString &path,
+                  const QMap<QString, LatencyProfiler> &latency,
+                  QString *error) {
+  QFile file(path);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+    *error = QString("Unable to write %1").arg(path);
+    return false;
+  }
+  QJsonObject bots;
+  for (auto it = latency.constBegin(); it != latency.constEnd(); ++it) {
+    bots.insert(it.key(), it.value().toJson());
+  }
+  QJsonObject root;
+  root.insert("unit", "us");
+  root.insert("bots", bots);
+  file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Plays every bot on every maze and ranks the bots by Stats score.");
+  parser.addHelpOption();
+  QCommandLineOption botOption("bot", "Bot to enter, as name=command.",
+                               "name=command");
+  QCommandLineOption botDirOption(
+      "bot-dir", "Enter every *.py in a directory as a bot.", "dir");
+  QCommandLineOption workDirOption(
+      "workdir", "Working directory for bot commands.", "dir",
+      QDir::currentPath());
+  QCommandLineOption mazesOption("mazes", "Directory of .map/.num mazes.",
+                                 "dir");
+  QCommandLineOption generateOption("generate", "Generate a corpus of N mazes.",
+                                    "count");
+  QCommandLineOption sizeOption("size", "Generated maze size.", "WxH",
+                                "16x16");
+  QCommandLineOption seedOption("seed", "First seed of the generated corpus.",
+                                "seed", "1");
+  QCommandLineOption resultsOption(
+      "results", "Per-match CSV; rows already in it are not replayed.",
+      "file", "results.csv");
+  QCommandLineOption leaderboardOption(
+      "leaderboard", "Leaderboard output, .json or .csv.", "file",
+      "leaderboard.json");
+  QCommandLineOption jobsOption("jobs", "Worker threads.", "n",
+                                QString::number(QThread::idealThreadCount()));
+  QCommandLineOption maxBotsOption(
+      "max-bots", "Bot processes allowed to run at once (default: jobs).",
+      "n");
+  QCommandLineOption timeoutOption("timeout", "Seconds allowed per match.",
+                                   "sec", "60");
+  QCommandLineOption cpuLimitOption(
+      "cpu-limit", "CPU seconds a bot process may use per match.", "sec");
+  QCommandLineOption memoryLimitOption(
+      "memory-limit", "Address space a bot process may use, in MB.", "mb");
+  QCommandLineOption responseTimeoutOption(
+      "response-timeout",
+      "Seconds a bot may stay silent after being answered.", "sec");
+  QCommandLineOption maxTicksOption("max-ticks", "Ticks allowed per match.",
+                                    "n", "200000");
+  QCommandLineOption kinematicOption(
+      "kinematic",
+      "Time runs with the kinematic motion model instead of in ticks.");
+  QCommandLineOption shmOption(
+      "shm", "Offer bots the shared-memory transport (see HADAK_SHM).");
+  QCommandLineOption spareBotsOption(
+      "spare-bots",
+      "Idle bot processes each worker keeps started for its next match; "
+      "they do not count toward --max-bots.",
+      "n", "0");
+  QCommandLineOption latencyOption(
+      "latency",
+      "Profile each bot's commands (think, wait and service p50/p99) and "
+      "write them to a JSON file.",
+      "file");
+  parser.addOptions({botOption, botDirOption, workDirOption, mazesOption,
+                     generateOption, sizeOption, seedOption, resultsOption,
+                     leaderboardOption, jobsOption, maxBotsOption,
+                     timeoutOption, cpuLimitOption, memoryLimitOption,
+                     responseTimeoutOption, maxTicksOption, kinematicOption,
+                     shmOption, spareBotsOption, latencyOption});
+  parser.process(app);
+
+  QString error;
+  QVector<BotEntry> bots;
+  for (const QString &spec : parser.values(botOption)) {
+    int eq = spec.indexOf('=');
+    if (eq <= 0) {
+      std::cerr << "Bad --bot value (expected name=command): "
+                << spec.toStdString() << "\n";
+      return 2;
+    }
+    bots.append(BotEntry{spec.left(eq), spec.mid(eq + 1)});
+  }
+  for (const QString &dir : parser.values(botDirOption)) {
+    if (!addBotDir(dir, &bots, &error)) {
+      std::cerr << error.toStdString() << "\n";
+      return 2;
+    }
+  }
+
+  QVector<MazeEntry> mazes;
+  if (parser.isSet(mazesOption) &&
+      !loadMazeDir(parser.value(mazesOption), &mazes, &error)) {
+    std::cerr << error.toStdString() << "\n";
+    return 2;
+  }
+  if (parser.isSet(generateOption)) {
+    QStringList size = parser.value(sizeOption).split('x');
+    int width = size.value(0).toInt();
+    int height = size.value(1).toInt();
+    quint32 seed = parser.value(seedOption).toUInt();
+    int count = parser.value(generateOption).toInt();
+    for (int i = 0; i < count; ++i) {
+      Maze *maze = MazeGenerator::generate(width, height, seed + i);
+      if (!maze) {
+        std::cerr << "Unable to generate " << width << "x" << height
+                  << " mazes\n";
+        return 2;
+      }
+      mazes.append(MazeEntry{
+          QString("gen-%1x%2-%3").arg(width).arg(height).arg(seed + i),
+          std::shared_ptr<const Maze>(maze)});
+    }
+  }
+  if (bots.isEmpty() || mazes.isEmpty()) {
+    std::cerr << "Need at least one bot (--bot/--bot-dir) and one maze "
+                 "(--mazes/--generate)\n";
+    return 2;
+  }
+
+  QString resultsPath = parser.value(resultsOption);
+  QVector<ResultRow> rows = loadResults(resultsPath);
+  QSet<QPair<QString, QString>> done;
+  for (const ResultRow &row : rows) {
+    done.insert({row.bot, row.maze});
+  }
+
+  QFile results(resultsPath);
+  bool fresh = !results.exists() || results.size() == 0;
+  bool tornLine = false;
+  if (!fresh && results.open(QFile::ReadOnly)) {
+    results.seek(results.size() - 1);
+    tornLine = results.read(1) != "\n";
+    results.close();
+  }
+  if (!results.open(QFile::WriteOnly | QFile::Append)) {
+    std::cerr << "Unable to open " << resultsPath.toStdString() << "\n";
+    return 1;
+  }
+  if (tornLine) {
+    results.write("\n");
+  }
+  if (fresh) {
+    results.write((kResultColumns.join(",") + "\n").toUtf8());
+  }
+  results.flush();
+
+  MatchLimits limits;
+  limits.timeoutMs = qMax(1, parser.value(timeoutOption).toInt()) * 1000;
+  limits.maxTicks = qMax<qint64>(1, parser.value(maxTicksOption).toLongLong());
+  limits.cpuSeconds = qMax(0, parser.value(cpuLimitOption).toInt());
+  limits.memoryBytes =
+      qMax<qint64>(0, parser.value(memoryLimitOption).toLongLong()) * 1024 *
+      1024;
+  limits.responseTimeoutMs =
+      qMax(0, parser.value(responseTimeoutOption).toInt()) * 1000;
+  HeadlessRunner runner;
+  runner.setLimits(limits);
+  runner.setKinematic(parser.isSet(kinematicOption));
+  runner.setSharedMemory(parser.isSet(shmOption));
+  runner.setSpareBots(qMax(0, parser.value(spareBotsOption).toInt()));
+  runner.setProfiling(parser.isSet(latencyOption));
+
+  WorkStealingPool pool(qMax(1, parser.value(jobsOption).toInt()));
+  int maxBots = parser.isSet(maxBotsOption)
+                    ? qMax(1, parser.value(maxBotsOption).toInt())
+                    : pool.workerCount();
+  QSemaphore botSlots(maxBots);
+  QMutex outputMutex;
+  QMap<QString, LatencyProfiler> latency;
+  QString workDir = parser.value(workDirOption);
+
+  int total = 0;
+  int finished = 0;
+  for (const BotEntry &bot : bots) {
+    for (const MazeEntry &maze : mazes) {
+      if (done.contains({bot.name, maze.name})) {
+        continue;
+      }
+      ++total;
+      pool.submit([&, bot, maze]() {
+        botSlots.acquire();
+        MatchResult result = runner.run(*maze.maze, bot.command, workDir);
+        botSlots.release();
+
+        ResultRow row = rowFromMatch(bot, maze, result);
+        QMutexLocker locker(&outputMutex);
+        results.write((rowToCsv(row) + "\n").toUtf8());
+        results.flush();
+        rows.append(row);
+        if (!result.latency.isEmpty()) {
+          latency[bot.name].merge(result.latency);
+        }
+        ++finished;
+        std::cout << "[" << finished << "/" << total << "] "
+                  << bot.name.toStdString() << " on "
+                  << maze.name.toStdString() << ": "
+                  << result.status.toStdString();
+        if (!result.reason.isEmpty()) {
+          std::cout << " (" << result.reason.toStdString() << ")";
+        }
+        std::cout << ", score " << row.score << ", " << row.collisions
+                  << " collisions\n";
+      });
+    }
+  }
+  std::cout << bots.size() * mazes.size() << " matches, " << done.size()
+            << " already in " << resultsPath.toStdString() << ", running "
+            << total << " on " << pool.workerCount() << " workers (at most "
+            << maxBots << " bots at once)\n";
+  pool.run();
+  results.close();
+
+  if (parser.isSet(latencyOption)) {
+    QString latencyPath = parser.value(latencyOption);
+    if (!writeLatency(latencyPath, latency, &error)) {
+      std::cerr << error.toStdString() << "\n";
+      return 1;
+    }
+    std::cout << "Command latency written to " << latencyPath.toStdString()
+              << "\n";
+  }
+
+  QString leaderboardPath = parser.value(leaderboardOption);
+  if (!writeLeaderboard(leaderboardPath, rows, &error)) {
+    std::cerr << error.toStdString() << "\n";
+    return 1;
+  }
+  std::cout << "Leaderboard written to " << leaderboardPath.toStdString()
+            << "\n";
+  return 0;
+}
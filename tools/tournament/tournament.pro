@@ -0,0 +1,23 @@
+QT += core network
+TEMPLATE = app
+CONFIG += c++20 console
+CONFIG -= app_bundle
+TARGET = tournament
+
+SOURCES += $$PWD/main.cpp $$PWD/WorkStealingPool.cpp
+HEADERS += $$PWD/WorkStealingPool.h
+
+INCLUDEPATH += $$PWD/../../src
+
+# Matches run the real engine and controller against real bot processes.
+SOURCES += $$files($$PWD/../../src/engine/*.cpp)
+HEADERS += $$files($$PWD/../../src/engine/*.h)
+SOURCES += $$files($$PWD/../../src/controller/*.cpp)
+HEADERS += $$files($$PWD/../../src/controller/*.h)
+
+# shm_open lives in librt on glibc before 2.34.
+linux: LIBS += -lrt
+
+DESTDIR = ../../bin
+OBJECTS_DIR = ../../build/tournament-obj
+MOC_DIR = ../../build/tournament-moc